@@ -0,0 +1,120 @@
+// Measures how long generating a program takes as the density of gotos and
+// loops grows. Both add edges to the control flow graph of their function,
+// which the fact analysis visits until a fixed point is reached, so they are
+// the statements that make generation slow on large programs.
+//
+// Every density is a probability configuration, where the share of the
+// statements that are gotos and for loops is set and the other statements keep
+// their default share. Every program is generated in a process of its own, one
+// at a time, into /dev/null.
+//
+// Usage: cfg_bench [programs per density]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "AbsProgramGenerator.h"
+#include "CGOptions.h"
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CLProgramGenerator.h"
+#include "CLSmith/ParallelJobs.h"
+
+namespace {
+// The shares, out of 100, of the statements that are gotos and for loops.
+const int kGotoShares[] = {0, 5, 15};
+const int kForShares[] = {0, 15, 30};
+
+// Writes the statement probabilities for the given shares. The group is
+// cumulative, a statement with no share is given 0.
+bool WriteConfiguration(const std::string& fname, int goto_share,
+    int for_share) {
+  int for_prob = for_share ? 15 + for_share : 0;
+  int return_prob = 20 + for_share;
+  int goto_prob = goto_share ? return_prob + 10 + goto_share : 0;
+  int arrayop_prob = return_prob + 20 + goto_share;
+  std::ofstream out(fname.c_str());
+  out << "[statement_prob,"
+      << "statement_block_prob=0,"
+      << "statement_clstatement_prob=5,"
+      << "statement_ifelse_prob=15,"
+      << "statement_for_prob=" << for_prob << ','
+      << "statement_return_prob=" << return_prob << ','
+      << "statement_continue_prob=" << return_prob + 5 << ','
+      << "statement_break_prob=" << return_prob + 10 << ','
+      << "statement_goto_prob=" << goto_prob << ','
+      << "statement_arrayop_prob=" << arrayop_prob << ','
+      << "statement_assign_prob=100]" << std::endl;
+  return static_cast<bool>(out);
+}
+
+// Generates the program for the seed, as CLSmith does.
+bool Generate(int argc, char **argv, const std::string& configuration,
+    unsigned long seed) {
+  CGOptions::set_default_settings();
+  CLSmith::CLOptions::set_default_settings();
+  CLSmith::CLOptions::output("/dev/null");
+  CLSmith::CLOptions::ResolveCGOptions();
+  CGOptions::probability_configuration(configuration);
+  AbsProgramGenerator *generator =
+      AbsProgramGenerator::CreateInstance(argc, argv, seed);
+  if (!generator) return false;
+  {
+    CLSmith::CLProgramGenerator cl_generator(seed);
+    cl_generator.goGenerator();
+  }
+  delete generator;
+  return true;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned long programs = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 20;
+  if (!programs) {
+    std::cerr << "Usage: " << argv[0] << " [programs per density]"
+              << std::endl;
+    return 1;
+  }
+  std::string configuration = "cfg_bench_probabilities.txt";
+  bool ok = true;
+
+  std::cout << std::setw(6) << "gotos" << std::setw(6) << "fors"
+            << std::setw(16) << "ms/program" << std::endl;
+  for (int goto_share : kGotoShares) {
+    for (int for_share : kForShares) {
+      if (!WriteConfiguration(configuration, goto_share, for_share)) {
+        std::cerr << "Cannot write " << configuration << std::endl;
+        return 1;
+      }
+      unsigned long seed = 0;
+      size_t failed = 0;
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      CLSmith::RunJobQueue(1,
+          [&](std::function<bool()> *job) {
+            if (seed == programs) return false;
+            unsigned long next = ++seed;
+            *job = [argc, argv, &configuration, next]() {
+              return Generate(argc, argv, configuration, next);
+            };
+            return true;
+          },
+          [&](size_t, bool success) { failed += !success; });
+      double seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+      std::cout << std::setw(6) << goto_share << std::setw(6) << for_share
+                << std::setw(16) << std::fixed << std::setprecision(1)
+                << seconds * 1000 / programs;
+      if (failed) std::cout << "  (" << failed << " failed)";
+      std::cout << std::endl;
+      ok &= !failed;
+    }
+  }
+  std::remove(configuration.c_str());
+  return ok ? 0 : 1;
+}
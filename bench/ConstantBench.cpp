@@ -0,0 +1,211 @@
+// Measures what interning the literals of constants saves, comparing Constant
+// against a copy of the previous one, which held its own copy of its value,
+// formatted every int it was made from and worked out its text at every
+// output. For each version it reports:
+// - the operator new calls, the bytes they allocate and the time taken to
+//   create the constants;
+// - the time taken to output them.
+// The constants have the mix of a large program: small ints, as made for array
+// indices, loop bounds and buffer initialisers, small signed literals, and hex
+// literals of every integer type, each of which is used about 8 times, as in
+// the programs generated with the default options. They are drawn from a fixed
+// generator so that both versions create the same ones, and both must output
+// the same text.
+//
+// Usage: constant_bench [constants]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CGOptions.h"
+#include "Constant.h"
+#include "Type.h"
+
+// Every operator new call of the process is counted, with its size.
+static unsigned long g_allocations = 0;
+static unsigned long g_allocated_bytes = 0;
+
+void *operator new(std::size_t size) {
+  ++g_allocations;
+  g_allocated_bytes += size;
+  void *ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+// Number of times a hex literal is used, on average.
+const size_t kLiteralUses = 8;
+// Share of the constants that are hex literals, out of 10.
+const size_t kHexLiterals = 3;
+
+// The previous Constant, without the Expression it derives from. Output() is
+// virtual, as it is in Expression.
+class LegacyConstant {
+ public:
+  LegacyConstant(const Type *type, const std::string& value)
+      : type_(type), cast_type_(NULL), value_(value) {}
+  virtual ~LegacyConstant() {}
+
+  static LegacyConstant *make_int(int v) {
+    const Type& int_type = Type::get_simple_type(eInt);
+    std::ostringstream oss;
+    oss << v;
+    std::string s = CGOptions::mark_mutable_const() ?
+        ("(" + oss.str() + ")") : oss.str();
+    return new LegacyConstant(&int_type, s);
+  }
+
+  virtual void Output(std::ostream& out) const {
+    // As Expression::output_cast(), for a constant that is not cast.
+    if (cast_type_) out << "(" << cast_type_->eType << ")";
+    if (!value_.empty() && value_[0] == '-') {
+      out << "(" << value_ << ")";
+    } else if (type_->eType == ePointer && atoi(value_.c_str()) == 0) {
+      if (CGOptions::lang_cpp()) out << "NULL";
+      else out << "(void*)" << value_;
+    } else {
+      out << value_;
+    }
+  }
+
+ private:
+  const Type *type_;
+  const Type *cast_type_;
+  const std::string value_;
+};
+
+// A constant to create: an int, or a literal of a type.
+struct Draw {
+  bool is_int;
+  int value;
+  const Type *type;
+  std::string literal;
+};
+
+std::vector<Draw> MakeDraws(size_t count) {
+  const eSimpleType kTypes[] = {eChar, eShort, eInt, eLong, eUChar, eUShort,
+                                eUInt, eULong};
+  const int kHexDigits[] = {2, 4, 8, 16, 2, 4, 8, 16};
+  std::vector<Draw> draws(count);
+  unsigned long long state = 0x2545f4914f6cdd1dULL;
+  for (Draw& draw : draws) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    unsigned kind = state % 10;
+    int type = (state >> 8) % 8;
+    draw.type = &Type::get_simple_type(kTypes[type]);
+    draw.is_int = kind < 5;
+    if (draw.is_int) {
+      draw.value = (state >> 16) % 64;
+    } else if (kind < 10 - kHexLiterals) {
+      std::ostringstream oss;
+      oss << static_cast<int>((state >> 16) % 20) - 10
+          << (draw.type->is_signed() ? "L" : "UL");
+      draw.literal = oss.str();
+    } else {
+      // The literal is one of a pool, so that it is used as often as in a
+      // program, and its type comes with it.
+      size_t pool = count * kHexLiterals / (10 * kLiteralUses) + 1;
+      size_t literal = (state >> 16) % pool;
+      unsigned long long value = literal * 0x9e3779b97f4a7c15ULL;
+      type = literal % 8;
+      draw.type = &Type::get_simple_type(kTypes[type]);
+      std::ostringstream oss;
+      oss << "0x" << std::hex << std::uppercase << std::setfill('0')
+          << std::setw(kHexDigits[type])
+          << (value >> (64 - 4 * kHexDigits[type]))
+          << (draw.type->is_signed() ? "L" : "UL");
+      draw.literal = oss.str();
+    }
+  }
+  return draws;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Creates a constant for every draw and outputs them all, printing the
+// allocations and times, and returns the output.
+template <typename Node, typename MakeInt, typename MakeLiteral>
+std::string Run(const std::string& name, const std::vector<Draw>& draws,
+    MakeInt make_int, MakeLiteral make_literal) {
+  std::vector<Node *> nodes;
+  nodes.reserve(draws.size());
+  unsigned long allocations = g_allocations;
+  unsigned long bytes = g_allocated_bytes;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (const Draw& draw : draws)
+    nodes.push_back(draw.is_int ? make_int(draw.value) :
+        make_literal(draw.type, draw.literal));
+  double create = Seconds(start);
+  allocations = g_allocations - allocations;
+  bytes = g_allocated_bytes - bytes;
+
+  std::ostringstream out;
+  start = std::chrono::steady_clock::now();
+  for (const Node *node : nodes) {
+    node->Output(out);
+    out << ' ';
+  }
+  double output = Seconds(start);
+  for (Node *node : nodes) delete node;
+
+  std::cout << std::left << std::setw(10) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(2)
+            << static_cast<double>(allocations) / draws.size()
+            << " new/constant" << std::setw(10) << std::setprecision(1)
+            << static_cast<double>(bytes) / draws.size() << " bytes/constant"
+            << std::setw(10)
+            << create * 1e9 / draws.size() << " ns/create"
+            << std::setw(10) << output * 1e9 / draws.size() << " ns/output"
+            << std::endl;
+  return out.str();
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000;
+  if (!count) {
+    std::cerr << "Usage: " << argv[0] << " [constants]" << std::endl;
+    return 1;
+  }
+  CGOptions::set_default_settings();
+  Type::get_simple_type(eInt);
+  std::vector<Draw> draws = MakeDraws(count);
+
+  std::string legacy = Run<LegacyConstant>("legacy", draws,
+      [](int value) { return LegacyConstant::make_int(value); },
+      [](const Type *type, const std::string& literal) {
+        return new LegacyConstant(type, literal);
+      });
+  std::string interned = Run<Constant>("interned", draws,
+      [](int value) { return Constant::make_int(value); },
+      [](const Type *type, const std::string& literal) {
+        return new Constant(type, literal);
+      });
+  if (legacy != interned) {
+    std::cerr << "The outputs differ." << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,362 @@
+// Measures the throughput of the generator under representative option
+// profiles, so that its speed can be followed from commit to commit. Every
+// profile generates the same seeds, each program in a process of its own, one
+// at a time, and reports:
+// - the programs generated per second, over the whole profile;
+// - the peak resident set size of a program;
+// - the operator new calls per program;
+// - the bytes output per program;
+// - the time per program spent in each phase of
+//   CLProgramGenerator::goGenerator().
+// The results are printed as tables and, if a file is given, also written to it
+// as JSON, along with the commit the bench was built from. Given the JSON of an
+// earlier run as well, the throughput and allocations are compared with it, and
+// profiles that became more than 10% slower are flagged.
+//
+// Usage: generator_bench [programs per profile] [JSON file] [baseline JSON]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <sys/resource.h>
+#endif
+
+#include "AbsProgramGenerator.h"
+#include "CGOptions.h"
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CLProgramGenerator.h"
+#include "CLSmith/ParallelJobs.h"
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+// Every operator new call of the process is counted.
+static unsigned long g_allocations = 0;
+
+void *operator new(std::size_t size) {
+  ++g_allocations;
+  void *ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+// The options a profile sets, on top of the defaults.
+struct Profile {
+  const char *name;
+  std::function<void()> set;
+};
+
+// Real divergence needs divergence tracking, which cannot be done with
+// vectors, so the profile combining the features uses fake divergence.
+const Profile kProfiles[] = {
+  {"default", [] {}},
+  {"small", [] { CLSmith::CLOptions::small(true); }},
+  {"vectors_atomics_barriers_fake_divergence", [] {
+    CLSmith::CLOptions::vectors(true);
+    CLSmith::CLOptions::atomics(true);
+    CLSmith::CLOptions::barriers(true);
+    CLSmith::CLOptions::fake_divergence(true);
+  }},
+  {"emi", [] { CLSmith::CLOptions::emi(true); }},
+  {"message_passing", [] { CLSmith::CLOptions::message_passing(true); }},
+  {"inter_thread_comm", [] { CLSmith::CLOptions::inter_thread_comm(true); }},
+};
+
+// Slowdown from the baseline beyond which a profile is flagged.
+const double kRegressionThreshold = 0.10;
+
+// What is measured for one program.
+struct Measurement {
+  unsigned long allocations;
+  unsigned long output_bytes;
+  unsigned long peak_rss_kb;
+  std::vector<std::pair<std::string, double> > phase_seconds;
+};
+
+// The totals of a profile.
+struct Totals {
+  Totals() : programs(0), failed(0), seconds(0), allocations(0),
+      output_bytes(0), peak_rss_kb(0) {}
+
+  unsigned long programs;
+  unsigned long failed;
+  double seconds;
+  double allocations;
+  double output_bytes;
+  unsigned long peak_rss_kb;
+  // The phases in the order they ran, with their total time.
+  std::vector<std::pair<std::string, double> > phase_seconds;
+};
+
+// Generates the program for the seed with the options of the profile, as
+// CLSmith does, and writes what was measured to record.
+bool Generate(int argc, char **argv, const Profile& profile,
+    unsigned long seed, const std::string& output, const std::string& record) {
+  CGOptions::set_default_settings();
+  CLSmith::CLOptions::set_default_settings();
+  profile.set();
+  CLSmith::CLOptions::output(output.c_str());
+  CLSmith::CLOptions::ResolveCGOptions();
+  unsigned long allocations = g_allocations;
+  AbsProgramGenerator *generator =
+      AbsProgramGenerator::CreateInstance(argc, argv, seed);
+  if (!generator) return false;
+  std::vector<std::pair<const char *, double> > phase_seconds;
+  {
+    CLSmith::CLProgramGenerator cl_generator(seed);
+    cl_generator.goGenerator();
+    phase_seconds = cl_generator.phase_seconds();
+  }
+  delete generator;
+  allocations = g_allocations - allocations;
+
+  struct stat output_stat;
+  if (stat(output.c_str(), &output_stat)) return false;
+  unsigned long peak_rss_kb = 0;
+#ifndef _MSC_VER
+  struct rusage usage;
+  if (!getrusage(RUSAGE_SELF, &usage)) peak_rss_kb = usage.ru_maxrss;
+#endif
+
+  std::ofstream out(record.c_str());
+  out << allocations << ' ' << output_stat.st_size << ' ' << peak_rss_kb;
+  for (const std::pair<const char *, double>& phase : phase_seconds)
+    out << ' ' << phase.first << ' ' << phase.second;
+  out << std::endl;
+  return static_cast<bool>(out);
+}
+
+bool ReadMeasurement(const std::string& record, Measurement *measurement) {
+  std::ifstream in(record.c_str());
+  if (!(in >> measurement->allocations >> measurement->output_bytes >>
+      measurement->peak_rss_kb))
+    return false;
+  measurement->phase_seconds.clear();
+  std::string phase;
+  double seconds;
+  while (in >> phase >> seconds)
+    measurement->phase_seconds.push_back(std::make_pair(phase, seconds));
+  return true;
+}
+
+void AddMeasurement(const Measurement& measurement, Totals *totals) {
+  ++totals->programs;
+  totals->allocations += measurement.allocations;
+  totals->output_bytes += measurement.output_bytes;
+  if (measurement.peak_rss_kb > totals->peak_rss_kb)
+    totals->peak_rss_kb = measurement.peak_rss_kb;
+  for (const std::pair<std::string, double>& phase :
+      measurement.phase_seconds) {
+    std::vector<std::pair<std::string, double> >::iterator it;
+    for (it = totals->phase_seconds.begin();
+        it != totals->phase_seconds.end(); ++it)
+      if (it->first == phase.first) break;
+    if (it == totals->phase_seconds.end())
+      totals->phase_seconds.push_back(phase);
+    else
+      it->second += phase.second;
+  }
+}
+
+double PerProgram(double total, const Totals& totals) {
+  return totals.programs ? total / totals.programs : 0;
+}
+
+void OutputJSON(std::ostream& out, unsigned long programs,
+    const std::vector<Totals>& results) {
+  out << std::fixed << std::setprecision(3)
+      << "{\n"
+      << "  \"commit\": \"" << GIT_VERSION << "\",\n"
+      << "  \"programs_per_profile\": " << programs << ",\n"
+      << "  \"profiles\": [\n";
+  for (size_t idx = 0; idx < results.size(); ++idx) {
+    const Totals& totals = results[idx];
+    out << "    {\n"
+        << "      \"name\": \"" << kProfiles[idx].name << "\",\n"
+        << "      \"programs\": " << totals.programs << ",\n"
+        << "      \"failed\": " << totals.failed << ",\n"
+        << "      \"programs_per_second\": "
+        << (totals.seconds ? totals.programs / totals.seconds : 0) << ",\n"
+        << "      \"peak_rss_kb\": " << totals.peak_rss_kb << ",\n"
+        << "      \"allocations_per_program\": "
+        << PerProgram(totals.allocations, totals) << ",\n"
+        << "      \"output_bytes_per_program\": "
+        << PerProgram(totals.output_bytes, totals) << ",\n"
+        << "      \"phase_ms_per_program\": {";
+    for (size_t phase = 0; phase < totals.phase_seconds.size(); ++phase) {
+      out << (phase ? ", " : "") << '"' << totals.phase_seconds[phase].first
+          << "\": "
+          << PerProgram(totals.phase_seconds[phase].second * 1000, totals);
+    }
+    out << "}\n"
+        << "    }" << (idx + 1 < results.size() ? "," : "") << '\n';
+  }
+  out << "  ]\n"
+      << "}" << std::endl;
+}
+
+// Reads the programs per second and allocations per program of every profile
+// from JSON written by OutputJSON, and the commit it was measured at.
+bool ReadBaseline(const char *fname, std::string *commit,
+    std::map<std::string, std::pair<double, double> > *baseline) {
+  std::ifstream in(fname);
+  std::string line, name;
+  while (std::getline(in, line)) {
+    std::string::size_type colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string key = line.substr(0, colon);
+    std::string value = line.substr(colon + 1);
+    key = key.substr(key.find('"') + 1);
+    key = key.substr(0, key.find('"'));
+    if (key == "commit" || key == "name") {
+      value = value.substr(value.find('"') + 1);
+      value = value.substr(0, value.find('"'));
+      if (key == "commit") *commit = value;
+      else name = value;
+    } else if (key == "programs_per_second") {
+      (*baseline)[name].first = std::strtod(value.c_str(), NULL);
+    } else if (key == "allocations_per_program") {
+      (*baseline)[name].second = std::strtod(value.c_str(), NULL);
+    }
+  }
+  return !baseline->empty();
+}
+
+// The relative change from before to after, in percent.
+double Change(double before, double after) {
+  return before ? (after - before) * 100 / before : 0;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned long programs = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 20;
+  if (!programs) {
+    std::cerr << "Usage: " << argv[0]
+              << " [programs per profile] [JSON file] [baseline JSON]"
+              << std::endl;
+    return 1;
+  }
+  std::string output = "generator_bench_output.c";
+  std::string record = "generator_bench_record.txt";
+  std::vector<Totals> results;
+
+  for (const Profile& profile : kProfiles) {
+    Totals totals;
+    unsigned long seed = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    CLSmith::RunJobQueue(1,
+        [&](std::function<bool()> *job) {
+          if (seed == programs) return false;
+          unsigned long next = ++seed;
+          *job = [argc, argv, &profile, next, &output, &record]() {
+            return Generate(argc, argv, profile, next, output, record);
+          };
+          std::remove(record.c_str());
+          return true;
+        },
+        [&](size_t, bool success) {
+          Measurement measurement;
+          if (success && ReadMeasurement(record, &measurement))
+            AddMeasurement(measurement, &totals);
+          else
+            ++totals.failed;
+        });
+    totals.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    results.push_back(totals);
+  }
+  std::remove(output.c_str());
+  std::remove(record.c_str());
+
+  std::cout << std::left << std::setw(42) << "profile" << std::right
+            << std::setw(10) << "progs/s" << std::setw(12) << "peak RSS KB"
+            << std::setw(14) << "allocs/prog" << std::setw(14) << "bytes/prog"
+            << std::endl;
+  for (size_t idx = 0; idx < results.size(); ++idx) {
+    const Totals& totals = results[idx];
+    std::cout << std::left << std::setw(42) << kProfiles[idx].name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10)
+              << (totals.seconds ? totals.programs / totals.seconds : 0)
+              << std::setw(12) << totals.peak_rss_kb << std::setprecision(0)
+              << std::setw(14) << PerProgram(totals.allocations, totals)
+              << std::setw(14) << PerProgram(totals.output_bytes, totals);
+    if (totals.failed) std::cout << "  (" << totals.failed << " failed)";
+    std::cout << std::endl;
+  }
+
+  std::cout << std::endl << "ms per program in each phase" << std::endl;
+  for (size_t idx = 0; idx < results.size(); ++idx) {
+    const Totals& totals = results[idx];
+    std::cout << std::left << std::setw(42) << kProfiles[idx].name;
+    for (const std::pair<std::string, double>& phase : totals.phase_seconds) {
+      std::cout << ' ' << phase.first << '=' << std::fixed
+                << std::setprecision(2)
+                << PerProgram(phase.second * 1000, totals);
+    }
+    std::cout << std::right << std::endl;
+  }
+
+  std::string baseline_commit;
+  std::map<std::string, std::pair<double, double> > baseline;
+  if (argc > 3 && !ReadBaseline(argv[3], &baseline_commit, &baseline)) {
+    std::cerr << "Cannot read " << argv[3] << std::endl;
+    return 1;
+  }
+  if (!baseline.empty()) {
+    std::cout << std::endl << "% change from " << baseline_commit << std::endl;
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+      const Totals& totals = results[idx];
+      std::map<std::string, std::pair<double, double> >::const_iterator it =
+          baseline.find(kProfiles[idx].name);
+      if (it == baseline.end()) continue;
+      double throughput = Change(it->second.first,
+          totals.seconds ? totals.programs / totals.seconds : 0);
+      std::cout << std::left << std::setw(42) << kProfiles[idx].name
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << throughput << std::setw(26)
+                << Change(it->second.second,
+                       PerProgram(totals.allocations, totals));
+      if (throughput < -kRegressionThreshold * 100)
+        std::cout << "  (regression)";
+      std::cout << std::endl;
+    }
+  }
+
+  if (argc > 2) {
+    std::ofstream json(argv[2]);
+    OutputJSON(json, programs, results);
+    if (!json) {
+      std::cerr << "Cannot write " << argv[2] << std::endl;
+      return 1;
+    }
+  }
+
+  bool ok = true;
+  for (const Totals& totals : results) ok &= !totals.failed;
+  return ok ? 0 : 1;
+}
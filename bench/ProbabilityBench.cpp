@@ -0,0 +1,213 @@
+// Measures how many generator decisions per second the probability lookups
+// make, comparing the flat tables against copies of the lookups they replaced:
+// - Probabilities::get_prob, formerly a map lookup and a virtual call;
+// - the equivalent group filters, formerly a walk over the group's map;
+// - ProbabilityTable::get_value, formerly a linear search over heap allocated
+//   entries;
+// - DistributionTable::rnd_num_to_key, formerly a linear search subtracting
+//   every probability in turn.
+// Both versions are fed the same draws, and must make the same decisions.
+//
+// Usage: probability_bench [decisions]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CGOptions.h"
+#include "Probabilities.h"
+#include "ProbabilityTable.h"
+#include "Type.h"
+
+namespace {
+// The previous ProbabilityTable.
+class LegacyTable {
+ public:
+  ~LegacyTable() {
+    for (Entry *entry : table_) delete entry;
+  }
+
+  void add_elem(unsigned int key, ProbName value) {
+    Entry *entry = new Entry(key, value);
+    std::vector<Entry *>::iterator it;
+    for (it = table_.begin(); it != table_.end(); ++it)
+      if ((*it)->key > key) break;
+    table_.insert(it, entry);
+  }
+
+  ProbName get_value(unsigned int key) {
+    std::vector<Entry *>::iterator it;
+    for (it = table_.begin(); it != table_.end(); ++it)
+      if ((*it)->key > key) break;
+    assert(it != table_.end());
+    return (*it)->value;
+  }
+
+ private:
+  struct Entry {
+    Entry(unsigned int k, ProbName v) : key(k), value(v) {}
+    unsigned int key;
+    ProbName value;
+  };
+  std::vector<Entry *> table_;
+};
+
+// The previous DistributionTable::rnd_num_to_key.
+class LegacyDistribution {
+ public:
+  void add_entry(int key, int prob) {
+    keys_.push_back(key);
+    probs_.push_back(prob);
+  }
+
+  int rnd_num_to_key(int rnd) const {
+    for (size_t idx = 0; idx < probs_.size(); ++idx) {
+      if (rnd < probs_[idx]) return keys_[idx];
+      rnd -= probs_[idx];
+    }
+    assert(0);
+    return -1;
+  }
+
+ private:
+  std::vector<int> keys_;
+  std::vector<int> probs_;
+};
+
+// Draws from a fixed generator, so that every run decides the same.
+class Draws {
+ public:
+  Draws(size_t count, int bound) : draws_(count) {
+    unsigned long long state = 0x2545f4914f6cdd1dULL;
+    for (int& draw : draws_) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      draw = static_cast<int>(state % static_cast<unsigned>(bound));
+    }
+  }
+
+  const std::vector<int>& Get() const { return draws_; }
+
+ private:
+  std::vector<int> draws_;
+};
+
+// Times decide over every draw, prints the decisions per second, and returns
+// the sum of the decisions so that both versions can be compared.
+template <typename Decide>
+long long Run(const std::string& name, const std::vector<int>& draws,
+    Decide decide) {
+  long long sum = 0;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int draw : draws) sum += decide(draw);
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  std::cout << std::left << std::setw(36) << name << std::right
+            << std::setw(14) << std::fixed << std::setprecision(0)
+            << draws.size() / seconds << " decisions/s" << std::endl;
+  return sum;
+}
+
+bool Compare(const std::string& name, long long legacy, long long flat) {
+  if (legacy == flat) return true;
+  std::cerr << name << ": the decisions differ." << std::endl;
+  return false;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 10000000;
+  if (!count) {
+    std::cerr << "Usage: " << argv[0] << " [decisions]" << std::endl;
+    return 1;
+  }
+  CGOptions::set_default_settings();
+  Probabilities *impl = Probabilities::GetInstance();
+  bool same = true;
+
+  // Single probabilities, formerly kept by name in a map.
+  std::vector<ProbName> singles;
+  std::map<ProbName, ProbElem *> legacy_singles;
+  for (int pname = pMoreStructUnionProb; pname <= pBuiltinFunctionProb;
+      ++pname) {
+    singles.push_back(static_cast<ProbName>(pname));
+    legacy_singles[static_cast<ProbName>(pname)] = new SingleProbElem(
+        impl->get_sname(static_cast<ProbName>(pname)),
+        static_cast<ProbName>(pname), 0,
+        Probabilities::get_prob(static_cast<ProbName>(pname)));
+  }
+  Draws single_draws(count, singles.size());
+  long long legacy = Run("get_prob (map)", single_draws.Get(),
+      [&](int draw) {
+    ProbName pname = singles[draw];
+    return legacy_singles[pname]->get_prob(pname);
+  });
+  long long flat = Run("get_prob (flat)", single_draws.Get(),
+      [&](int draw) { return Probabilities::get_prob(singles[draw]); });
+  same &= Compare("get_prob", legacy, flat);
+  for (auto& single : legacy_singles) delete single.second;
+
+  // The simple types filter, formerly walking the group's map.
+  std::map<ProbName, SingleProbElem *> legacy_group;
+  for (int pname = pVoidProb; pname <= pULongLongProb; ++pname)
+    legacy_group[static_cast<ProbName>(pname)] = new SingleProbElem(
+        impl->get_sname(static_cast<ProbName>(pname)),
+        static_cast<ProbName>(pname), 0,
+        Probabilities::get_prob(static_cast<ProbName>(pname)));
+  Draws type_draws(count, MAX_SIMPLE_TYPES);
+  legacy = Run("simple types filter (map)", type_draws.Get(), [&](int draw) {
+    for (auto& elem : legacy_group)
+      if (Probabilities::pname_to_type(elem.first) ==
+          static_cast<unsigned>(draw))
+        return elem.second->get_prob_direct() == 0;
+    return false;
+  });
+  Filter *filter = SIMPLE_TYPES_PROB_FILTER;
+  flat = Run("simple types filter (flat)", type_draws.Get(),
+      [&](int draw) { return filter->filter(draw); });
+  same &= Compare("simple types filter", legacy, flat);
+  for (auto& elem : legacy_group) delete elem.second;
+
+  // The statement table, drawn from for every statement.
+  LegacyTable legacy_table;
+  ProbabilityTable<unsigned int, ProbName> table;
+  table.initialize(pStatementProb);
+  unsigned int max_key = 0;
+  for (int pname = pAssignProb; pname <= pCLStatementProb; ++pname) {
+    int key = Probabilities::get_prob(static_cast<ProbName>(pname));
+    // Statements left out of the group are not looked up.
+    if (key <= 0 || key > 100) continue;
+    legacy_table.add_elem(key, static_cast<ProbName>(pname));
+    max_key = std::max<unsigned int>(max_key, key);
+  }
+  Draws table_draws(count, max_key);
+  legacy = Run("statement table (linear)", table_draws.Get(),
+      [&](int draw) { return legacy_table.get_value(draw); });
+  flat = Run("statement table (flat)", table_draws.Get(),
+      [&](int draw) { return table.get_value(draw); });
+  same &= Compare("statement table", legacy, flat);
+
+  // A distribution as large as the CLSmith statement ones.
+  LegacyDistribution legacy_distribution;
+  DistributionTable distribution;
+  for (int key = 0; key < 16; ++key) {
+    int prob = key % 5 == 4 ? 0 : 1 + key * 3;
+    legacy_distribution.add_entry(key, prob);
+    distribution.add_entry(key, prob);
+  }
+  Draws distribution_draws(count, distribution.get_max());
+  legacy = Run("distribution table (linear)", distribution_draws.Get(),
+      [&](int draw) { return legacy_distribution.rnd_num_to_key(draw); });
+  flat = Run("distribution table (flat)", distribution_draws.Get(),
+      [&](int draw) { return distribution.rnd_num_to_key(draw); });
+  same &= Compare("distribution table", legacy, flat);
+
+  Probabilities::DestroyInstance();
+  return same ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+// Differential testing of host C compilers on programs generated by csmith,
+// which is what compiler_test.pl does one compiler at a time.
+//
+// Every program is compiled and run with each compiler configuration (a
+// compiler and its options, such as "gcc -O2"), up to --jobs configurations at
+// a time, each in a process of its own (see RunJobQueue()). Compilers and
+// programs are run within their timeout, and killed along with everything
+// they started when it expires (see RunCommand()). The checksums the programs
+// print are then compared, and a verdict record is written for the program:
+//   <program> <verdict> <configuration>=<result>...
+// separated by tabs, where the result is the checksum, or compile_error,
+// compile_timeout, crash, timeout or no_checksum. The verdict is the first of
+// these that applies:
+// - compiler_crash: a compiler failed;
+// - compiler_hang: a compiler timed out;
+// - wrong_code: the checksums differ;
+// - program_crash: a program crashed or printed no checksum;
+// - program_hang: a program timed out, which is not interesting;
+// - pass.
+// The exit code is given by the verdicts, with the outcome codes of
+// --campaign, so difftest can be the test command of a campaign: 0 if every
+// program passes or hangs, otherwise 1 for a compiler crash, 2 for a program
+// crash, 3 for a compiler hang and 4 for wrong code.
+//
+// Compiled programs are kept in a cache directory, under a hash of everything
+// the compilation depends on: the configuration, the version the compiler
+// prints, the program, and the headers it includes from the include
+// directories, so the same program is only compiled once with a
+// configuration, whoever asks for it.
+//
+// Usage: difftest [options] programs...
+//   --cache DIR            keep compiled programs in DIR
+//   --cflags FLAGS         options given to every compiler
+//   --compile_timeout N    seconds a compiler may run, 120 by default
+//   --compiler CMD         a configuration, may be repeated
+//   --compilers FILE       read the configurations from FILE, one per line
+//   --include DIR          include directory, $CSMITH_HOME/runtime by default
+//   --jobs N               number of configurations compiled at a time, the
+//                          number of cores by default
+//   --run_timeout N        seconds a program may run, 8 by default
+//   --verdicts FILE        append the verdict records to FILE instead of
+//                          writing them out
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CLSmith/ParallelJobs.h"
+
+namespace {
+
+// Exit code for bad arguments.
+const int kUsageError = 64;
+
+enum Verdict {
+  kPass = 0,
+  kProgramHang,
+  kProgramCrash,
+  kWrongCode,
+  kCompilerHang,
+  kCompilerCrash
+};
+
+const char *const kVerdictNames[] = {
+  "pass", "program_hang", "program_crash", "wrong_code", "compiler_hang",
+  "compiler_crash"
+};
+
+// Exit code for each verdict, as the outcomes of --campaign.
+const int kVerdictExitCodes[] = {0, 0, 2, 4, 3, 1};
+
+// What compiling and running a program with a configuration gave.
+struct Result {
+  std::string status;
+  // The checksum, when the status is "ok".
+  std::string checksum;
+};
+
+bool ReadFile(const std::string& file, std::string *text) {
+  std::ifstream in(file.c_str());
+  if (!in.is_open()) return false;
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  *text = buffer.str();
+  return true;
+}
+
+// FNV-1a, continuing from hash.
+unsigned long long HashText(const std::string& text,
+    unsigned long long hash = 0xcbf29ce484222325ULL) {
+  for (char c : text) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Hashes the headers the text includes, and those they include, if they are
+// found in one of the include directories.
+unsigned long long HashIncludes(const std::string& text,
+    const std::vector<std::string>& includes, std::set<std::string> *seen,
+    unsigned long long hash) {
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string::npos || line[pos] != '#') continue;
+    pos = line.find("include", pos);
+    if (pos == std::string::npos) continue;
+    size_t start = line.find_first_of("\"<", pos);
+    if (start == std::string::npos) continue;
+    size_t end = line.find_first_of("\">", start + 1);
+    if (end == std::string::npos) continue;
+    std::string name = line.substr(start + 1, end - start - 1);
+    if (!seen->insert(name).second) continue;
+    for (const std::string& dir : includes) {
+      std::string header;
+      if (!ReadFile(dir + "/" + name, &header)) continue;
+      hash = HashText(name, HashText(header, hash));
+      hash = HashIncludes(header, includes, seen, hash);
+      break;
+    }
+  }
+  return hash;
+}
+
+std::string FormatHash(unsigned long long hash) {
+  std::ostringstream ss;
+  ss << std::hex << std::setfill('0') << std::setw(16) << hash;
+  return ss.str();
+}
+
+// The version the compiler of the configuration prints, or an empty string.
+std::string GetCompilerVersion(const std::string& configuration,
+    const std::string& scratch) {
+  std::string compiler = configuration.substr(0,
+      configuration.find_first_of(" \t"));
+  CLSmith::CommandResult result =
+      CLSmith::RunCommand(compiler + " --version", scratch, 10000, 0);
+  std::string version;
+  if (result.status == CLSmith::CommandResult::kExited && !result.code)
+    ReadFile(scratch, &version);
+  std::remove(scratch.c_str());
+  return version;
+}
+
+// The checksum printed by a csmith program, as "checksum = <value>".
+bool FindChecksum(const std::string& output, std::string *checksum) {
+  size_t pos = output.rfind("checksum = ");
+  if (pos == std::string::npos) return false;
+  pos += strlen("checksum = ");
+  size_t end = output.find_first_of("\r\n", pos);
+  *checksum = output.substr(pos, end == std::string::npos ? end : end - pos);
+  return !checksum->empty();
+}
+
+// Compiles the program to exe, unless it is there already, and runs it. Only
+// called in a child process.
+void CompileAndRun(const std::string& command, const std::string& exe,
+    bool keep, const std::string& scratch, long compile_timeout,
+    long run_timeout, Result *result) {
+  if (access(exe.c_str(), X_OK)) {
+    // Compiled under another name, so a compilation cut short is never taken
+    // for a compiled program.
+    std::ostringstream partial;
+    partial << exe << "." << getpid() << ".tmp";
+    CLSmith::CommandResult compiled = CLSmith::RunCommand(
+        command + " -o " + partial.str(), scratch, compile_timeout, 0);
+    if (compiled.status == CLSmith::CommandResult::kTimedOut) {
+      result->status = "compile_timeout";
+    } else if (compiled.status != CLSmith::CommandResult::kExited ||
+        compiled.code || std::rename(partial.str().c_str(), exe.c_str())) {
+      result->status = "compile_error";
+    }
+    std::remove(partial.str().c_str());
+    if (!result->status.empty()) return;
+  }
+  CLSmith::CommandResult ran = CLSmith::RunCommand(
+      exe.find('/') == std::string::npos ? "./" + exe : exe, scratch,
+      run_timeout, 0);
+  if (!keep) std::remove(exe.c_str());
+  std::string output;
+  ReadFile(scratch, &output);
+  if (ran.status == CLSmith::CommandResult::kTimedOut)
+    result->status = "timeout";
+  else if (ran.status != CLSmith::CommandResult::kExited || ran.code)
+    result->status = "crash";
+  else if (!FindChecksum(output, &result->checksum))
+    result->status = "no_checksum";
+  else
+    result->status = "ok";
+}
+
+Verdict Judge(const std::vector<Result>& results) {
+  std::set<std::string> checksums;
+  Verdict verdict = kPass;
+  for (const Result& result : results) {
+    Verdict found = kPass;
+    if (result.status == "compile_error") found = kCompilerCrash;
+    else if (result.status == "compile_timeout") found = kCompilerHang;
+    else if (result.status == "crash" || result.status == "no_checksum")
+      found = kProgramCrash;
+    else if (result.status == "timeout") found = kProgramHang;
+    else checksums.insert(result.checksum);
+    verdict = std::max(verdict, found);
+  }
+  if (checksums.size() > 1) verdict = std::max(verdict, kWrongCode);
+  return verdict;
+}
+
+void Usage() {
+  std::cout << "usage: difftest [--cache DIR] [--cflags FLAGS] "
+               "[--compile_timeout N] [--compiler CMD]... [--compilers FILE] "
+               "[--include DIR]... [--jobs N] [--run_timeout N] "
+               "[--verdicts FILE] programs..." << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string cache;
+  std::string cflags;
+  long compile_timeout = 120000;
+  long run_timeout = 8000;
+  std::vector<std::string> configurations;
+  std::vector<std::string> includes;
+  std::string verdicts_file;
+  std::vector<std::string> programs;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string arg = argv[idx];
+    if (arg.compare(0, 2, "--") != 0) {
+      programs.push_back(arg);
+      continue;
+    }
+    if (++idx >= argc) {
+      Usage();
+      return kUsageError;
+    }
+    if (arg == "--cache") {
+      cache = argv[idx];
+    } else if (arg == "--cflags") {
+      cflags = argv[idx];
+    } else if (arg == "--compile_timeout") {
+      compile_timeout = strtol(argv[idx], NULL, 10) * 1000;
+    } else if (arg == "--compiler") {
+      configurations.push_back(argv[idx]);
+    } else if (arg == "--compilers") {
+      std::ifstream list(argv[idx]);
+      if (!list.is_open()) {
+        std::cout << "Cannot read " << argv[idx] << "." << std::endl;
+        return kUsageError;
+      }
+      std::string line;
+      while (std::getline(list, line))
+        if (!line.empty() && line[0] != '#') configurations.push_back(line);
+    } else if (arg == "--include") {
+      includes.push_back(argv[idx]);
+    } else if (arg == "--jobs") {
+      jobs = std::max(1ul, strtoul(argv[idx], NULL, 10));
+    } else if (arg == "--run_timeout") {
+      run_timeout = strtol(argv[idx], NULL, 10) * 1000;
+    } else if (arg == "--verdicts") {
+      verdicts_file = argv[idx];
+    } else {
+      Usage();
+      return kUsageError;
+    }
+  }
+  if (configurations.empty() || programs.empty()) {
+    Usage();
+    return kUsageError;
+  }
+  if (includes.empty() && getenv("CSMITH_HOME"))
+    includes.push_back(std::string(getenv("CSMITH_HOME")) + "/runtime");
+  std::string include_flags;
+  for (const std::string& dir : includes) include_flags += " -I" + dir;
+
+  if (!cache.empty() && mkdir(cache.c_str(), 0755) && errno != EEXIST) {
+    std::cout << "Cannot create " << cache << "." << std::endl;
+    return kUsageError;
+  }
+
+  std::ofstream verdicts_out;
+  if (!verdicts_file.empty()) {
+    verdicts_out.open(verdicts_file.c_str(), std::ios::app);
+    if (!verdicts_out.is_open()) {
+      std::cout << "Cannot write " << verdicts_file << "." << std::endl;
+      return kUsageError;
+    }
+  }
+  std::ostream& verdicts = verdicts_file.empty() ? std::cout : verdicts_out;
+
+  // What the compilations depend on besides the program.
+  std::vector<unsigned long long> configuration_hashes;
+  for (const std::string& configuration : configurations) {
+    std::string version = GetCompilerVersion(configuration,
+        programs[0] + ".version");
+    configuration_hashes.push_back(HashText(version,
+        HashText(configuration + cflags + include_flags)));
+  }
+
+  Verdict worst = kPass;
+  for (const std::string& program : programs) {
+    std::string text;
+    if (!ReadFile(program, &text)) {
+      std::cout << "Cannot read " << program << ", skipped." << std::endl;
+      continue;
+    }
+    std::set<std::string> seen;
+    unsigned long long program_hash =
+        HashIncludes(text, includes, &seen, HashText(text));
+
+    std::vector<Result> results(configurations.size());
+    size_t next = 0;
+    CLSmith::RunJobQueue(jobs, [&](std::function<bool()> *job) {
+      if (next == configurations.size()) return false;
+      size_t config = next++;
+      std::ostringstream scratch;
+      scratch << program << "." << config;
+      std::string exe = cache.empty() ? scratch.str() + ".exe" :
+          cache + "/" + FormatHash(HashText(FormatHash(program_hash),
+              configuration_hashes[config]));
+      std::string command = configurations[config] + " " + cflags +
+          include_flags + " -w " + program;
+      std::string scratch_file = scratch.str() + ".out";
+      std::string result_file = scratch.str() + ".result";
+      *job = [=]() {
+        Result result;
+        CompileAndRun(command, exe, !cache.empty(), scratch_file,
+            compile_timeout, run_timeout, &result);
+        std::remove(scratch_file.c_str());
+        std::ofstream out(result_file.c_str());
+        out << result.status << " " << result.checksum << std::endl;
+        return static_cast<bool>(out);
+      };
+      return true;
+    }, [&](size_t config, bool) {
+      std::ostringstream result_file;
+      result_file << program << "." << config << ".result";
+      std::ifstream in(result_file.str().c_str());
+      if (!(in >> results[config].status)) results[config].status = "crash";
+      in >> results[config].checksum;
+      in.close();
+      std::remove(result_file.str().c_str());
+    });
+
+    Verdict verdict = Judge(results);
+    verdicts << program << "\t" << kVerdictNames[verdict];
+    for (size_t config = 0; config < configurations.size(); ++config) {
+      const Result& result = results[config];
+      verdicts << "\t" << configurations[config] << "="
+               << (result.status == "ok" ? result.checksum : result.status);
+    }
+    verdicts << std::endl;
+    if (kVerdictExitCodes[verdict] && verdict > worst) worst = verdict;
+  }
+  return kVerdictExitCodes[worst];
+}
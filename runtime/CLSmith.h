@@ -1,8 +1,14 @@
 #ifndef RANDOM_RUNTIME_H
 #define RANDOM_RUNTIME_H
 
+/* Kernels generated with --safe_math_impl functions call inline functions
+ * rather than macros, which are cheaper to build. */
+#ifdef CLSMITH_SAFE_MATH_FUNCTIONS
+#include "cl_safe_math_functions.h"
+#else
 #include "cl_safe_math_macros.h"
 #include "safe_math_macros.h"
+#endif
 
 #ifdef NO_ATOMICS
 #define atomic_inc(x) -1
@@ -16,14 +22,6 @@
 #define atomic_noop() /* for sanity checking */
 #endif
 
-inline __attribute__((always_inline)) void 
-transparent_crc_no_string (uint64_t *crc64_context, uint64_t val)
-{
-  *crc64_context += val;
-}
-
-#define transparent_crc_(A, B, C, D) transparent_crc_no_string(A, B)
-
 inline __attribute__((always_inline)) uint32_t
 get_linear_group_id (void)
 {
@@ -45,4 +43,93 @@ get_linear_local_id (void)
     get_local_size(0) + get_local_id(0);
 }
 
+#ifndef CLSMITH_HASH_LANES
+
+/* By default, kernels declare a single uint64_t context, which is simply
+ * summed. */
+inline __attribute__((always_inline)) void 
+transparent_crc_no_string (uint64_t *crc64_context, uint64_t val)
+{
+  *crc64_context += val;
+}
+
+#define transparent_crc_(A, B, C, D) transparent_crc_no_string(A, B)
+
+#else
+
+/* With --hash_lanes, the result of the kernel is hashed into
+ * CLSMITH_HASH_LANES independent accumulators, so that consecutive values do
+ * not form a single dependency chain. The generator gives every call its lane
+ * as a constant, so the lanes can be kept in registers, and the hash does not
+ * depend on where the calls are in the source. Each value is mixed with a
+ * multiply-xorshift, making it much harder for two different wrong results to
+ * give the same hash. */
+inline __attribute__((always_inline)) uint64_t
+hash_mix (uint64_t hash, uint64_t val)
+{
+  hash ^= val * 0x9E3779B97F4A7C15UL;
+  hash ^= hash >> 32;
+  hash *= 0xD6E8FEB86659FD93UL;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+inline __attribute__((always_inline)) void
+hash_init (uint64_t *crc64_context)
+{
+  for (int i = 0; i < CLSMITH_HASH_LANES; ++i)
+    crc64_context[i] = 0xFFFFFFFFFFFFFFFFUL - i;
+}
+
+inline __attribute__((always_inline)) void
+hash_update (uint64_t *crc64_context, uint lane, uint64_t val)
+{
+  crc64_context[lane] = hash_mix(crc64_context[lane], val);
+}
+
+/* Combines the lanes into the final result. */
+inline __attribute__((always_inline)) uint64_t
+hash_finish (const uint64_t *crc64_context)
+{
+  uint64_t hash = 0;
+  for (int i = 0; i < CLSMITH_HASH_LANES; ++i)
+    hash = hash_mix(hash, crc64_context[i]);
+  return hash;
+}
+
+#define transparent_crc_lane_(A, L, B, C, D) hash_update(A, L, B)
+
+/* Reduces the hash of every work item in the group into a single value, which
+ * is added to the context of all of them. scratch must hold a value for each
+ * work item in the group. Must be reached by the whole group. */
+inline __attribute__((always_inline)) void
+hash_reduce_group (uint64_t *crc64_context, __local uint64_t *scratch,
+    uint64_t val)
+{
+  uint lid = get_linear_local_id();
+  uint size = get_local_size(0) * get_local_size(1) * get_local_size(2);
+  scratch[lid] = val;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  for (uint stride = 1; stride < size; stride <<= 1) {
+    if (lid % (2 * stride) == 0 && lid + stride < size)
+      scratch[lid] = hash_mix(scratch[lid], scratch[lid + stride]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  hash_update(crc64_context, 0, scratch[0]);
+  /* Keep scratch alive until everyone has read the result. */
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/* Hashes all SIZE items of a local buffer cooperatively: each work item hashes
+ * a strided slice, then the slices are reduced across the group. */
+#define hash_local_buffer(A, SCRATCH, BUF, SIZE) do { \
+    uint64_t hash_slice = 0; \
+    for (uint hash_i = get_linear_local_id(); hash_i < (SIZE); \
+        hash_i += get_local_size(0) * get_local_size(1) * get_local_size(2)) \
+      hash_slice = hash_mix(hash_slice, (uint64_t)(BUF)[hash_i]); \
+    hash_reduce_group(A, SCRATCH, hash_slice); \
+  } while (0)
+
+#endif
+
 #endif /* RANDOM_RUNTIME_H */
@@ -3,6 +3,13 @@ dnl Each macro usually has a variant for each of the 4 basic signed types, when
 dnl further combined with 4 vector sizes, this would lead to 20 different macros
 dnl for each function. To prevent this, we bundle a runtime type in as a
 dnl parameter for the macro.
+dnl
+dnl When processed with -DSAFE_MATH_FUNCTIONS, the file outputs always_inline
+dnl functions instead, both for these macros and for the ones of
+dnl safe_math_macros.m4. A function cannot take a type, so the built-in ones
+dnl have a variant for each type and vector size. Kernels select them by
+dnl defining CLSMITH_SAFE_MATH_FUNCTIONS.
+ifdef(`SAFE_MATH_FUNCTIONS', `divert(-1)')dnl
 
 define(`safe_signed_math',`
 
@@ -99,3 +106,288 @@ define(`safe_math',`
 ')
 
 safe_math()
+ifdef(`SAFE_MATH_FUNCTIONS', `divert(0)dnl', `m4exit')
+dnl The functions compute the same values as the macros, and have the same
+dnl result types, which is the promoted type for the small scalars. They do
+dnl not branch: an operation that is not safe is made safe by replacing an
+dnl operand with one giving the fallback value (adding 0, dividing by 1,
+dnl shifting by 0, ...), which is picked with select. Overflows are found with
+dnl the saturating and high half built-ins, which never overflow themselves.
+
+#ifndef CL_SAFE_MATH_FUNCTIONS_H
+#define CL_SAFE_MATH_FUNCTIONS_H
+
+define(`promote',
+`ifelse($1,char,int,$1,uchar,int,$1,short,int,$1,ushort,int,$1)')
+define(`promote_unsigned',`ifelse($1,64,ulong,uint)')
+define(`sign_bit',`ifelse($1,8,`(1 << 7)',$1,16,`(1 << 15)',`$2')')
+
+dnl $1: C type name, $2: OpenCL type, $3: unsigned OpenCL type, $4: bits,
+dnl $5: minimum, $6: maximum.
+define(`safe_signed_functions',`
+inline __attribute__((always_inline)) promote($2)
+safe_unary_minus_func_$1_s($2 si)
+{
+  /* Wraps the minimum to itself, which is what the macro falls back to. */
+  return as_$2(($3)(0 - ($3)si));
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_add_func_$1_s_s($2 si1, $2 si2)
+{
+  /* Subtracting si2 again only gives si1 back if nothing was saturated. */
+  $2 ovf = add_sat(si1, si2) - si2 != si1;
+  return si1 + select(si2, ($2)0, ovf);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_sub_func_$1_s_s($2 si1, $2 si2)
+{
+  /* The test of the macro, on the same promoted values, so the result is the
+   * one the macro gives. */
+  $2 ovf = ((si1 ^ si2) &
+      (((si1 ^ ((si1 ^ si2) & sign_bit($4,$5))) - si2) ^ si2)) < 0;
+  return si1 - select(si2, ($2)0, ovf);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_mul_func_$1_s_s($2 si1, $2 si2)
+{
+  /* The product fits if its high half only extends the sign of the low one. */
+  $3 lo = ($3)((promote_unsigned($4))si1 * (promote_unsigned($4))si2);
+  $2 ovf = mul_hi(si1, si2) != -($2)(lo >> ($4 - 1));
+  return si1 * select(si2, ($2)1, ovf);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_mod_func_$1_s_s($2 si1, $2 si2)
+{
+  $2 c = (si2 == 0) | ((si1 == $5) & (si2 == -1));
+  return select(($2)(si1 % select(si2, ($2)1, c)), si1, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_div_func_$1_s_s($2 si1, $2 si2)
+{
+  $2 c = (si2 == 0) | ((si1 == $5) & (si2 == -1));
+  return si1 / select(si2, ($2)1, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_lshift_func_$1_s_s($2 left, int right)
+{
+  /* Clamping the shift first keeps the test of the left operand defined. */
+  int big = (right < 0) | (right >= $4);
+  int sh = select(right, 0, big);
+  int c = big | (left < 0) | (left > ($6 >> sh));
+  /* Even a shift by 0 is undefined on a negative value, so 0 is shifted. */
+  $2 shifted = select(left, ($2)0, ($2)c) << sh;
+  return select(shifted, left, ($2)c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_lshift_func_$1_s_u($2 left, uint right)
+{
+  uint big = right >= $4;
+  uint sh = select(right, 0u, big);
+  uint c = big | (left < 0) | (left > ($6 >> sh));
+  $2 shifted = select(left, ($2)0, ($2)c) << sh;
+  return select(shifted, left, ($2)c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_rshift_func_$1_s_s($2 left, int right)
+{
+  int c = (left < 0) | (right < 0) | (right >= $4);
+  return left >> select(right, 0, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_rshift_func_$1_s_u($2 left, uint right)
+{
+  uint c = (left < 0) | (right >= $4);
+  return left >> select(right, 0u, c);
+}
+')
+
+safe_signed_functions(int8_t,char,uchar,8,INT8_MIN,INT8_MAX)
+safe_signed_functions(int16_t,short,ushort,16,INT16_MIN,INT16_MAX)
+safe_signed_functions(int32_t,int,uint,32,INT32_MIN,INT32_MAX)
+safe_signed_functions(int64_t,long,ulong,64,INT64_MIN,INT64_MAX)
+
+dnl $1: C type name, $2: OpenCL type, $3: bits, $4: maximum.
+define(`safe_unsigned_functions',`
+inline __attribute__((always_inline)) promote($2)
+safe_unary_minus_func_$1_u($2 ui)
+{
+  return -ui;
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_add_func_$1_u_u($2 ui1, $2 ui2)
+{
+  return ui1 + ui2;
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_sub_func_$1_u_u($2 ui1, $2 ui2)
+{
+  return ui1 - ui2;
+}
+
+inline __attribute__((always_inline)) $2
+safe_mul_func_$1_u_u($2 ui1, $2 ui2)
+{
+  return ($2)((promote_unsigned($3))ui1 * (promote_unsigned($3))ui2);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_mod_func_$1_u_u($2 ui1, $2 ui2)
+{
+  $2 c = ui2 == 0;
+  return select(($2)(ui1 % (ui2 | c)), ui1, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_div_func_$1_u_u($2 ui1, $2 ui2)
+{
+  $2 c = ui2 == 0;
+  return ui1 / (ui2 | c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_lshift_func_$1_u_s($2 left, int right)
+{
+  int big = (right < 0) | (right >= $3);
+  int sh = select(right, 0, big);
+  int c = big | (left > ($4 >> sh));
+  return left << select(sh, 0, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_lshift_func_$1_u_u($2 left, uint right)
+{
+  uint big = right >= $3;
+  uint sh = select(right, 0u, big);
+  uint c = big | (left > ($4 >> sh));
+  return left << select(sh, 0u, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_rshift_func_$1_u_s($2 left, int right)
+{
+  int c = (right < 0) | (right >= $3);
+  return left >> select(right, 0, c);
+}
+
+inline __attribute__((always_inline)) promote($2)
+safe_rshift_func_$1_u_u($2 left, uint right)
+{
+  uint c = right >= $3;
+  return left >> select(right, 0u, c);
+}
+')
+
+safe_unsigned_functions(uint8_t,uchar,8,UINT8_MAX)
+safe_unsigned_functions(uint16_t,ushort,16,UINT16_MAX)
+safe_unsigned_functions(uint32_t,uint,32,UINT32_MAX)
+safe_unsigned_functions(uint64_t,ulong,64,UINT64_MAX)
+
+dnl The built-in functions also take vectors, where a comparison gives -1 rather
+dnl than 1 in the lanes where it holds. select wants a condition of the size of
+dnl the operands, which a vector comparison already is.
+define(`for_widths',`$1($2,$3,$4,$5,$6,`')$1($2,$3,$4,$5,$6,2)dnl
+$1($2,$3,$4,$5,$6,4)$1($2,$3,$4,$5,$6,8)$1($2,$3,$4,$5,$6,16)')
+define(`condition',`ifelse($2,,`($1)($3)',`($3)')')
+define(`sign_mask',`ifelse($1,,`-($2)',`($2)')')
+
+dnl $1: C type name, $2: OpenCL type, $3: unsigned OpenCL type, $4: minimum,
+dnl $5: maximum, $6: vector size, empty for scalars.
+define(`safe_mad_hi_function',`
+inline __attribute__((always_inline)) promote($2$6)
+safe_mad_hi_func_$1$6_s_s_s($2$6 si1, $2$6 si2, $2$6 si3)
+{
+  $2$6 tmp = mul_hi(si1, si2);
+  $2$6 c = condition($2,$6,add_sat(tmp, si3) - si3 != tmp);
+  return select(mad_hi(si1, si2, select(si3, ($2$6)0, c)), si1, c);
+}
+')
+
+for_widths(`safe_mad_hi_function',int8_t,char,uchar,INT8_MIN,INT8_MAX)
+for_widths(`safe_mad_hi_function',int16_t,short,ushort,INT16_MIN,INT16_MAX)
+for_widths(`safe_mad_hi_function',int32_t,int,uint,INT32_MIN,INT32_MAX)
+for_widths(`safe_mad_hi_function',int64_t,long,ulong,INT64_MIN,INT64_MAX)
+
+dnl $1: C type name, $2: OpenCL type, $3: unsigned OpenCL type, $4: smallest
+dnl 24 bit value, $5: largest 24 bit value, $6: vector size, empty for scalars.
+define(`safe_signed_24bit_function',`
+inline __attribute__((always_inline)) $2$6
+safe_mul24_func_$1$6_s_s($2$6 si1, $2$6 si2)
+{
+  $2$6 lo = as_$2$6(as_$3$6(si1) * as_$3$6(si2));
+  $2$6 c = condition($2,$6,(si1 < ($4)) | (si1 > ($5)) | (si2 < ($4)) |
+      (si2 > ($5)) | (mul_hi(si1, si2) != sign_mask($6,lo < 0)));
+  return select(mul24(si1, si2), si1, c);
+}
+
+inline __attribute__((always_inline)) $2$6
+safe_mad24_func_$1$6_s_s_s($2$6 si1, $2$6 si2, $2$6 si3)
+{
+  $2$6 lo = as_$2$6(as_$3$6(si1) * as_$3$6(si2));
+  $2$6 c = condition($2,$6,(si1 < ($4)) | (si1 > ($5)) | (si2 < ($4)) |
+      (si2 > ($5)) | (mul_hi(si1, si2) != sign_mask($6,lo < 0)) |
+      (add_sat(lo, si3) - si3 != lo));
+  return select(mad24(si1, si2, select(si3, ($2$6)0, c)), si1, c);
+}
+')
+
+for_widths(`safe_signed_24bit_function',int32_t,int,uint,-(1<<23),(1<<23)-1)
+
+dnl $1: C type name, $2: OpenCL type, $3: largest 24 bit value, $6: vector size,
+dnl empty for scalars.
+define(`safe_unsigned_24bit_function',`
+inline __attribute__((always_inline)) $2$6
+safe_mul24_func_$1$6_u_u($2$6 ui1, $2$6 ui2)
+{
+  return select(mul24(ui1, ui2), ui1,
+      condition($2,$6,(ui1 > ($3)) | (ui2 > ($3))));
+}
+
+inline __attribute__((always_inline)) $2$6
+safe_mad24_func_$1$6_u_u_u($2$6 ui1, $2$6 ui2, $2$6 ui3)
+{
+  return select(mad24(ui1, ui2, ui3), ui1,
+      condition($2,$6,(ui1 > ($3)) | (ui2 > ($3))));
+}
+')
+
+for_widths(`safe_unsigned_24bit_function',uint32_t,uint,1<<24)
+
+dnl clamp is min(max(x, y), z), which is defined whatever the bounds are. The
+dnl bounds are either of the type of x or of its element type, which are
+dnl spread to all of the lanes.
+dnl $1: C type name, $2: OpenCL type, $6: vector size, empty for scalars.
+define(`safe_clamp_function',`
+inline __attribute__((always_inline)) promote($2$6)
+safe_clamp_func_$1$6_$1$6($2$6 x, $2$6 y, $2$6 z)
+{
+  return select(min(max(x, y), z), x, condition($2,$6,y > z));
+}
+ifelse($6,,,`
+inline __attribute__((always_inline)) $2$6
+safe_clamp_func_$1$6_$1($2$6 x, $2 y, $2 z)
+{
+  return safe_clamp_func_$1$6_$1$6(x, ($2$6)(y), ($2$6)(z));
+}
+')')
+
+for_widths(`safe_clamp_function',int8_t,char)
+for_widths(`safe_clamp_function',uint8_t,uchar)
+for_widths(`safe_clamp_function',int16_t,short)
+for_widths(`safe_clamp_function',uint16_t,ushort)
+for_widths(`safe_clamp_function',int32_t,int)
+for_widths(`safe_clamp_function',uint32_t,uint)
+for_widths(`safe_clamp_function',int64_t,long)
+for_widths(`safe_clamp_function',uint64_t,ulong)
+
+#endif
@@ -0,0 +1,104 @@
+#!/usr/bin/python
+
+# Groups generated programs that are near duplicates of each other, using the
+# fingerprint index written by CLSmith --fingerprint <index>.
+#
+# Each line of the index is "<simhash> <exact hash> <seed> <program file>".
+# Programs with the same exact hash have the same normalised AST. Programs whose
+# SimHashes differ in at most -distance bits are near duplicates. To avoid
+# comparing every pair, the 64 bits are split into distance + 1 bands: two
+# hashes within the distance agree on at least one whole band, so only programs
+# sharing a band are compared.
+
+import argparse
+import collections
+import sys
+
+parser = argparse.ArgumentParser("Group near duplicate programs by fingerprint.")
+
+parser.add_argument('index', help = "Fingerprint index written by CLSmith.")
+parser.add_argument('-distance', default = 3, type = int,
+                    help = "Largest number of differing SimHash bits.")
+parser.add_argument('-bugs', default = None,
+                    help = "File listing the programs that triggered a bug, "
+                           "only the groups containing one are reported.")
+parser.add_argument('-keep', action = 'store_true',
+                    help = "Only print one program of every group, the ones "
+                           "worth running.")
+
+args = parser.parse_args()
+
+if args.distance < 0 or args.distance > 63:
+  print("The distance must be between 0 and 63.")
+  exit(1)
+
+programs = []
+for line in open(args.index):
+  fields = line.split()
+  if len(fields) < 4:
+    continue
+  programs.append((int(fields[0], 16), fields[1], fields[2],
+                   ' '.join(fields[3:])))
+
+parent = list(range(len(programs)))
+
+def find(idx):
+  while parent[idx] != idx:
+    parent[idx] = parent[parent[idx]]
+    idx = parent[idx]
+  return idx
+
+def union(lhs, rhs):
+  lhs = find(lhs)
+  rhs = find(rhs)
+  if lhs != rhs:
+    parent[max(lhs, rhs)] = min(lhs, rhs)
+
+# Identical structures first, they need no comparison.
+first_exact = dict()
+for idx, program in enumerate(programs):
+  union(first_exact.setdefault(program[1], idx), idx)
+
+bands = args.distance + 1
+band_bits = [64 * band // bands for band in range(bands + 1)]
+comparisons = 0
+for band in range(bands):
+  low = band_bits[band]
+  mask = (1 << (band_bits[band + 1] - low)) - 1
+  buckets = collections.defaultdict(list)
+  for idx, program in enumerate(programs):
+    buckets[(program[0] >> low) & mask].append(idx)
+  for bucket in buckets.values():
+    for pos, idx in enumerate(bucket):
+      for other in bucket[pos + 1:]:
+        if find(idx) == find(other):
+          continue
+        comparisons += 1
+        if bin(programs[idx][0] ^ programs[other][0]).count('1') <= args.distance:
+          union(idx, other)
+
+groups = collections.defaultdict(list)
+for idx in range(len(programs)):
+  groups[find(idx)].append(idx)
+
+bugs = None
+if args.bugs:
+  bugs = set(line.strip() for line in open(args.bugs) if line.strip())
+
+ordered = sorted(groups.values(), key = lambda group: (-len(group), group[0]))
+if bugs is not None:
+  ordered = [group for group in ordered
+             if any(programs[idx][3] in bugs for idx in group)]
+
+if args.keep:
+  for group in ordered:
+    print(programs[group[0]][3])
+  exit(0)
+
+for number, group in enumerate(ordered):
+  print("Group %d: %d programs" % (number, len(group)))
+  for idx in group:
+    marker = " (bug)" if bugs is not None and programs[idx][3] in bugs else ""
+    print("  %s seed %s%s" % (programs[idx][3], programs[idx][2], marker))
+sys.stderr.write("%d programs in %d groups, %d comparisons.\n" %
+                 (len(programs), len(ordered), comparisons))
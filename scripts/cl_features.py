@@ -0,0 +1,108 @@
+#!/usr/bin/python
+
+# Reads the feature file written by CLSmith --features <file>, and prints it as
+# CSV, one row per program.
+#
+# The file starts with "CLSFEAT1", the number of columns as a 32-bit integer
+# and the NUL terminated column names, followed by fixed width rows: the 64-bit
+# seed then a 32-bit count per column, all little-endian. With -index, the
+# outcome of every program is taken from the index of a campaign corpus (lines
+# of "<checksum> <seed> <outcome>"), so features can be related to outcomes.
+#
+# With -check, the counts that can be recognised in the text of a kernel are
+# checked against the row of its seed instead, for every kernel given.
+
+import argparse
+import re
+import struct
+import sys
+
+# Columns checked by -check, with the pattern counted in the text of a kernel.
+# An atomic block is guarded by an atomic operation on the atomic inputs, and
+# a reduction is an atomic operation on the reduction buffers.
+checked_columns = [
+  ('atomic_blocks', re.compile(r'atomic_\w+\(&[\w>.-]*[lg]_atomic_input\[')),
+  ('atomic_reductions',
+   re.compile(r'atomic_\w+\(&[\w>.-]*[lg]_atomic_reduction\[')),
+]
+
+parser = argparse.ArgumentParser("Print the features of generated programs.")
+
+parser.add_argument('features', help = "Feature file written by CLSmith.")
+parser.add_argument('-index', default = None,
+                    help = "Campaign index giving the outcome of every seed.")
+parser.add_argument('-columns', default = None,
+                    help = "Comma separated columns to print, all by default.")
+parser.add_argument('-check', nargs = '+', default = None,
+                    help = "Kernels to check the counts of against the file.")
+
+args = parser.parse_args()
+
+data = open(args.features, 'rb').read()
+if data[:8] != b'CLSFEAT1':
+  print("{0} is not a feature file.".format(args.features))
+  exit(1)
+(num_columns,) = struct.unpack_from('<I', data, 8)
+offset = 12
+names = []
+for _ in range(num_columns):
+  end = data.index(b'\0', offset)
+  names.append(data[offset:end].decode())
+  offset = end + 1
+
+selected = list(range(num_columns))
+if args.columns:
+  try:
+    selected = [names.index(name) for name in args.columns.split(',')]
+  except ValueError as error:
+    print("Unknown column: {0}".format(error))
+    exit(1)
+
+outcomes = {}
+if args.index:
+  for line in open(args.index):
+    fields = line.split()
+    if len(fields) == 3:
+      outcomes[int(fields[1])] = fields[2]
+
+row = struct.Struct('<Q{0}I'.format(num_columns))
+
+if args.check:
+  rows = {}
+  for start in range(offset, len(data) - row.size + 1, row.size):
+    values = row.unpack_from(data, start)
+    rows[values[0]] = values[1:]
+  mismatches = 0
+  for kernel in args.check:
+    text = open(kernel).read()
+    seed = re.search(r'^// Seed: (\d+)$', text, re.MULTILINE)
+    if not seed or int(seed.group(1)) not in rows:
+      print("{0}: no row for the seed of the kernel.".format(kernel))
+      mismatches += 1
+      continue
+    counts = rows[int(seed.group(1))]
+    for name, pattern in checked_columns:
+      expected = len(pattern.findall(text))
+      actual = counts[names.index(name)]
+      if actual != expected:
+        print("{0}: {1} is {2}, the kernel has {3}.".format(
+            kernel, name, actual, expected))
+        mismatches += 1
+  if mismatches:
+    exit(1)
+  print("The counts of {0} kernels match.".format(len(args.check)))
+  exit(0)
+
+header = ['seed'] + [names[idx] for idx in selected]
+if args.index:
+  header.append('outcome')
+sys.stdout.write(','.join(header) + '\n')
+for start in range(offset, len(data) - row.size + 1, row.size):
+  values = row.unpack_from(data, start)
+  seed = values[0]
+  if args.index and seed not in outcomes:
+    continue
+  line = [str(seed)] + [str(values[idx + 1]) for idx in selected]
+  if args.index:
+    line.append(outcomes[seed])
+  sys.stdout.write(','.join(line) + '\n')
@@ -559,11 +559,13 @@ Block::contains_back_edge(void) const
 {
 	if (func != 0) {
 		FactMgr* fm = get_fact_mgr_for_func(func);
-		size_t i;
-		for (i=0; i<fm->cfg_edges.size(); i++) {
-			const CFGEdge* edge = fm->cfg_edges[i];
-			if (edge->back_link && edge->dest->parent == this) {
-				return true;
+		size_t i, j;
+		for (i=0; i<stms.size(); i++) {
+			const vector<const CFGEdge*>& edges = fm->find_cfg_edges_in(stms[i]);
+			for (j=0; j<edges.size(); j++) {
+				if (edges[j]->back_link) {
+					return true;
+				}
 			}
 		}
 	}
@@ -694,8 +696,7 @@ Block::remove_stmt(const Statement* s)
 		for (i=0; i<len; i++) {
 			const CFGEdge* edge = fm->cfg_edges[i]; 
 			if (find_stm_in_set(cfg_stms, edge->src) >= 0) {
-				fm->cfg_edges.erase(fm->cfg_edges.begin() + i);
-				delete edge;
+				fm->remove_cfg_edge(i);
 				i--;
 				len--;
 			} 
@@ -708,8 +709,7 @@ Block::remove_stmt(const Statement* s)
 		const CFGEdge* edge = fm->cfg_edges[i]; 
 		const Statement* src = edge->src;
 		if (s->contains_stmt(edge->dest)) {
-			fm->cfg_edges.erase(fm->cfg_edges.begin() + i);
-			delete edge;
+			fm->remove_cfg_edge(i);
 			i--;
 			len--;
 			// delete the source statement (most likely goto) as well
@@ -0,0 +1,350 @@
+#include "CLSmith/BarrierPlacement.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ArrayVariable.h"
+#include "Block.h"
+#include "CLSmith/CLExpression.h"
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CostModel.h"
+#include "CLSmith/ExpressionID.h"
+#include "CLSmith/ExpressionVector.h"
+#include "CLSmith/Globals.h"
+#include "CLSmith/MemoryBuffer.h"
+#include "CLSmith/StatementBarrier.h"
+#include "Effect.h"
+#include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
+#include "ExpressionVariable.h"
+#include "FactMgr.h"
+#include "Function.h"
+#include "FunctionInvocation.h"
+#include "FunctionInvocationUser.h"
+#include "Lhs.h"
+#include "random.h"
+#include "Statement.h"
+#include "StatementArrayOp.h"
+#include "StatementFor.h"
+#include "StatementIf.h"
+#include "Variable.h"
+
+namespace CLSmith {
+namespace {
+// Positions run more than this many times by a work item are not given a
+// barrier, to keep the cost of the kernel down.
+const double kMaxBarrierExecutions = 1024;
+
+// Returns the variable that the given variable is an item or field of.
+const Variable *GetRootVariable(const Variable *variable) {
+  while (true) {
+    variable = variable->get_collective();
+    if (variable->field_var_of == NULL) return variable;
+    variable = variable->field_var_of;
+  }
+}
+}  // namespace
+
+void UniformityAnalysis::Analyse() {
+  all_data_varying_ =
+      CLOptions::inter_thread_comm() || CLOptions::message_passing();
+  do {
+    changed_ = false;
+    uniform_blocks_.clear();
+    block_executions_.clear();
+    function_executions_[GetFirstFunction()] = 1;
+    for (const Function *function : get_all_functions())
+      AnalyseFunction(function);
+  } while (changed_);
+}
+
+bool UniformityAnalysis::IsUniform(const Block *block) const {
+  return uniform_blocks_.count(block);
+}
+
+double UniformityAnalysis::GetExecutions(const Block *block) const {
+  auto it = block_executions_.find(block);
+  return it != block_executions_.end() ? it->second : 0;
+}
+
+void UniformityAnalysis::AnalyseFunction(const Function *function) {
+  auto it = function_executions_.find(function);
+  // Not called (yet).
+  if (it == function_executions_.end()) return;
+  AnalyseBlock(function, function->body, varying_functions_.count(function) ||
+      varying_exits_.count(function), it->second);
+}
+
+void UniformityAnalysis::AnalyseBlock(const Function *function,
+    const Block *block, bool varying, double executions) {
+  if (!varying) uniform_blocks_.insert(block);
+  double& block_executions = block_executions_[block];
+  block_executions = std::max(block_executions, executions);
+  for (const Statement *statement : block->stms)
+    AnalyseStatement(function, statement, varying, executions);
+}
+
+void UniformityAnalysis::AnalyseStatement(const Function *function,
+    const Statement *statement, bool varying, double executions) {
+  // The effect of the statement tells us what it may read and write through
+  // pointers.
+  FactMgr *fm = get_fact_mgr_for_func(function);
+  const Effect *effect = NULL;
+  if (fm != NULL) {
+    auto it = fm->map_stm_effect.find(statement);
+    if (it != fm->map_stm_effect.end()) effect = &it->second;
+  }
+  bool deref_varying = all_data_varying_ || effect == NULL;
+  if (effect != NULL)
+    for (const Variable *var : effect->get_read_vars())
+      if (varying_vars_.count(GetRootVariable(var))) deref_varying = true;
+
+  std::vector<const Expression *> exprs;
+  statement->get_exprs(exprs);
+  std::vector<const FunctionInvocationUser *> calls;
+  bool expr_varying = false;
+  for (const Expression *expr : exprs)
+    expr_varying |= IsVarying(expr, deref_varying, &calls);
+  bool divergent = varying || expr_varying;
+
+  // Calls made from divergent code, or in an expression that may be cut short
+  // by a varying value, may not be made by every work item.
+  for (const FunctionInvocationUser *call : calls) {
+    const Function *callee = call->get_func();
+    if (divergent) Insert(varying_functions_, callee);
+    // Capped, so that the analysis terminates even if the program recurses.
+    double& callee_executions = function_executions_[callee];
+    double new_executions = std::min(std::max(callee_executions, executions),
+        kMaxBarrierExecutions + 1);
+    if (new_executions > callee_executions) {
+      callee_executions = new_executions;
+      changed_ = true;
+    }
+    for (size_t idx = 0; idx < call->param_value.size() &&
+        idx < callee->param.size(); ++idx)
+      if (IsVarying(call->param_value[idx], deref_varying, NULL))
+        MarkVarying(callee->param[idx]);
+  }
+
+  // Anything written by only some of the work items, or with a varying value,
+  // is varying.
+  if (divergent) {
+    if (effect != NULL) {
+      for (const Variable *var : effect->get_write_vars()) MarkVarying(var);
+    } else {
+      for (const Expression *expr : exprs) MarkAssigned(expr);
+    }
+  }
+
+  switch (statement->get_type()) {
+    case eBlock:
+      AnalyseBlock(function, dynamic_cast<const Block *>(statement), varying,
+          executions);
+      return;
+    case eIfElse: {
+      const StatementIf *st_if = dynamic_cast<const StatementIf *>(statement);
+      AnalyseBlock(function, st_if->get_true_branch(), divergent, executions);
+      AnalyseBlock(function, st_if->get_false_branch(), divergent, executions);
+      return;
+    }
+    case eFor: {
+      const StatementFor *loop = dynamic_cast<const StatementFor *>(statement);
+      AnalyseBlock(function, loop->get_body(), divergent,
+          executions * CostModel::EstimateTripCount(loop));
+      return;
+    }
+    case eArrayOp: {
+      const StatementArrayOp *loop =
+          dynamic_cast<const StatementArrayOp *>(statement);
+      if (loop->body)
+        AnalyseBlock(function, loop->body, divergent,
+            executions * CostModel::EstimateTripCount(loop));
+      return;
+    }
+    case eReturn:
+      // A return may also leave the function early.
+      if (divergent) Insert(varying_returns_, function);
+      if (divergent) Insert(varying_exits_, function);
+      return;
+    case eContinue:
+    case eBreak:
+    case eGoto:
+      if (divergent) Insert(varying_exits_, function);
+      return;
+    case eCLStatement: {
+      // The OpenCL statements control their blocks themselves (EMI blocks are
+      // dead, atomic result blocks are run by a single work item).
+      std::vector<const Block *> blocks;
+      statement->get_blocks(blocks);
+      for (const Block *block : blocks)
+        AnalyseBlock(function, block, true, executions);
+      return;
+    }
+    default: return;
+  }
+}
+
+bool UniformityAnalysis::IsVarying(const Expression *expression,
+    bool deref_varying, std::vector<const FunctionInvocationUser *> *calls) {
+  switch (expression->term_type) {
+    case eConstant: return false;
+    case eVariable: {
+      const ExpressionVariable *expr_var =
+          dynamic_cast<const ExpressionVariable *>(expression);
+      if (expr_var->get_indirect_level() > 0 && deref_varying) return true;
+      return IsVaryingVariable(expr_var->get_var(), deref_varying, calls);
+    }
+    case eLhs: {
+      const Lhs *lhs = dynamic_cast<const Lhs *>(expression);
+      if (lhs->get_indirect_level() > 0 && deref_varying) return true;
+      return IsVaryingVariable(lhs->get_var(), deref_varying, calls);
+    }
+    case eFunction: {
+      const FunctionInvocation *invoke = expression->get_invoke();
+      bool varying = false;
+      for (const Expression *param : invoke->param_value)
+        varying |= IsVarying(param, deref_varying, calls);
+      const FunctionInvocationUser *call =
+          dynamic_cast<const FunctionInvocationUser *>(invoke);
+      if (call != NULL) {
+        if (calls != NULL) calls->push_back(call);
+        varying |= varying_returns_.count(call->get_func()) > 0;
+      }
+      return varying;
+    }
+    case eAssignment: {
+      const ExpressionAssign *assign =
+          dynamic_cast<const ExpressionAssign *>(expression);
+      bool varying = IsVarying(assign->get_lhs(), deref_varying, calls);
+      return IsVarying(assign->get_rhs(), deref_varying, calls) || varying;
+    }
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      bool varying = IsVarying(comma->get_lhs(), deref_varying, calls);
+      return IsVarying(comma->get_rhs(), deref_varying, calls) || varying;
+    }
+    case eCLExpression: {
+      const CLExpression *cl_expr =
+          dynamic_cast<const CLExpression *>(expression);
+      switch (cl_expr->GetCLExpressionType()) {
+        case CLExpression::kID: {
+          // Fake divergence and group ids evaluate to the same value in the
+          // whole group.
+          if (dynamic_cast<const ExpressionIDFakeDiverge *>(expression) ||
+              dynamic_cast<const ExpressionIDGroupDiverge *>(expression))
+            return false;
+          ExpressionID::IDType id_type =
+              dynamic_cast<const ExpressionID *>(expression)->GetIDType();
+          return id_type != ExpressionID::kGroup &&
+              id_type != ExpressionID::kLinearGroup;
+        }
+        case CLExpression::kVector: {
+          bool varying = false;
+          for (const auto& expr : dynamic_cast<const ExpressionVector *>(
+              expression)->GetExpressions())
+            varying |= IsVarying(expr.get(), deref_varying, calls);
+          return varying;
+        }
+        default: return true;
+      }
+    }
+    default: return true;
+  }
+}
+
+bool UniformityAnalysis::IsVaryingVariable(const Variable *variable,
+    bool deref_varying, std::vector<const FunctionInvocationUser *> *calls) {
+  if (all_data_varying_) return true;
+  bool varying = false;
+  // Items of arrays are varying if any of the indices are.
+  const ArrayVariable *array = dynamic_cast<const ArrayVariable *>(variable);
+  if (array != NULL && array->collective != NULL)
+    for (const Expression *index : array->get_indices())
+      varying |= IsVarying(index, deref_varying, calls);
+  const Variable *root = GetRootVariable(variable);
+  const MemoryBuffer *buffer = dynamic_cast<const MemoryBuffer *>(root);
+  if (buffer != NULL &&
+      (buffer->GetMemorySpace() == MemoryBuffer::kLocal ||
+      buffer->GetMemorySpace() == MemoryBuffer::kGlobal))
+    return true;
+  return varying || varying_vars_.count(root);
+}
+
+void UniformityAnalysis::MarkVarying(const Variable *variable) {
+  Insert(varying_vars_, GetRootVariable(variable));
+}
+
+void UniformityAnalysis::MarkAssigned(const Expression *expression) {
+  switch (expression->term_type) {
+    case eFunction:
+      for (const Expression *param : expression->get_invoke()->param_value)
+        MarkAssigned(param);
+      return;
+    case eAssignment: {
+      const ExpressionAssign *assign =
+          dynamic_cast<const ExpressionAssign *>(expression);
+      const Lhs *lhs = assign->get_lhs();
+      // Without the effect, there is no telling what a pointer points to.
+      if (lhs->get_indirect_level() > 0 && !all_data_varying_) {
+        all_data_varying_ = true;
+        changed_ = true;
+      }
+      MarkVarying(lhs->get_var());
+      MarkAssigned(assign->get_rhs());
+      return;
+    }
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      MarkAssigned(comma->get_lhs());
+      MarkAssigned(comma->get_rhs());
+      return;
+    }
+    default: return;
+  }
+}
+
+template <typename T>
+void UniformityAnalysis::Insert(std::set<T>& set, T item) {
+  if (set.insert(item).second) changed_ = true;
+}
+
+void PlaceBarriers(Globals *globals) {
+  assert(globals != NULL);
+  UniformityAnalysis analysis;
+  analysis.Analyse();
+  bool producer_consumer = CLOptions::barrier_producer_consumer();
+  bool placed_exchange = false;
+  for (Function *function : get_all_functions()) {
+    for (Block *block : function->blocks) {
+      if (!analysis.IsUniform(block) ||
+          analysis.GetExecutions(block) > kMaxBarrierExecutions)
+        continue;
+      // Rebuild the block, instead of inserting in place.
+      std::vector<Statement *> stms;
+      stms.reserve(block->stms.size());
+      for (Statement *statement : block->stms) {
+        if (rnd_upto(100) < (unsigned)CLOptions::barrier_density()) {
+          if (producer_consumer) {
+            stms.push_back(StatementBarrier::make_producer_consumer(block));
+            placed_exchange = true;
+          } else {
+            stms.push_back(new StatementBarrier(block,
+                StatementBarrier::ChooseFence()));
+          }
+        }
+        stms.push_back(statement);
+      }
+      block->stms.swap(stms);
+    }
+  }
+  if (placed_exchange)
+    globals->AddLocalMemoryBuffer(StatementBarrier::GetExchangeBuffer());
+}
+
+}  // namespace CLSmith
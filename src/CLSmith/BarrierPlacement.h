@@ -0,0 +1,111 @@
+// Placement of barriers in programs generated without divergence.
+// A barrier may only be placed where every work item in the group reaches it
+// the same number of times, so before placing any, the blocks that are run
+// uniformly are found by a simple data-flow analysis.
+//
+// A value is varying (may differ between work items in a group) if it comes
+// from:
+// - get_local_id/get_global_id, atomic operations or local/global buffers;
+// - a variable written with a varying value, or written by only some of the
+//   work items;
+// - a function returning a varying value, or a parameter given a varying
+//   argument.
+// A block is uniform if every enclosing test is not varying, the function it is
+// in is only called uniformly and has no varying jumps (break, continue, goto
+// or return), which could let some work items skip the rest of the function.
+// Analysis is done on whole variables, so an array is varying as soon as one of
+// its items is. This is pessimistic, but a barrier is never placed in divergent
+// code.
+//
+// The number of times each block is run is also estimated, using the trip
+// counts from the cost model, so that barriers are not placed in hot loops.
+
+#ifndef _CLSMITH_BARRIERPLACEMENT_H_
+#define _CLSMITH_BARRIERPLACEMENT_H_
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "CommonMacros.h"
+
+class Block;
+class Expression;
+class Function;
+class FunctionInvocationUser;
+class Statement;
+class Variable;
+namespace CLSmith { class Globals; }
+
+namespace CLSmith {
+
+// Finds the blocks that every work item in a group runs.
+class UniformityAnalysis {
+ public:
+  UniformityAnalysis() {}
+  ~UniformityAnalysis() {}
+
+  // Analyses every function in the program, until no more varying values are
+  // found.
+  void Analyse();
+
+  // Checks whether the block is run by all the work items in the group, or
+  // none of them.
+  bool IsUniform(const Block *block) const;
+
+  // Estimated number of times a work item runs the block.
+  double GetExecutions(const Block *block) const;
+
+ private:
+  void AnalyseFunction(const Function *function);
+  // The varying flag is set if the code is reached by only some work items.
+  void AnalyseBlock(const Function *function, const Block *block, bool varying,
+      double executions);
+  void AnalyseStatement(const Function *function, const Statement *statement,
+      bool varying, double executions);
+
+  // Checks if the expression may evaluate to different values in different
+  // work items. User function calls found are added to calls.
+  // deref_varying is used for values read through pointers.
+  bool IsVarying(const Expression *expression, bool deref_varying,
+      std::vector<const FunctionInvocationUser *> *calls);
+  bool IsVaryingVariable(const Variable *variable, bool deref_varying,
+      std::vector<const FunctionInvocationUser *> *calls);
+
+  // Marks the variable (or the variable it is part of) as varying.
+  void MarkVarying(const Variable *variable);
+  // Marks the variables assigned in the expression as varying, for statements
+  // with no recorded effect.
+  void MarkAssigned(const Expression *expression);
+  // Adds item to set, remembering whether anything changed.
+  template <typename T>
+  void Insert(std::set<T>& set, T item);
+
+  std::set<const Variable *> varying_vars_;
+  // Functions called from divergent code.
+  std::set<const Function *> varying_functions_;
+  std::set<const Function *> varying_returns_;
+  // Functions that some work items may leave early.
+  std::set<const Function *> varying_exits_;
+  std::map<const Function *, double> function_executions_;
+  std::set<const Block *> uniform_blocks_;
+  std::map<const Block *, double> block_executions_;
+  // Set when the values of variables cannot be tracked at all (e.g. other
+  // work items write to them).
+  bool all_data_varying_ = false;
+  bool changed_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(UniformityAnalysis);
+};
+
+// Inserts barriers at random positions in the uniform blocks of the program,
+// with the probability given by --barrier_density. Positions that are run too
+// many times are skipped. With --barrier_producer_consumer, producer/consumer
+// regions are placed instead of plain barriers.
+// Must be called once the globals have been created, as the exchange buffer
+// used by the producer/consumer regions is added to them.
+void PlaceBarriers(Globals *globals);
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_BARRIERPLACEMENT_H_
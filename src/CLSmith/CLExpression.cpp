@@ -5,6 +5,7 @@
 #include "CLSmith/CLOptions.h"
 #include "CLSmith/ExpressionAtomic.h"
 #include "CLSmith/ExpressionID.h"
+#include "CLSmith/FeedbackScheduler.h"
 #include "CLSmith/ExpressionVector.h"
 #include "ProbabilityTable.h"
 #include "random.h"
@@ -73,10 +74,13 @@ void CLExpression::InitProbabilityTable() {
   // All probabilities are added, even if the expression type is disabled. This
   // is because the probability of picking a CLExpression is fixed in
   // Expression, so not adding them would artificially increase the
-  // probabilities of other CLExpressions much more than desired.
+  // probabilities of other CLExpressions much more than desired. The feedback
+  // scheduler may make the expressions of one feature more likely.
   cl_expr_table = new DistributionTable();
-  cl_expr_table->add_entry(kID, 5);
-  cl_expr_table->add_entry(kVector, 10);
+  cl_expr_table->add_entry(kID,
+      FeedbackScheduler::ScaleWeight(FeedbackScheduler::kFakeDivergence, 5));
+  cl_expr_table->add_entry(kVector,
+      FeedbackScheduler::ScaleWeight(FeedbackScheduler::kVectors, 10));
   ExpressionVector::InitProbabilityTable();
 }
 
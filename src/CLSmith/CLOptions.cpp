@@ -1,8 +1,11 @@
 #include "CLSmith/CLOptions.h"
 
+#include <cstring>
 #include <iostream>
 
 #include "CGOptions.h"
+#include "CLSmith/FeedbackScheduler.h"
+#include "CLSmith/ParallelJobs.h"
 
 namespace CLSmith {
 
@@ -12,42 +15,104 @@ namespace CLSmith {
   type CLOptions::name() { return name##_; } \
   void CLOptions::name(type x) { name##_ = x; }
 DEFINE_CLFLAG(atomic_reductions, bool, false)
+DEFINE_CLFLAG(atomic_stress, bool, false)
 DEFINE_CLFLAG(atomics, bool, false)
+DEFINE_CLFLAG(barrier_density, int, 10)
+DEFINE_CLFLAG(barrier_fence, const char*, "both")
+DEFINE_CLFLAG(barrier_producer_consumer, bool, false)
 DEFINE_CLFLAG(barriers, bool, false)
+DEFINE_CLFLAG(campaign, const char*, NULL)
+DEFINE_CLFLAG(campaign_generators, int, 0)
+DEFINE_CLFLAG(campaign_launchers, int, 0)
+DEFINE_CLFLAG(campaign_memory, unsigned long, 0)
+DEFINE_CLFLAG(campaign_programs, unsigned long, 0)
+DEFINE_CLFLAG(campaign_test, const char*, NULL)
+DEFINE_CLFLAG(campaign_timeout, int, 150)
+DEFINE_CLFLAG(compact_facts, bool, false)
+DEFINE_CLFLAG(cooperative_hash, bool, false)
 DEFINE_CLFLAG(divergence, bool, false)
+DEFINE_CLFLAG(elide_safe_math, bool, false)
 DEFINE_CLFLAG(embedded, bool, false)
 DEFINE_CLFLAG(emi, bool, false)
+DEFINE_CLFLAG(enumerate, int, 0)
+DEFINE_CLFLAG(enumerate_jobs, int, 0)
+DEFINE_CLFLAG(enumerate_progress, const char*, NULL)
+DEFINE_CLFLAG(enumerate_split, int, 0)
 DEFINE_CLFLAG(emi_p_compound, int, 10)
 DEFINE_CLFLAG(emi_p_leaf, int, 50)
 DEFINE_CLFLAG(emi_p_lift, int, 10)
 DEFINE_CLFLAG(fake_divergence, bool, false)
+DEFINE_CLFLAG(feedback, const char*, NULL)
+DEFINE_CLFLAG(feedback_outcome, const char*, NULL)
+DEFINE_CLFLAG(features, const char*, NULL)
+DEFINE_CLFLAG(fingerprint, const char*, NULL)
 DEFINE_CLFLAG(group_divergence, bool, false)
+DEFINE_CLFLAG(hash_lanes, int, 0)
 DEFINE_CLFLAG(inter_thread_comm, bool, false)
+DEFINE_CLFLAG(max_est_cost, unsigned long, 0)
 DEFINE_CLFLAG(message_passing, bool, false)
+DEFINE_CLFLAG(optimise_globals, bool, false)
 DEFINE_CLFLAG(output, const char*, "CLProg.c")
+DEFINE_CLFLAG(record_sequence, const char*, NULL)
+DEFINE_CLFLAG(reduce, const char*, NULL)
+DEFINE_CLFLAG(reduce_jobs, int, 0)
+DEFINE_CLFLAG(reduce_sequence, const char*, NULL)
 DEFINE_CLFLAG(safe_math, bool, true)
+DEFINE_CLFLAG(safe_math_impl, const char*, "macros")
 DEFINE_CLFLAG(small, bool, false)
+DEFINE_CLFLAG(swarm, const char*, NULL)
 DEFINE_CLFLAG(track_divergence, bool, false)
 DEFINE_CLFLAG(vectors, bool, false)
 #undef DEFINE_CLFLAG
 
 void CLOptions::set_default_settings() {
   atomic_reductions_ = false;
+  atomic_stress_ = false;
   atomics_ = false;
+  barrier_density_ = 10;
+  barrier_fence_ = "both";
+  barrier_producer_consumer_ = false;
   barriers_ = false;
+  campaign_ = NULL;
+  campaign_generators_ = 0;
+  campaign_launchers_ = 0;
+  campaign_memory_ = 0;
+  campaign_programs_ = 0;
+  campaign_test_ = NULL;
+  campaign_timeout_ = 150;
+  compact_facts_ = false;
+  cooperative_hash_ = false;
   divergence_ = false;
+  elide_safe_math_ = false;
   embedded_ = false;
   emi_ = false;
+  enumerate_ = 0;
+  enumerate_jobs_ = 0;
+  enumerate_progress_ = NULL;
+  enumerate_split_ = 0;
   emi_p_compound_ = 10;
   emi_p_leaf_ = 50;
   emi_p_lift_ = 10;
   fake_divergence_ = false;
+  feedback_ = NULL;
+  feedback_outcome_ = NULL;
+  features_ = NULL;
+  fingerprint_ = NULL;
   group_divergence_ = false;
+  hash_lanes_ = 0;
   inter_thread_comm_ = false;
+  max_est_cost_ = 0;
   message_passing_ = false;
+  optimise_globals_ = false;
   output_ = "CLProg.c";
+  record_sequence_ = NULL;
+  reduce_ = NULL;
+  reduce_jobs_ = 0;
+  reduce_sequence_ = NULL;
   safe_math_ = true;
+  safe_math_impl_ = "macros";
   small_ = false;
+  swarm_ = NULL;
   track_divergence_ = false;
   vectors_ = false;
 }
@@ -115,6 +180,114 @@ bool CLOptions::Conflict() {
                  "and divergence." << std::endl;
     return true;
   }
+  if (strcmp(barrier_fence_, "local") && strcmp(barrier_fence_, "global") &&
+      strcmp(barrier_fence_, "both") && strcmp(barrier_fence_, "random")) {
+    std::cout << "Barrier fence must be one of local, global, both or random."
+              << std::endl;
+    return true;
+  }
+  if (strcmp(safe_math_impl_, "macros") &&
+      strcmp(safe_math_impl_, "functions")) {
+    std::cout << "Safe math implementation must be one of macros or functions."
+              << std::endl;
+    return true;
+  }
+  if (barrier_density_ > 100) {
+    std::cout << "Barrier density must be a percentage." << std::endl;
+    return true;
+  }
+  if (barrier_producer_consumer_ && !barriers_) {
+    std::cout << "Producer/consumer barriers require barriers to be enabled."
+              << std::endl;
+    return true;
+  }
+  if (reduce_jobs_ && !reduce_) {
+    std::cout << "The number of reduction jobs requires --reduce." << std::endl;
+    return true;
+  }
+  if (reduce_sequence_ && !reduce_) {
+    std::cout << "Reducing a sequence requires an interestingness command, "
+                 "given by --reduce." << std::endl;
+    return true;
+  }
+  if (reduce_sequence_ && !JobsHaveOwnProcess()) {
+    std::cout << "Reducing a sequence is not supported on this platform."
+              << std::endl;
+    return true;
+  }
+  if ((enumerate_jobs_ || enumerate_progress_ || enumerate_split_) &&
+      !enumerate_) {
+    std::cout << "Enumeration options require --enumerate." << std::endl;
+    return true;
+  }
+  if (enumerate_split_ > enumerate_) {
+    std::cout << "Cannot split the enumeration deeper than it goes."
+              << std::endl;
+    return true;
+  }
+  if (enumerate_ && (reduce_ || record_sequence_)) {
+    std::cout << "Cannot enumerate programs while reducing or recording a "
+                 "sequence." << std::endl;
+    return true;
+  }
+  if (enumerate_ && !JobsHaveOwnProcess()) {
+    std::cout << "Enumerating programs is not supported on this platform."
+              << std::endl;
+    return true;
+  }
+  if (feedback_outcome_ && !feedback_) {
+    std::cout << "Reporting an outcome requires --feedback." << std::endl;
+    return true;
+  }
+  FeedbackScheduler::Outcome outcome;
+  if (feedback_outcome_ &&
+      !FeedbackScheduler::ParseOutcome(feedback_outcome_, &outcome)) {
+    std::cout << "Outcome must be one of pass, build_failure, crash, timeout "
+                 "or mismatch." << std::endl;
+    return true;
+  }
+  if (feedback_ && (enumerate_ || reduce_sequence_)) {
+    std::cout << "Cannot schedule features while enumerating programs or "
+                 "reducing a sequence." << std::endl;
+    return true;
+  }
+  if ((campaign_generators_ || campaign_launchers_ || campaign_memory_ ||
+      campaign_programs_ || campaign_test_) && !campaign_) {
+    std::cout << "Campaign options require --campaign." << std::endl;
+    return true;
+  }
+  if (campaign_ && !campaign_test_) {
+    std::cout << "A campaign requires a test command, given by "
+                 "--campaign_test." << std::endl;
+    return true;
+  }
+  if (campaign_ && (enumerate_ || feedback_ || record_sequence_ ||
+      reduce_sequence_)) {
+    std::cout << "Cannot run a campaign while enumerating programs, "
+                 "scheduling features, or recording or reducing a sequence."
+              << std::endl;
+    return true;
+  }
+  if (campaign_ && !JobsHaveOwnProcess()) {
+    std::cout << "Campaigns are not supported on this platform." << std::endl;
+    return true;
+  }
+  if (swarm_ && (enumerate_ || feedback_ || reduce_sequence_)) {
+    std::cout << "Cannot choose options from a swarm profile while "
+                 "enumerating programs, scheduling features or reducing a "
+                 "sequence." << std::endl;
+    return true;
+  }
+  if (features_ && (enumerate_ || reduce_sequence_)) {
+    std::cout << "Cannot write features while enumerating programs or "
+                 "reducing a sequence." << std::endl;
+    return true;
+  }
+  if (fingerprint_ && (enumerate_ || reduce_sequence_)) {
+    std::cout << "Cannot index fingerprints while enumerating programs or "
+                 "reducing a sequence." << std::endl;
+    return true;
+  }
   if (vectors_ && track_divergence_) {
     std::cout << "Cannot track divergence with vectors enabled." << std::endl;
     return true;
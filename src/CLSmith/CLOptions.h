@@ -18,21 +18,52 @@ class CLOptions {
     static type name(); \
     static void name(type x);
   DEFINE_CLFLAG(atomic_reductions, bool)
+  DEFINE_CLFLAG(atomic_stress, bool)
   DEFINE_CLFLAG(atomics, bool)
+  DEFINE_CLFLAG(barrier_density, int)
+  DEFINE_CLFLAG(barrier_fence, const char*)
+  DEFINE_CLFLAG(barrier_producer_consumer, bool)
   DEFINE_CLFLAG(barriers, bool)
+  DEFINE_CLFLAG(campaign, const char*)
+  DEFINE_CLFLAG(campaign_generators, int)
+  DEFINE_CLFLAG(campaign_launchers, int)
+  DEFINE_CLFLAG(campaign_memory, unsigned long)
+  DEFINE_CLFLAG(campaign_programs, unsigned long)
+  DEFINE_CLFLAG(campaign_test, const char*)
+  DEFINE_CLFLAG(campaign_timeout, int)
+  DEFINE_CLFLAG(compact_facts, bool)
+  DEFINE_CLFLAG(cooperative_hash, bool)
   DEFINE_CLFLAG(divergence, bool)
+  DEFINE_CLFLAG(elide_safe_math, bool)
   DEFINE_CLFLAG(embedded, bool)
   DEFINE_CLFLAG(emi, bool)
+  DEFINE_CLFLAG(enumerate, int)
+  DEFINE_CLFLAG(enumerate_jobs, int)
+  DEFINE_CLFLAG(enumerate_progress, const char*)
+  DEFINE_CLFLAG(enumerate_split, int)
   DEFINE_CLFLAG(emi_p_compound, int)
   DEFINE_CLFLAG(emi_p_leaf, int)
   DEFINE_CLFLAG(emi_p_lift, int)
   DEFINE_CLFLAG(fake_divergence, bool)
+  DEFINE_CLFLAG(feedback, const char*)
+  DEFINE_CLFLAG(feedback_outcome, const char*)
+  DEFINE_CLFLAG(features, const char*)
+  DEFINE_CLFLAG(fingerprint, const char*)
   DEFINE_CLFLAG(group_divergence, bool)
+  DEFINE_CLFLAG(hash_lanes, int)
   DEFINE_CLFLAG(inter_thread_comm, bool)
+  DEFINE_CLFLAG(max_est_cost, unsigned long)
   DEFINE_CLFLAG(message_passing, bool)
+  DEFINE_CLFLAG(optimise_globals, bool)
   DEFINE_CLFLAG(output, const char*)
+  DEFINE_CLFLAG(record_sequence, const char*)
+  DEFINE_CLFLAG(reduce, const char*)
+  DEFINE_CLFLAG(reduce_jobs, int)
+  DEFINE_CLFLAG(reduce_sequence, const char*)
   DEFINE_CLFLAG(safe_math, bool)
+  DEFINE_CLFLAG(safe_math_impl, const char*)
   DEFINE_CLFLAG(small, bool)
+  DEFINE_CLFLAG(swarm, const char*)
   DEFINE_CLFLAG(track_divergence, bool)
   DEFINE_CLFLAG(vectors, bool)
   #undef DEFINE_CLFLAG
@@ -3,23 +3,52 @@
 #include <cstdio>
 #include <fstream>
 #include <sstream>
+#include <string>
 
 #include "CLSmith/CLOptions.h"
 #include "CLSmith/CLProgramGenerator.h"
 #include "CLSmith/ExpressionAtomic.h"
 #include "CLSmith/ExpressionID.h"
 #include "CLSmith/Globals.h"
+#include "CLSmith/StatementAtomicStress.h"
 #include "CLSmith/StatementBarrier.h"
 #include "CLSmith/StatementComm.h"
 #include "CLSmith/StatementMessage.h"
+#include "CLSmith/SwarmProfile.h"
 #include "Function.h"
 #include "OutputMgr.h"
 #include "Type.h"
 #include "VariableSelector.h"
 
 namespace CLSmith {
+namespace {
+// Number of lanes the result is hashed into, or 0 for the single sum. The
+// cooperative hash needs the mixing of the lanes, so it uses at least one.
+int GetHashLanes() {
+  if (CLOptions::hash_lanes()) return CLOptions::hash_lanes();
+  return CLOptions::cooperative_hash() ? 1 : 0;
+}
 
-CLOutputMgr::CLOutputMgr() : out_(CLOptions::output()) {
+// Gives every transparent_crc call in hashing its lane, in turn. The lane is
+// written into the program, so the hash only depends on the values hashed and
+// on the lanes given here, not on where the calls end up in the source.
+std::string AssignHashLanes(const std::string& hashing, int lanes) {
+  const std::string call = "transparent_crc(";
+  std::stringstream out;
+  size_t pos = 0, next;
+  int lane = 0;
+  while ((next = hashing.find(call, pos)) != std::string::npos) {
+    out << hashing.substr(pos, next - pos) << "transparent_crc_lane("
+        << lane << ", ";
+    lane = (lane + 1) % lanes;
+    pos = next + call.length();
+  }
+  out << hashing.substr(pos);
+  return out.str();
+}
+}  // namespace
+
+CLOutputMgr::CLOutputMgr() : buffering_(false) {
 }
 
 void CLOutputMgr::OutputRuntimeInfo(
@@ -37,6 +66,8 @@ void CLOutputMgr::OutputRuntimeInfo(
     out << " ---inter_thread_comm";
   if (CLOptions::emi())
     out << " ---emi";
+  if (CLOptions::atomic_stress())
+    out << " --atomic_stress " << StatementAtomicStress::GetRegionSize();
   out << " -g ";
   for (std::vector<unsigned int>::const_iterator it = global_dims.begin();
       it < global_dims.end(); it++) {
@@ -92,14 +123,27 @@ void CLOutputMgr::OutputHeader(int argc, char *argv[], unsigned long seed) {
       "#define UINT16_MAX USHRT_MAX\n"
       "#define UINT8_MIN UCHAR_MIN\n"
       "#define UINT8_MAX UCHAR_MAX\n"
-      "\n"
-      "#define transparent_crc(X, Y, Z) "
-      "transparent_crc_(&crc64_context, X, Y, Z)\n"
+      "\n";
+  // With lanes, every call is given its lane by the entry function.
+  if (GetHashLanes()) {
+    out << "#define CLSMITH_HASH_LANES " << GetHashLanes() << "\n"
+        "#define transparent_crc_lane(L, X, Y, Z) "
+        "transparent_crc_lane_(crc64_context, L, X, Y, Z)\n";
+  } else {
+    out << "#define transparent_crc(X, Y, Z) "
+        "transparent_crc_(&crc64_context, X, Y, Z)\n";
+  }
+  out <<
       "\n"
       "#define VECTOR(X , Y) VECTOR_(X, Y)\n"
       "#define VECTOR_(X, Y) X##Y\n"
       << std::endl;
 
+  // The safe math operations call the inline functions of the runtime, rather
+  // than expanding its macros.
+  if (std::string(CLOptions::safe_math_impl()) == "functions")
+    out << "#define CLSMITH_SAFE_MATH_FUNCTIONS" << std::endl << std::endl;
+
   // Macro for expanding GROUP_DIVERGE
   ExpressionIDGroupDiverge::OutputGroupDivergenceMacro(out);
   out << std::endl;
@@ -113,37 +157,71 @@ void CLOutputMgr::OutputHeader(int argc, char *argv[], unsigned long seed) {
 
   out << std::endl;
   out << "// Seed: " << seed << std::endl;
+  if (!SwarmProfile::GetFeatureVector().empty())
+    out << "// Swarm: " << SwarmProfile::GetFeatureVector() << std::endl;
   out << std::endl;
   out << "#include \"CLSmith.h\"" << std::endl;
   out << std::endl;
 }
 
 void CLOutputMgr::Output() {
-  std::ostream &out = get_main_out();
+  PrepareOutput();
+  OutputProgram(get_main_out());
+}
+
+void CLOutputMgr::PrepareOutput() {
+  Globals *globals = Globals::GetGlobals();
+  globals->ModifyGlobalVariableReferences();
+  globals->AddGlobalStructToAllFunctions();
+
+  // The layout depends on how the globals are used. Reducing the program only
+  // removes uses, so the layout stays valid for every later print.
+  if (CLOptions::optimise_globals()) globals->OptimiseLayout();
+}
+
+void CLOutputMgr::OutputProgram(std::ostream& out) {
   OutputStructUnionDeclarations(out);
 
   // Type of message_t, for message passing.
   if (CLOptions::message_passing())
     MessagePassing::OutputMessageType(out);
 
+  // The struct definition ignores the renaming of the globals.
   Globals *globals = Globals::GetGlobals();
   globals->OutputStructDefinition(out);
-  globals->ModifyGlobalVariableReferences();
-  globals->AddGlobalStructToAllFunctions();
-
   OutputForwardDeclarations(out);
   OutputFunctions(out);
-  OutputEntryFunction(*globals);
+  OutputEntryFunction(*globals, out);
+}
+
+void CLOutputMgr::StartBuffering() {
+  buffer_.str("");
+  buffering_ = true;
+}
+
+void CLOutputMgr::StopBuffering() {
+  buffering_ = false;
+}
+
+void CLOutputMgr::FlushBuffer() {
+  StopBuffering();
+  get_main_out() << buffer_.str();
+  buffer_.str("");
 }
 
 std::ostream& CLOutputMgr::get_main_out() {
+  if (buffering_) return buffer_;
+  if (!out_.is_open()) out_.open(CLOptions::output());
   return out_;
 }
 
 void CLOutputMgr::OutputEntryFunction(Globals& globals) {
+  OutputEntryFunction(globals, get_main_out());
+}
+
+void CLOutputMgr::OutputEntryFunction(Globals& globals, std::ostream& out) {
   // Would ideally use the ExtensionMgr, but there is no way to set it to our
   // own custom made one (without modifying the code).
-  std::ostream& out = get_main_out();
   out << "__kernel void entry(__global ulong *result";
   if (CLOptions::atomics()) {
     out << ", __global volatile uint *g_atomic_input";
@@ -158,6 +236,8 @@ void CLOutputMgr::OutputEntryFunction(Globals& globals) {
     out << ", __global int *sequence_input";
   if (CLOptions::inter_thread_comm())
     out << ", __global long *g_comm_values";
+  if (CLOptions::atomic_stress())
+    out << ", __global volatile uint *g_atomic_stress";
   out << ") {" << std::endl;
   globals.OutputArrayControlVars(out);
   globals.OutputBufferInits(out);
@@ -184,17 +264,40 @@ void CLOutputMgr::OutputEntryFunction(Globals& globals) {
   out << std::endl;
 
   // Handle hashing and outputting.
+  const int lanes = GetHashLanes();
   output_tab(out, 1);
-  out << "uint64_t crc64_context = 0xFFFFFFFFFFFFFFFFUL;" << std::endl;
+  if (lanes) {
+    out << "uint64_t crc64_context[CLSMITH_HASH_LANES];" << std::endl;
+    output_tab(out, 1);
+    out << "hash_init(crc64_context);" << std::endl;
+  } else {
+    out << "uint64_t crc64_context = 0xFFFFFFFFFFFFFFFFUL;" << std::endl;
+  }
   output_tab(out, 1);
   out << "int print_hash_value = 0;" << std::endl;
-  HashGlobalVariables(out);
+  std::stringstream hashing;
+  HashGlobalVariables(hashing);
   if (CLOptions::atomics())
-    ExpressionAtomic::OutputHashing(out);
-  if (CLOptions::inter_thread_comm()) StatementComm::HashCommValues(out);
+    ExpressionAtomic::OutputHashing(hashing);
+  if (CLOptions::inter_thread_comm()) StatementComm::HashCommValues(hashing);
+  if (CLOptions::atomic_stress()) StatementAtomicStress::OutputHashing(hashing);
+  StatementBarrier::HashExchangeBuffer(hashing);
+  // The whole of every local buffer is hashed by the group together.
+  if (CLOptions::cooperative_hash()) {
+    output_tab(hashing, 1);
+    hashing << "__local uint64_t hash_scratch["
+        << CLProgramGenerator::get_threads_per_group() << "];" << std::endl;
+    globals.HashLocalBuffers(hashing);
+  }
+  out << (lanes ? AssignHashLanes(hashing.str(), lanes) : hashing.str());
   output_tab(out, 1);
-  out << "result[get_linear_global_id()] = crc64_context ^ 0xFFFFFFFFFFFFFFFFUL;"
-      << std::endl;
+  if (lanes) {
+    out << "result[get_linear_global_id()] = hash_finish(crc64_context);"
+        << std::endl;
+  } else {
+    out << "result[get_linear_global_id()] = "
+        "crc64_context ^ 0xFFFFFFFFFFFFFFFFUL;" << std::endl;
+  }
   out << "}" << std::endl;
 }
 
@@ -8,6 +8,7 @@
 #define _CLSMITH_CLOUTPUTMGR_H_
 
 #include <fstream>
+#include <sstream>
 #include <string>
 
 #include "CommonMacros.h"
@@ -20,8 +21,10 @@ class Globals;
 class CLOutputMgr : public OutputMgr {
  public:
   CLOutputMgr();
-  explicit CLOutputMgr(const std::string& filename) : out_(filename.c_str()) {}
-  explicit CLOutputMgr(const char *filename) : out_(filename) {}
+  explicit CLOutputMgr(const std::string& filename)
+      : out_(filename.c_str()), buffering_(false) {}
+  explicit CLOutputMgr(const char *filename)
+      : out_(filename), buffering_(false) {}
   ~CLOutputMgr() { out_.close(); }
   
   // Outputs information regarding the runtime to be read by the host code
@@ -35,15 +38,36 @@ class CLOutputMgr : public OutputMgr {
   // Inherited from OutputMgr. Outputs all the definitions.
   void Output();
 
+  // Output() split in two, so that the program can be printed several times,
+  // e.g. while it is being reduced. PrepareOutput() renames the globals and
+  // must be called exactly once, before any call to OutputProgram().
+  void PrepareOutput();
+  void OutputProgram(std::ostream& out);
+
+  // Prints to an in-memory buffer instead of the output file until
+  // StopBuffering() is called, so that what was printed can be reused.
+  void StartBuffering();
+  void StopBuffering();
+  // Everything printed since StartBuffering().
+  std::string GetBuffer() const { return buffer_.str(); }
+  // Stops buffering and prints what was buffered to the output file.
+  void FlushBuffer();
+
   // Inherited from OutputMgr. Gets the stream used for printing the output.
+  // Unless it was given to the constructor, the output file is only opened
+  // once something is printed to it, so until then it can still be changed
+  // with CLOptions::output().
   std::ostream &get_main_out();
 
   // Outputs the kernel entry function. OutputMain in OutputMgr isn't virtual,
   // so we can't override it.
   void OutputEntryFunction(Globals& globals);
+  void OutputEntryFunction(Globals& globals, std::ostream& out);
 
  private:
   std::ofstream out_;
+  std::stringstream buffer_;
+  bool buffering_;
 
   DISALLOW_COPY_AND_ASSIGN(CLOutputMgr);
 };
@@ -6,16 +6,23 @@
 #include <string>
 #include <iostream>
 
+#include "CLSmith/BarrierPlacement.h"
 #include "CLSmith/CLExpression.h"
 #include "CLSmith/CLOptions.h"
 #include "CLSmith/CLVariable.h"
+#include "CLSmith/CostModel.h"
 #include "CLSmith/Divergence.h"
 #include "CLSmith/ExpressionAtomic.h"
 #include "ExpressionID.h"
+#include "CLSmith/Fingerprint.h"
 #include "CLSmith/FunctionInvocationBuiltIn.h"
+#include "CLSmith/KernelFeatures.h"
+#include "CLSmith/KernelReducer.h"
+#include "CLSmith/SafeMathElision.h"
 #include "CLSmith/StatementAtomicResult.h"
 #include "CLSmith/Globals.h"
 #include "CLSmith/StatementAtomicReduction.h"
+#include "CLSmith/StatementAtomicStress.h"
 #include "CLSmith/StatementBarrier.h"
 #include "CLSmith/StatementComm.h"
 #include "CLSmith/StatementEMI.h"
@@ -39,6 +46,9 @@ static std::vector<unsigned int> *localDim;
 }  // namespace
 
 void CLProgramGenerator::goGenerator() {
+  phase_seconds_.clear();
+  phase_start_ = std::chrono::steady_clock::now();
+
   // Initialise probabilies.
   CLExpression::InitProbabilityTable();
   CLStatement::InitProbabilityTable();
@@ -57,14 +67,26 @@ void CLProgramGenerator::goGenerator() {
   StatementComm::InitBuffers();
   // Initialise Message Passing data.
   MessagePassing::Initialise();
+  // Initialise buffers used for atomic stress patterns.
+  if (CLOptions::atomic_stress())
+    StatementAtomicStress::InitBuffers();
+
+  // When reducing, everything printed before the program itself is kept, as
+  // every candidate starts with it. Programs generated while reducing a
+  // sequence are kept whole until the end, as the generator may be
+  // checkpointed and continue in several processes with different outputs.
+  CLOutputMgr *cl_output_mgr = dynamic_cast<CLOutputMgr *>(output_mgr_.get());
+  if (CLOptions::reduce() && cl_output_mgr) cl_output_mgr->StartBuffering();
 
   // Expects argc, argv and seed. These vars should really be in the output_mgr.
   output_mgr_->OutputHeader(0, NULL, seed_);
+  EndPhase("setup");
 
   // This creates the random program, the rest handles post-processing and
   // outputting the program.
   GenerateAllTypes();
   GenerateFunctions();
+  EndPhase("generate");
 
   // If tracking divergence is set, perform the tracking now.
   std::unique_ptr<Divergence> div;
@@ -123,17 +145,80 @@ void CLProgramGenerator::goGenerator() {
   if (CLOptions::message_passing())
     MessagePassing::AddMessageVarsToGlobals(globals);
 
+  // Add the counters used by the atomic stress patterns.
+  if (CLOptions::atomic_stress())
+    StatementAtomicStress::AddVarsToGlobals(globals);
+
   // If barriers have been set, use the divergence information to place them.
+  // Without divergence, they are placed wherever the code is proven uniform.
   if (CLOptions::barriers()) {
     if (CLOptions::divergence()) GenerateBarriers(div.get(), globals);
-    else { /*TODO Non-div barriers*/ }
+    else PlaceBarriers(globals);
   }
 
   if (CLOptions::small())
     CLSmith::CLVariable::ParseUnusedVars();
+  EndPhase("transform");
+
+  // Estimate how long the kernel will take to run, rejecting it if it is over
+  // budget. Must be done before the globals are renamed and moved. Without a
+  // budget, nothing is estimated and the output is left as it was.
+  if (CLOptions::max_est_cost()) {
+    CostModel cost_model;
+    cost_model.EstimateProgram(GetFirstFunction(), *globals);
+    if (cl_output_mgr) cost_model.OutputSummary(cl_output_mgr->get_main_out());
+    if (cost_model.ExceedsBudget(CLOptions::max_est_cost())) {
+      std::cerr << "Estimated cost of " << cost_model.GetTotalOps()
+                << " operations exceeds the budget of "
+                << CLOptions::max_est_cost() << "." << std::endl;
+      over_budget_ = true;
+      EndPhase("analyse");
+      Globals::ReleaseGlobals();
+      EMIController::ReleaseEMIController();
+      return;
+    }
+  }
+
+  // Count the safe math wrappers that are replaced by plain operators.
+  if (CLOptions::elide_safe_math()) {
+    SafeMathElision elision;
+    elision.CountProgram();
+    if (cl_output_mgr) elision.OutputSummary(cl_output_mgr->get_main_out());
+  }
 
-  // Output the whole program.
-  output_mgr_->Output();
+  // Record the structure of the program in the fingerprint index, so that
+  // near duplicates can be found without comparing the programs.
+  if (CLOptions::fingerprint()) {
+    Fingerprint fingerprint;
+    fingerprint.FingerprintProgram();
+    if (cl_output_mgr) fingerprint.OutputSummary(cl_output_mgr->get_main_out());
+    if (!fingerprint.AppendToIndex(CLOptions::fingerprint(), seed_,
+        CLOptions::output()))
+      std::cerr << "Cannot write to " << CLOptions::fingerprint() << "."
+                << std::endl;
+  }
+
+  // Append the features of the program to the feature file, so that they can
+  // be related to its outcome without parsing it.
+  if (CLOptions::features()) {
+    KernelFeatures features;
+    features.CountProgram();
+    if (!features.AppendToFile(CLOptions::features(), seed_))
+      std::cerr << "Cannot write to " << CLOptions::features() << "."
+                << std::endl;
+  }
+
+  EndPhase("analyse");
+
+  // Output the whole program, or its reduction.
+  if (CLOptions::reduce() && !CLOptions::reduce_sequence() && cl_output_mgr) {
+    KernelReducer reducer(cl_output_mgr);
+    reducer.Reduce();
+  } else {
+    output_mgr_->Output();
+    if (CLOptions::reduce() && cl_output_mgr) cl_output_mgr->FlushBuffer();
+  }
+  EndPhase("output");
 
   // Release any singleton instances used.
   Globals::ReleaseGlobals();
@@ -219,4 +304,11 @@ void CLProgramGenerator::get_divisors(
     divisors->push_back(i);
 }
 
+void CLProgramGenerator::EndPhase(const char *phase) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  phase_seconds_.push_back(std::make_pair(phase,
+      std::chrono::duration<double>(now - phase_start_).count()));
+  phase_start_ = now;
+}
+
 }  // namespace CLSmith
@@ -10,24 +10,37 @@
 #include "CLSmith/CLOutputMgr.h"
 #include "CommonMacros.h"
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace CLSmith {
 
 class CLProgramGenerator : public AbsProgramGenerator {
  public:
   explicit CLProgramGenerator(unsigned long seed)
-      : output_mgr_(new CLOutputMgr()), seed_(seed) {
+      : output_mgr_(new CLOutputMgr()), seed_(seed), over_budget_(false) {
   }
   // Transfer pointer ownership.
   CLProgramGenerator(unsigned long seed, OutputMgr *output_mgr)
-      : output_mgr_(output_mgr), seed_(seed) {
+      : output_mgr_(output_mgr), seed_(seed), over_budget_(false) {
   }
 
   // Inherited from AbsProgramGenerator. Creates the random program.
   void goGenerator();
 
+  // Whether the program was rejected for having an estimated cost over the
+  // --max_est_cost budget. Nothing past the header is output in that case.
+  bool over_budget() const { return over_budget_; }
+
+  // Time spent in each phase of goGenerator(), in seconds and in the order the
+  // phases ran: setup, generate, transform, analyse and output.
+  const std::vector<std::pair<const char *, double> >& phase_seconds() const {
+    return phase_seconds_;
+  }
+
   // Inherited from AbsProgramGenerator. Would ideally return const OutputMgr&,
   // but this is inherited from a pure virtual function, we also want to accept
   // other managers as a parameter.
@@ -54,6 +67,12 @@ class CLProgramGenerator : public AbsProgramGenerator {
  private:
   std::unique_ptr<OutputMgr> output_mgr_;
   unsigned long seed_;
+  bool over_budget_;
+  std::vector<std::pair<const char *, double> > phase_seconds_;
+  std::chrono::steady_clock::time_point phase_start_;
+
+  // Records the time since the previous phase ended as the time of phase.
+  void EndPhase(const char *phase);
   
   // To be called at the beginning of the program generation; sets the 
   // runtime parameters of the program, such as number of groups or threads
@@ -1,15 +1,26 @@
 // Entry point to the program.
 
 #include <cassert>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "AbsProgramGenerator.h"
 #include "CGOptions.h"
 #include "CLSmith/CLOptions.h"
 #include "CLSmith/CLOutputMgr.h"
 #include "CLSmith/CLProgramGenerator.h"
+#include "CLSmith/CampaignDriver.h"
+#include "CLSmith/FeedbackScheduler.h"
+#include "CLSmith/KernelFeatures.h"
+#include "CLSmith/ProgramEnumerator.h"
+#include "CLSmith/SequenceReducer.h"
+#include "CLSmith/SwarmProfile.h"
+#include "DeltaMonitor.h"
 #include "platform.h"
 
 // Generator seed.
@@ -26,19 +37,126 @@ bool ParseIntArg(const char *arg, unsigned long *value) {
   return res;
 }
 
-int main(int argc, char **argv) {
-  g_Seed = platform_gen_seed();
-  CGOptions::set_default_settings();
-  CLSmith::CLOptions::set_default_settings();
-  std::string output_filename = "";
+// Generates the program with the options parsed from the command line, and
+// returns the exit code of the generator.
+int GenerateProgram(int argc, char **argv) {
+  // AbsProgramGenerator does other initialisation stuff, besides itself. So we
+  // call it, disregarding the returned object. Still need to delete it.
+  AbsProgramGenerator *generator =
+      AbsProgramGenerator::CreateInstance(argc, argv, g_Seed);
+  if (!generator) {
+    cout << "error: can't create AbsProgramGenerator. csmith init failed!"
+         << std::endl;
+    return -1;
+  }
 
-  // Parse command line arguments.
+  // Now create our program generator for OpenCL. Scoped so the output file is
+  // closed before it may be removed.
+  bool over_budget;
+  {
+    CLSmith::CLProgramGenerator cl_generator(g_Seed);
+    cl_generator.goGenerator();
+    over_budget = cl_generator.over_budget();
+  }
+
+  // Write the sequence of random choices used, if asked to. Must be done while
+  // the random number generator is still around.
+  if (DeltaMonitor::is_running()) {
+    std::stringstream statistics;
+    DeltaMonitor::Output(statistics);
+  }
+
+  // Calls Finalization::doFinalization(), which deletes everything, so must be
+  // called after program generation.
+  delete generator;
+
+  // Rejected programs are not kept, the distinct exit code lets the caller move
+  // on to the next seed.
+  if (over_budget) {
+    std::remove(CLSmith::CLOptions::output());
+    return 2;
+  }
+
+  return 0;
+}
+
+// Features of csmith that OpenCL does not force, switched on and off with
+// --<name> and --no-<name>, as they are with csmith.
+const struct {
+  const char *name;
+  bool (*set)(bool);
+} kCGFeatures[] = {
+  {"arg-structs", &CGOptions::arg_structs},
+  {"arg-unions", &CGOptions::arg_unions},
+  {"arrays", &CGOptions::arrays},
+  {"compound-assignment", &CGOptions::compound_assignment},
+  {"const-pointers", &CGOptions::const_pointers},
+  {"dangling-global-pointers", &CGOptions::dangling_global_ptrs},
+  {"divs", &CGOptions::divs},
+  {"inline-function", &CGOptions::inline_function},
+  {"jumps", &CGOptions::jumps},
+  {"longlong", &CGOptions::longlong},
+  {"math64", &CGOptions::math64},
+  {"muls", &CGOptions::muls},
+  {"pointers", &CGOptions::pointers},
+  {"return-structs", &CGOptions::return_structs},
+  {"return-unions", &CGOptions::return_unions},
+  {"structs", &CGOptions::use_struct},
+  {"unions", &CGOptions::use_union},
+  {"volatile-pointers", &CGOptions::volatile_pointers},
+  {"volatiles", &CGOptions::volatiles}
+};
+
+// Limits of csmith, set with --<name> <value>, as they are with csmith.
+const struct {
+  const char *name;
+  int (*set)(int);
+} kCGLimits[] = {
+  {"max-array-dim", &CGOptions::max_array_dimensions},
+  {"max-array-len-per-dim", &CGOptions::max_array_length_per_dimension},
+  {"max-block-depth", &CGOptions::max_blk_depth},
+  {"max-block-size", &CGOptions::max_block_size},
+  {"max-expr-complexity", &CGOptions::max_expr_depth},
+  {"max-funcs", &CGOptions::max_funcs},
+  {"max-pointer-depth", &CGOptions::max_indirect_level},
+  {"max-struct-fields", &CGOptions::max_struct_fields},
+  {"max-union-fields", &CGOptions::max_union_fields}
+};
+
+// Sets the csmith option given by the argument at idx, moving idx past it.
+// Returns false if it is not one, or its value is missing or invalid, which
+// *valid tells apart.
+bool ParseCGOption(int argc, char **argv, int *idx, bool *valid) {
+  *valid = true;
+  const char *arg = argv[*idx];
+  if (strncmp(arg, "--", 2)) return false;
+  arg += 2;
+  bool enable = strncmp(arg, "no-", 3) != 0;
+  for (const auto& feature : kCGFeatures) {
+    if (strcmp(enable ? arg : arg + 3, feature.name)) continue;
+    feature.set(enable);
+    return true;
+  }
+  for (const auto& limit : kCGLimits) {
+    if (strcmp(arg, limit.name)) continue;
+    ++*idx;
+    unsigned long value;
+    *valid = CheckArgExists(*idx, argc) && ParseIntArg(argv[*idx], &value);
+    if (*valid) limit.set(value);
+    return true;
+  }
+  return false;
+}
+
+// Sets the options given by the command line arguments. Returns false if one
+// is invalid.
+bool ParseArgs(int argc, char **argv) {
   for (int idx = 1; idx < argc; ++idx) {
     if (!strcmp(argv[idx], "--seed") ||
         !strcmp(argv[idx], "-s")) {
       ++idx;
-      if (!CheckArgExists(idx, argc)) return -1;
-      if (!ParseIntArg(argv[idx], &g_Seed)) return -1;
+      if (!CheckArgExists(idx, argc)) return false;
+      if (!ParseIntArg(argv[idx], &g_Seed)) return false;
       continue;
     }
 
@@ -58,21 +176,126 @@ int main(int argc, char **argv) {
       continue;
     }
 
+    if (!strcmp(argv[idx], "--atomic_stress")) {
+      CLSmith::CLOptions::atomic_stress(true);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--atomics")) {
       CLSmith::CLOptions::atomics(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--barrier_density")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      // Checked before it is narrowed to an int, so it cannot wrap.
+      if (value > 100) {
+        std::cout << "Barrier density must be a percentage." << std::endl;
+        return false;
+      }
+      CLSmith::CLOptions::barrier_density(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--barrier_fence")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::barrier_fence(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--barrier_producer_consumer")) {
+      CLSmith::CLOptions::barrier_producer_consumer(true);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--barriers")) {
       CLSmith::CLOptions::barriers(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--campaign")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::campaign(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--campaign_generators")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::campaign_generators(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--campaign_launchers")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::campaign_launchers(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--campaign_memory")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::campaign_memory(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--campaign_programs")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::campaign_programs(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--campaign_test")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::campaign_test(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--campaign_timeout")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::campaign_timeout(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--compact_facts")) {
+      CLSmith::CLOptions::compact_facts(true);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--cooperative_hash")) {
+      CLSmith::CLOptions::cooperative_hash(true);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--divergence")) {
       CLSmith::CLOptions::divergence(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--elide_safe_math")) {
+      CLSmith::CLOptions::elide_safe_math(true);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--embedded")) {
       CLSmith::CLOptions::embedded(true);
       continue;
@@ -85,69 +308,202 @@ int main(int argc, char **argv) {
 
     if (!strcmp(argv[idx], "--emi_p_compound")) {
       ++idx;
-      if (!CheckArgExists(idx, argc)) return -1;
+      if (!CheckArgExists(idx, argc)) return false;
       unsigned long value;
-      if (!ParseIntArg(argv[idx], &value)) return -1;
+      if (!ParseIntArg(argv[idx], &value)) return false;
       CLSmith::CLOptions::emi_p_compound(value);
       continue;
     }
 
     if (!strcmp(argv[idx], "--emi_p_leaf")) {
       ++idx;
-      if (!CheckArgExists(idx, argc)) return -1;
+      if (!CheckArgExists(idx, argc)) return false;
       unsigned long value;
-      if (!ParseIntArg(argv[idx], &value)) return -1;
+      if (!ParseIntArg(argv[idx], &value)) return false;
       CLSmith::CLOptions::emi_p_leaf(value);
       continue;
     }
 
     if (!strcmp(argv[idx], "--emi_p_lift")) {
       ++idx;
-      if (!CheckArgExists(idx, argc)) return -1;
+      if (!CheckArgExists(idx, argc)) return false;
       unsigned long value;
-      if (!ParseIntArg(argv[idx], &value)) return -1;
+      if (!ParseIntArg(argv[idx], &value)) return false;
       CLSmith::CLOptions::emi_p_lift(value);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--enumerate")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::enumerate(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--enumerate_jobs")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::enumerate_jobs(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--enumerate_progress")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::enumerate_progress(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--enumerate_split")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::enumerate_split(value);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--fake_divergence")) {
       CLSmith::CLOptions::fake_divergence(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--feedback")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::feedback(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--feedback_outcome")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::feedback_outcome(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--features")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::features(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--fingerprint")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::fingerprint(argv[idx]);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--group_divergence")) {
       CLSmith::CLOptions::group_divergence(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--hash_lanes")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      if (value > 64) {
+        std::cout << "At most 64 hash lanes can be used." << std::endl;
+        return false;
+      }
+      CLSmith::CLOptions::hash_lanes(value);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--inter_thread_comm")) {
       CLSmith::CLOptions::inter_thread_comm(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--max_est_cost")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::max_est_cost(value);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--message_passing")) {
       CLSmith::CLOptions::message_passing(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--optimise_globals")) {
+      CLSmith::CLOptions::optimise_globals(true);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--output_file") ||
         !strcmp(argv[idx], "-o")) {
       ++idx;
-      if (!CheckArgExists(idx, argc)) return -1;
+      if (!CheckArgExists(idx, argc)) return false;
       CLSmith::CLOptions::output(argv[idx]);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--record_sequence")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::record_sequence(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--reduce")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::reduce(argv[idx]);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--reduce_jobs")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      unsigned long value;
+      if (!ParseIntArg(argv[idx], &value)) return false;
+      CLSmith::CLOptions::reduce_jobs(value);
+      continue;
+    }
+
+    if (!strcmp(argv[idx], "--reduce_sequence")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::reduce_sequence(argv[idx]);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--no-safe_math")) {
       CLSmith::CLOptions::safe_math(false);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--safe_math_impl")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::safe_math_impl(argv[idx]);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--small")) {
       CLSmith::CLOptions::small(true);
       continue;
     }
 
+    if (!strcmp(argv[idx], "--swarm")) {
+      ++idx;
+      if (!CheckArgExists(idx, argc)) return false;
+      CLSmith::CLOptions::swarm(argv[idx]);
+      continue;
+    }
+
     if (!strcmp(argv[idx], "--track_divergence")) {
       CLSmith::CLOptions::track_divergence(true);
       continue;
@@ -158,34 +514,119 @@ int main(int argc, char **argv) {
       continue;
     }
 
+    bool valid;
+    if (ParseCGOption(argc, argv, &idx, &valid)) {
+      if (!valid) return false;
+      continue;
+    }
+
     std::cout << "Invalid option \"" << argv[idx] << '"' << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Sets the options given on the command line, followed by the arguments.
+bool SetOptions(int argc, char **argv, const std::vector<const char *>& args) {
+  CGOptions::set_default_settings();
+  CLSmith::CLOptions::set_default_settings();
+  if (!ParseArgs(argc, argv)) return false;
+  std::vector<char *> all_args(1, argv[0]);
+  for (const char *arg : args) all_args.push_back(const_cast<char *>(arg));
+  return ParseArgs(all_args.size(), all_args.data());
+}
+
+int main(int argc, char **argv) {
+  g_Seed = platform_gen_seed();
+  CGOptions::set_default_settings();
+  CLSmith::CLOptions::set_default_settings();
+  std::string output_filename = "";
+
+  // Parse command line arguments.
+  if (!ParseArgs(argc, argv)) return -1;
+
+  // Check for conflicting options
+  if (CLSmith::CLOptions::Conflict()) return -1;
+
+  // Swarm testing chooses more options for every seed.
+  CLSmith::SwarmProfile swarm(
+      CLSmith::CLOptions::swarm() ? CLSmith::CLOptions::swarm() : "",
+      [argc, argv](const std::vector<const char *>& args) {
+        return SetOptions(argc, argv, args);
+      });
+  if (CLSmith::CLOptions::swarm()) {
+    if (!swarm.Load() || !swarm.Choose(g_Seed)) return -1;
+    if (CLSmith::CLOptions::Conflict()) return -1;
+  }
+
+  // The header of the feature file is written before any program is
+  // generated, so the generators of a campaign only append rows to it.
+  if (CLSmith::CLOptions::features() &&
+      !CLSmith::KernelFeatures::CreateFile(CLSmith::CLOptions::features())) {
+    std::cout << "Cannot use " << CLSmith::CLOptions::features()
+              << " as a feature file, it has other columns or cannot be "
+                 "written." << std::endl;
     return -1;
   }
-  // End parsing.
+
+  // The scheduler enables features itself, so it goes before they are
+  // resolved.
+  if (CLSmith::CLOptions::feedback()) {
+    CLSmith::FeedbackScheduler scheduler(CLSmith::CLOptions::feedback());
+    if (CLSmith::CLOptions::feedback_outcome()) {
+      CLSmith::FeedbackScheduler::Outcome outcome;
+      CLSmith::FeedbackScheduler::ParseOutcome(
+          CLSmith::CLOptions::feedback_outcome(), &outcome);
+      return scheduler.RecordOutcome(g_Seed, outcome) ? 0 : 1;
+    }
+    if (!scheduler.ChooseArm(g_Seed)) return -1;
+  }
 
   // Resolve any options in CGOptions that must change as a result of options
   // that the user has set.
   CLSmith::CLOptions::ResolveCGOptions();
-  // Check for conflicting options
-  if (CLSmith::CLOptions::Conflict()) return -1;
 
-  // AbsProgramGenerator does other initialisation stuff, besides itself. So we
-  // call it, disregarding the returned object. Still need to delete it.
-  AbsProgramGenerator *generator =
-      AbsProgramGenerator::CreateInstance(argc, argv, g_Seed);
-  if (!generator) {
-    cout << "error: can't create AbsProgramGenerator. csmith init failed!"
-         << std::endl;
-    return -1;
+  // The sequence reducer generates every candidate in a process of its own.
+  if (CLSmith::CLOptions::reduce_sequence()) {
+    CLSmith::SequenceReducer reducer([argc, argv]() {
+      return GenerateProgram(argc, argv);
+    });
+    return reducer.Reduce() ? 0 : 1;
   }
 
-  // Now create our program generator for OpenCL.
-  CLSmith::CLProgramGenerator cl_generator(g_Seed);
-  cl_generator.goGenerator();
+  // So does the campaign, for every program.
+  if (CLSmith::CLOptions::campaign()) {
+    CLSmith::CampaignDriver driver([argc, argv, &swarm](unsigned long seed) {
+      // Choosing the options sets the output file back to the one on the
+      // command line, and the seed too.
+      if (CLSmith::CLOptions::swarm()) {
+        const char *output = CLSmith::CLOptions::output();
+        if (!swarm.Choose(seed) || CLSmith::CLOptions::Conflict()) return -1;
+        CLSmith::CLOptions::ResolveCGOptions();
+        CLSmith::CLOptions::output(output);
+      }
+      g_Seed = seed;
+      return GenerateProgram(argc, argv);
+    }, g_Seed);
+    return driver.Run() ? 0 : 1;
+  }
 
-  // Calls Finalization::doFinalization(), which deletes everything, so must be
-  // called after program generation.
-  delete generator;
+  // And the enumeration.
+  if (CLSmith::CLOptions::enumerate()) {
+    CLSmith::ProgramEnumerator enumerator([argc, argv]() {
+      return GenerateProgram(argc, argv);
+    });
+    return enumerator.Enumerate() ? 0 : 1;
+  }
 
-  return 0;
+  if (CLSmith::CLOptions::record_sequence()) {
+    std::string msg;
+    if (!DeltaMonitor::init(msg, "simple",
+        CLSmith::CLOptions::record_sequence())) {
+      std::cout << msg << std::endl;
+      return -1;
+    }
+  }
+
+  return GenerateProgram(argc, argv);
 }
@@ -4,8 +4,10 @@
 #include "CGContext.h"
 #include "CLSmith/CLOptions.h"
 #include "CLSmith/ExpressionID.h"
+#include "CLSmith/FeedbackScheduler.h"
 #include "CLSmith/StatementComm.h"
 #include "CLSmith/StatementAtomicReduction.h"
+#include "CLSmith/StatementAtomicStress.h"
 #include "CLSmith/StatementEMI.h"
 #include "CLSmith/StatementMessage.h"
 #include "ProbabilityTable.h"
@@ -26,12 +28,11 @@ CLStatement *CLStatement::make_random(CGContext& cg_context,
     // is that if NULL is returned to Statement::make_random(), it will
     // recursively call itself, instead of specifying a non CLStatement.
     assert (cl_stmt_table != NULL);
-    int num = rnd_upto(35);
+    int num = rnd_upto(cl_stmt_table->get_max());
     st = (CLStatementType)VectorFilter(cl_stmt_table).lookup(num);
-    // Must only include barriers if they are enabled and no divergence.
-    if (st == kBarrier) {
-      if (!CLOptions::barriers() || CLOptions::divergence()) return NULL;
-    }
+    // Barriers are never generated in place, they are inserted once the whole
+    // program is known (see BarrierPlacement.h and GenerateBarriers).
+    if (st == kBarrier) return NULL;
     // Only use EMI blocks if they are enabled and we are not already in one.
     if (st == kEMI) {
       if (!CLOptions::emi() || cg_context.get_emi_context()) return NULL;
@@ -58,6 +59,12 @@ CLStatement *CLStatement::make_random(CGContext& cg_context,
       if (!CLOptions::message_passing())
         return NULL;
     }
+    // Atomic stress must be set, and is kept out of atomic blocks for the same
+    // reasons as atomic reductions.
+    if (st == kAtomicStress) {
+      if (!CLOptions::atomic_stress() || cg_context.get_atomic_context())
+        return NULL;
+    }
   }
 
   CLStatement *stmt = NULL;
@@ -74,6 +81,8 @@ CLStatement *CLStatement::make_random(CGContext& cg_context,
       stmt = StatementComm::make_random(cg_context); break;
     case kMessage:
       stmt = StatementMessage::make_random(cg_context); break;
+    case kAtomicStress:
+      stmt = StatementAtomicStress::make_random(cg_context); break;
     default: assert(false);
   }
   return stmt;
@@ -90,13 +99,22 @@ CLStatement *CLStatement::make_random(CGContext& cg_context,
 }*/
 
 void CLStatement::InitProbabilityTable() {
+  // The feedback scheduler may make the statements of one feature more likely.
   cl_stmt_table = new DistributionTable();
   cl_stmt_table->add_entry(kBarrier, 5);
-  cl_stmt_table->add_entry(kEMI, 5);
-  cl_stmt_table->add_entry(kReduction, 5);
-  cl_stmt_table->add_entry(kFakeDiverge, 5);
-  cl_stmt_table->add_entry(kComm, 5);
+  cl_stmt_table->add_entry(kEMI,
+      FeedbackScheduler::ScaleWeight(FeedbackScheduler::kEMI, 5));
+  cl_stmt_table->add_entry(kReduction,
+      FeedbackScheduler::ScaleWeight(FeedbackScheduler::kAtomicReductions, 5));
+  cl_stmt_table->add_entry(kFakeDiverge,
+      FeedbackScheduler::ScaleWeight(FeedbackScheduler::kFakeDivergence, 5));
+  cl_stmt_table->add_entry(kComm,
+      FeedbackScheduler::ScaleWeight(FeedbackScheduler::kInterThreadComm, 5));
   cl_stmt_table->add_entry(kMessage, 10);
+  // Only added when enabled, so that programs generated from existing seeds
+  // stay the same.
+  if (CLOptions::atomic_stress())
+    cl_stmt_table->add_entry(kAtomicStress, 10);
 }
 
 Statement *make_random_st(CGContext& cg_context) {
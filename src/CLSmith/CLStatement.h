@@ -25,7 +25,8 @@ class CLStatement : public Statement {
     kFakeDiverge,  // Gross hack alert
     kAtomic,
     kComm,
-    kMessage
+    kMessage,
+    kAtomicStress
   };
 
   CLStatement(CLStatementType type, Block *block)
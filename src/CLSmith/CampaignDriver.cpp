@@ -0,0 +1,277 @@
+#include "CLSmith/CampaignDriver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef _MSC_VER
+#include <dirent.h>
+#endif
+
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/ParallelJobs.h"
+#include "Error.h"
+#include "platform.h"
+
+namespace CLSmith {
+namespace {
+// Milliseconds a single program may take to generate.
+const long kProgramTimeout = 60000;
+// Number of programs tested between two progress reports.
+const unsigned long kProgressInterval = 100;
+// Exit code of the shell when the command cannot be found or run.
+const int kCommandNotRun = 127;
+
+// FNV-1a over the program, without the line giving its seed, so the same
+// program generated from two seeds has the same checksum.
+bool ComputeChecksum(const std::string& fname, unsigned long long *checksum) {
+  std::ifstream in(fname.c_str());
+  if (!in) return false;
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.compare(0, 9, "// Seed: ")) continue;
+    line += '\n';
+    for (char c : line) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 0x100000001b3ULL;
+    }
+  }
+  *checksum = hash;
+  return true;
+}
+
+std::string FormatChecksum(unsigned long long checksum) {
+  std::ostringstream ss;
+  ss << std::hex << std::setfill('0') << std::setw(16) << checksum;
+  return ss.str();
+}
+}  // namespace
+
+CampaignDriver::CampaignDriver(
+    const std::function<int(unsigned long)>& generate, unsigned long seed)
+    : generate_(generate), corpus_(CLOptions::campaign()),
+    work_(corpus_ + "/work"), test_(CLOptions::campaign_test()),
+    next_seed_(seed), programs_(CLOptions::campaign_programs()),
+    generators_(CLOptions::campaign_generators()),
+    launchers_(CLOptions::campaign_launchers()),
+    timeout_(CLOptions::campaign_timeout() * 1000L),
+    memory_(CLOptions::campaign_memory()), started_(0),
+    running_generators_(0), running_launchers_(0), failed_(false),
+    generated_(0), rejected_(0), duplicates_(0) {
+  // Split the cores evenly when neither number is given, otherwise give the
+  // other one the cores left.
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  if (!generators_ && !launchers_)
+    generators_ = std::max<size_t>(1, cores / 2);
+  if (!generators_)
+    generators_ = cores > launchers_ ? cores - launchers_ : 1;
+  if (!launchers_)
+    launchers_ = cores > generators_ ? cores - generators_ : 1;
+  std::fill(outcomes_, outcomes_ + FeedbackScheduler::kNumOutcomes, 0);
+}
+
+bool CampaignDriver::Run() {
+  if (!create_dir(corpus_.c_str()) || !create_dir(work_.c_str())) {
+    std::cerr << "Cannot create the corpus directory " << corpus_ << "."
+              << std::endl;
+    return false;
+  }
+  CleanWorkDirectory();
+  ReadIndex();
+  StopOnInterrupt();
+
+  // Launching comes first, so the programs do not wait for long.
+  RunJobQueue(generators_ + launchers_, [this](std::function<bool()> *job) {
+    Job next;
+    if (CanLaunch()) {
+      next = ready_.front();
+      ready_.pop_front();
+      next.generate = false;
+      ++running_launchers_;
+      *job = [this, next]() { return Launch(next.seed); };
+    } else if (CanGenerate()) {
+      next.generate = true;
+      next.seed = next_seed_++;
+      next.checksum = 0;
+      ++running_generators_;
+      ++generated_;
+      *job = [this, next]() { return Generate(next.seed); };
+    } else {
+      return false;
+    }
+    running_[started_++] = next;
+    return true;
+  }, [this](size_t id, bool success) {
+    Job job = running_[id];
+    running_.erase(id);
+    if (job.generate) {
+      --running_generators_;
+      Generated(job, success);
+    } else {
+      --running_launchers_;
+      Launched(job, success);
+    }
+  });
+
+  // Programs generated but not tested when the campaign was stopped.
+  for (const Job& job : ready_)
+    std::remove(GetWorkFile(job.seed, ".cl").c_str());
+  OutputProgress();
+  return !failed_;
+}
+
+bool CampaignDriver::CanGenerate() const {
+  if (failed_ || Interrupted()) return false;
+  if (programs_ && generated_ >= programs_) return false;
+  return running_generators_ < generators_ &&
+      ready_.size() + running_generators_ < 2 * launchers_;
+}
+
+bool CampaignDriver::CanLaunch() const {
+  return !failed_ && !Interrupted() && !ready_.empty() &&
+      running_launchers_ < launchers_;
+}
+
+bool CampaignDriver::Generate(unsigned long seed) {
+  program_file_ = GetWorkFile(seed, ".cl");
+  CLOptions::output(program_file_.c_str());
+  LimitMemory(memory_);
+  KillAfter(kProgramTimeout);
+  int status = generate_(seed);
+  KillAfter(0);
+  return status == 0 && Error::get_error() == SUCCESS;
+}
+
+bool CampaignDriver::Launch(unsigned long seed) {
+  CommandResult result = RunCommand(test_ + " " + GetWorkFile(seed, ".cl"),
+      GetWorkFile(seed, ".out"), timeout_, memory_);
+  FeedbackScheduler::Outcome outcome = FeedbackScheduler::kCrash;
+  switch (result.status) {
+    case CommandResult::kExited:
+      if (result.code == kCommandNotRun) return false;
+      if (result.code >= 0 && result.code < FeedbackScheduler::kNumOutcomes)
+        outcome = static_cast<FeedbackScheduler::Outcome>(result.code);
+      break;
+    case CommandResult::kSignalled:
+      break;
+    case CommandResult::kTimedOut:
+      outcome = FeedbackScheduler::kTimeout;
+      break;
+    case CommandResult::kInterrupted:
+      return false;
+  }
+  std::ofstream out(GetWorkFile(seed, ".status").c_str());
+  out << FeedbackScheduler::GetOutcomeName(outcome) << std::endl;
+  return static_cast<bool>(out);
+}
+
+void CampaignDriver::Generated(const Job& job, bool success) {
+  std::string program_file = GetWorkFile(job.seed, ".cl");
+  unsigned long long checksum;
+  if (!success || !ComputeChecksum(program_file, &checksum)) {
+    ++rejected_;
+    std::remove(program_file.c_str());
+    return;
+  }
+  if (!seen_.insert(checksum).second) {
+    ++duplicates_;
+    std::remove(program_file.c_str());
+    return;
+  }
+  Job generated = job;
+  generated.checksum = checksum;
+  ready_.push_back(generated);
+}
+
+void CampaignDriver::Launched(const Job& job, bool success) {
+  std::string program_file = GetWorkFile(job.seed, ".cl");
+  std::string output_file = GetWorkFile(job.seed, ".out");
+  std::string status_file = GetWorkFile(job.seed, ".status");
+  std::string name;
+  std::ifstream(status_file.c_str()) >> name;
+  FeedbackScheduler::Outcome outcome;
+  if (success && FeedbackScheduler::ParseOutcome(name.c_str(), &outcome)) {
+    ++outcomes_[outcome];
+    WriteIndex(job, outcome);
+    if (outcome != FeedbackScheduler::kPass) {
+      std::string dir = corpus_ + "/" + name;
+      std::string base = dir + "/" + FormatChecksum(job.checksum);
+      if (create_dir(dir.c_str()) &&
+          !std::rename(program_file.c_str(), (base + ".cl").c_str()) &&
+          !std::rename(output_file.c_str(), (base + ".out").c_str())) {
+        std::cerr << "Seed " << job.seed << ": " << name << ", saved as "
+                  << base << ".cl" << std::endl;
+      } else {
+        std::cerr << "Cannot save the program for seed " << job.seed
+                  << " to " << dir << "." << std::endl;
+      }
+    }
+    unsigned long tested = 0;
+    for (unsigned long count : outcomes_) tested += count;
+    if (tested % kProgressInterval == 0) OutputProgress();
+  } else if (!Interrupted()) {
+    std::cerr << "Cannot run the test command \"" << test_ << "\", see "
+              << output_file << "." << std::endl;
+    failed_ = true;
+    output_file.clear();
+  }
+  std::remove(program_file.c_str());
+  if (!output_file.empty()) std::remove(output_file.c_str());
+  std::remove(status_file.c_str());
+}
+
+void CampaignDriver::ReadIndex() {
+  std::ifstream in((corpus_ + "/index").c_str());
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ss(line);
+    unsigned long long checksum;
+    if (ss >> std::hex >> checksum) seen_.insert(checksum);
+  }
+}
+
+void CampaignDriver::WriteIndex(const Job& job,
+    FeedbackScheduler::Outcome outcome) const {
+  std::ofstream out((corpus_ + "/index").c_str(), std::ios::app);
+  out << FormatChecksum(job.checksum) << " " << job.seed << " "
+      << FeedbackScheduler::GetOutcomeName(outcome) << std::endl;
+}
+
+void CampaignDriver::OutputProgress() const {
+  std::cerr << "Generated " << generated_ << " programs (" << rejected_
+            << " rejected, " << duplicates_ << " duplicates), tested";
+  for (int idx = 0; idx < FeedbackScheduler::kNumOutcomes; ++idx) {
+    std::cerr << (idx ? ", " : " ") << outcomes_[idx] << " "
+              << FeedbackScheduler::GetOutcomeName(
+                  static_cast<FeedbackScheduler::Outcome>(idx));
+  }
+  std::cerr << "." << std::endl;
+}
+
+std::string CampaignDriver::GetWorkFile(unsigned long seed,
+    const char *suffix) const {
+  std::ostringstream ss;
+  ss << work_ << "/" << seed << suffix;
+  return ss.str();
+}
+
+void CampaignDriver::CleanWorkDirectory() const {
+#ifndef _MSC_VER
+  DIR *dir = opendir(work_.c_str());
+  if (!dir) return;
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..") std::remove((work_ + "/" + name).c_str());
+  }
+  closedir(dir);
+#endif
+}
+
+}  // namespace CLSmith
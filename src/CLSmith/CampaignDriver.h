@@ -0,0 +1,118 @@
+// Runs a testing campaign: generates programs from consecutive seeds, runs a
+// test command on each one, and keeps the programs that find something in a
+// corpus directory. It does in one process what the random_test, launchn.pl
+// and cl_get_and_test.py scripts do with a shell per step, along with the
+// scripts cleaning up after them.
+//
+// Generators and launchers are both jobs of the same queue (see RunJobQueue()),
+// with up to --campaign_generators of the first and --campaign_launchers of the
+// second running at a time. Every program is generated in a process forked
+// from this one, so there is no program to start, and the generated programs
+// wait in a queue bounded to twice the number of launchers, so the generators
+// never get far ahead of the launchers. A launcher runs the --campaign_test
+// command with the program file as its last argument, within --campaign_timeout
+// seconds and --campaign_memory megabytes, and kills whatever the command left
+// behind (see RunCommand()). The exit code of the command is the outcome of the
+// program: 0 passes, 1 to 4 are a build failure, a crash, a timeout and a
+// mismatch, like the outcomes of FeedbackScheduler, and anything else is a
+// crash.
+//
+// Programs are identified by the checksum of their text. The checksum, seed
+// and outcome of every program tested are appended to the index file of the
+// corpus, and a program with the checksum of one in the index is not tested
+// again, even by a later campaign. A program that does not pass is moved to
+// <corpus>/<outcome>/<checksum>.cl, along with the output of the test. The
+// campaign runs until --campaign_programs programs are generated, or until it
+// is interrupted, after which the running jobs are waited for.
+
+#ifndef _CLSMITH_CAMPAIGNDRIVER_H_
+#define _CLSMITH_CAMPAIGNDRIVER_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+#include "CLSmith/FeedbackScheduler.h"
+#include "CommonMacros.h"
+
+namespace CLSmith {
+
+class CampaignDriver {
+ public:
+  // generate creates the program for the seed with the current options,
+  // returning the exit code of the generator.
+  CampaignDriver(const std::function<int(unsigned long)>& generate,
+      unsigned long seed);
+  ~CampaignDriver() {}
+
+  // Returns false if the corpus cannot be used, or the test command cannot be
+  // run.
+  bool Run();
+
+ private:
+  // A job of the queue.
+  struct Job {
+    bool generate;
+    unsigned long seed;
+    unsigned long long checksum;
+  };
+
+  // Whether a job of each kind can be started now.
+  bool CanGenerate() const;
+  bool CanLaunch() const;
+
+  // Generates the program for the seed. Only called in a child process.
+  bool Generate(unsigned long seed);
+  // Runs the test on the program, and writes its outcome. Only called in a
+  // child process.
+  bool Launch(unsigned long seed);
+
+  void Generated(const Job& job, bool success);
+  void Launched(const Job& job, bool success);
+
+  void ReadIndex();
+  void WriteIndex(const Job& job, FeedbackScheduler::Outcome outcome) const;
+  void OutputProgress() const;
+
+  std::string GetWorkFile(unsigned long seed, const char *suffix) const;
+  // Removes the files left in the work directory by a campaign that was
+  // killed.
+  void CleanWorkDirectory() const;
+
+  std::function<int(unsigned long)> generate_;
+  std::string corpus_;
+  std::string work_;
+  std::string test_;
+  unsigned long next_seed_;
+  unsigned long programs_;
+  size_t generators_;
+  size_t launchers_;
+  long timeout_;
+  unsigned long memory_;
+
+  // Running jobs, by their index in the queue.
+  std::map<size_t, Job> running_;
+  size_t started_;
+  // Programs generated and waiting for a launcher.
+  std::deque<Job> ready_;
+  size_t running_generators_;
+  size_t running_launchers_;
+  // Checksums of the programs tested, or waiting to be.
+  std::set<unsigned long long> seen_;
+  bool failed_;
+
+  unsigned long generated_;
+  unsigned long rejected_;
+  unsigned long duplicates_;
+  unsigned long outcomes_[FeedbackScheduler::kNumOutcomes];
+  // Output file of the program being generated.
+  std::string program_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(CampaignDriver);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_CAMPAIGNDRIVER_H_
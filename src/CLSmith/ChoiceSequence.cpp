@@ -0,0 +1,50 @@
+#include "CLSmith/ChoiceSequence.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "DeltaMonitor.h"
+#include "SimpleDeltaSequence.h"
+
+namespace CLSmith {
+
+bool ReadChoices(const std::string& filename, ChoiceSequence *sequence) {
+  std::ifstream file(filename.c_str());
+  if (!file.is_open()) return false;
+  sequence->clear();
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find_first_not_of("\t\r ") == std::string::npos) continue;
+    std::stringstream choice(line);
+    int value, bound;
+    char sep;
+    if (!(choice >> value >> sep >> bound) ||
+        sep != SimpleDeltaSequence::default_sep_char)
+      return false;
+    sequence->push_back(Choice(value, bound));
+  }
+  return true;
+}
+
+void WriteChoices(const std::string& filename, const ChoiceSequence& sequence) {
+  std::ofstream file(filename.c_str());
+  for (const Choice& choice : sequence)
+    file << choice.first << SimpleDeltaSequence::default_sep_char
+         << choice.second << std::endl;
+}
+
+bool ReplayChoices(const std::string& input, const std::string& output,
+    bool draw_missing) {
+  std::string msg;
+  if (!DeltaMonitor::init_for_running(msg, "simple", output, input, true)) {
+    std::cerr << msg << std::endl;
+    return false;
+  }
+  DeltaMonitor::set_lenient(true);
+  DeltaMonitor::set_draws_missing(draw_missing);
+  return true;
+}
+
+}  // namespace CLSmith
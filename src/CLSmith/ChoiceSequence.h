@@ -0,0 +1,31 @@
+// Sequences of random choices, in the SimpleDeltaSequence format written by
+// --record_sequence (one "value,bound" line per choice), and their replay.
+
+#ifndef _CLSMITH_CHOICESEQUENCE_H_
+#define _CLSMITH_CHOICESEQUENCE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace CLSmith {
+
+// A choice, as its value and the bound it was chosen under.
+typedef std::pair<int, int> Choice;
+typedef std::vector<Choice> ChoiceSequence;
+
+bool ReadChoices(const std::string& filename, ChoiceSequence *sequence);
+void WriteChoices(const std::string& filename, const ChoiceSequence& sequence);
+
+// Makes the next program be generated from the choices in the input file,
+// which is replayed leniently (see DeltaMonitor::is_lenient()), and the choices
+// actually made be written to the output file. The choices missing from the
+// input are 0, or drawn from the seed with draw_missing (see
+// DeltaMonitor::draws_missing()). Can be called again, in a new process, after
+// a checkpoint.
+bool ReplayChoices(const std::string& input, const std::string& output,
+    bool draw_missing);
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_CHOICESEQUENCE_H_
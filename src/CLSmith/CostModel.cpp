@@ -0,0 +1,359 @@
+#include "CLSmith/CostModel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ArrayVariable.h"
+#include "Block.h"
+#include "CLSmith/CLExpression.h"
+#include "CLSmith/CLProgramGenerator.h"
+#include "CLSmith/CLStatement.h"
+#include "CLSmith/Globals.h"
+#include "CLSmith/StatementAtomicReduction.h"
+#include "CLSmith/StatementAtomicStress.h"
+#include "CLSmith/StatementBarrier.h"
+#include "Constant.h"
+#include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
+#include "Function.h"
+#include "FunctionInvocation.h"
+#include "FunctionInvocationBinary.h"
+#include "FunctionInvocationUser.h"
+#include "Lhs.h"
+#include "Statement.h"
+#include "StatementArrayOp.h"
+#include "StatementAssign.h"
+#include "StatementFor.h"
+#include "Type.h"
+#include "Variable.h"
+
+namespace CLSmith {
+namespace {
+// Loops are simulated for up to this many iterations before being considered
+// to wrap around.
+const long long kMaxSimulatedIterations = 1 << 20;
+// Trip count assumed for loops that cannot be understood.
+const double kUnknownTripCount = 64;
+
+// Parses the value of a constant expression, such as "(-3)" or "0x1FL".
+bool GetConstantValue(const Expression *expression, long long *value) {
+  const Constant *constant = dynamic_cast<const Constant *>(expression);
+  if (constant == NULL) return false;
+  std::string str = constant->get_value();
+  str.erase(std::remove(str.begin(), str.end(), '('), str.end());
+  str.erase(std::remove(str.begin(), str.end(), ')'), str.end());
+  char *end;
+  *value = strtoll(str.c_str(), &end, 0);
+  return end != str.c_str();
+}
+
+// Truncates value to the width of the induction variable, as it would be on
+// the device.
+long long Wrap(long long value, unsigned bits, bool is_signed) {
+  if (bits >= 64) return value;
+  unsigned long long mask = (1ULL << bits) - 1;
+  unsigned long long truncated = static_cast<unsigned long long>(value) & mask;
+  if (is_signed && (truncated >> (bits - 1)))
+    truncated |= ~mask;
+  return static_cast<long long>(truncated);
+}
+
+bool Compare(eBinaryOps op, long long lhs, long long rhs) {
+  switch (op) {
+    case eCmpLt: return lhs < rhs;
+    case eCmpLe: return lhs <= rhs;
+    case eCmpGt: return lhs > rhs;
+    case eCmpGe: return lhs >= rhs;
+    case eCmpEq: return lhs == rhs;
+    case eCmpNe: return lhs != rhs;
+    default: assert(false);
+  }
+  return false;
+}
+
+// Number of times the body of a csmith generated loop is run, which is always
+// of the form 'for (i = init; i op limit; i += incr)'.
+double GetTripCount(const StatementFor *loop) {
+  long long init, limit, step;
+  const FunctionInvocationBinary *test =
+      dynamic_cast<const FunctionInvocationBinary *>(
+          loop->get_test()->get_invoke());
+  if (test == NULL || test->param_value.size() != 2 ||
+      !GetConstantValue(loop->get_init()->get_expr(), &init) ||
+      !GetConstantValue(test->param_value[1], &limit) ||
+      !GetConstantValue(loop->get_incr()->get_expr(), &step))
+    return kUnknownTripCount;
+  eBinaryOps op = test->get_operation();
+  if (op < eCmpGt || op > eCmpNe) return kUnknownTripCount;
+
+  std::stringstream incr_op;
+  loop->get_incr()->output_op(incr_op);
+  if (incr_op.str() == "-=" || incr_op.str() == "--") step = -step;
+  else if (incr_op.str() != "+=" && incr_op.str() != "++")
+    return kUnknownTripCount;
+  if (step == 0) return kUnknownTripCount;
+
+  const Type *type = loop->get_init()->get_lhs()->get_var()->type;
+  unsigned bits = type->SizeInBytes() * 8;
+  if (bits == 0 || bits > 64) return kUnknownTripCount;
+  bool is_signed = type->is_signed();
+  long long value = Wrap(init, bits, is_signed);
+  // Types narrower than int are promoted before the comparison, so the limit
+  // only wraps for the wider types.
+  if (bits >= 32) limit = Wrap(limit, bits, is_signed);
+  // Flipping the sign bit gives the order of unsigned 64 bit values.
+  const long long bias = (!is_signed && bits == 64) ? LLONG_MIN : 0;
+  long long trips = 0;
+  while (Compare(op, value ^ bias, limit ^ bias)) {
+    if (++trips == kMaxSimulatedIterations) {
+      // The induction variable wraps around, so the loop runs through the
+      // range of the type, if it finishes at all.
+      return std::max(static_cast<double>(trips),
+          std::pow(2.0, bits) / std::abs(static_cast<double>(step)));
+    }
+    value = Wrap(value + step, bits, is_signed);
+  }
+  return trips;
+}
+
+// Checks if the block always leaves the loop it is in on the first iteration.
+// csmith relies on this to make otherwise infinite loops terminate.
+bool AlwaysExits(const Block *block) {
+  for (const Statement *statement : block->stms) {
+    eStatementType type = statement->get_type();
+    if (type == eReturn || type == eBreak || type == eGoto) return true;
+  }
+  return false;
+}
+
+// Number of times the body of an array loop is run, one loop per dimension.
+double GetTripCount(const StatementArrayOp *loop) {
+  double trips = 1;
+  std::vector<unsigned> sizes = loop->array_var->get_sizes();
+  for (size_t i = 0; i < loop->ctrl_vars.size() && i < sizes.size(); ++i) {
+    int init = loop->inits[i];
+    int incr = loop->incrs[i];
+    if (incr > 0)
+      trips *= std::max(0, ((int)sizes[i] - init + incr - 1) / incr);
+    else if (incr < 0)
+      trips *= std::max(0, init / -incr + 1);
+    else
+      trips *= kUnknownTripCount;
+  }
+  return trips;
+}
+
+// Sums the sizes of the local variables of block and its nested blocks.
+unsigned long GetLocalVariableSize(const Block *block) {
+  unsigned long size = 0;
+  for (const Variable *var : block->local_vars)
+    size += Globals::GetVariableSize(var);
+  for (const Statement *statement : block->stms) {
+    std::vector<const Block *> blocks;
+    if (statement->get_type() == eBlock)
+      blocks.push_back(dynamic_cast<const Block *>(statement));
+    else
+      statement->get_blocks(blocks);
+    for (const Block *nested : blocks) size += GetLocalVariableSize(nested);
+  }
+  return size;
+}
+}  // namespace
+
+void CostModel::Cost::Add(const Cost& other, double times) {
+  ops += other.ops * times;
+  atomics += other.atomics * times;
+  barriers += other.barriers * times;
+  private_bytes = std::max(private_bytes, other.private_bytes);
+}
+
+void CostModel::EstimateProgram(const Function *entry,
+    const Globals& globals) {
+  assert(entry != NULL);
+  kernel_cost_ = EstimateFunction(entry);
+  struct_bytes_ = globals.GetPrivateFootprint();
+  local_bytes_ = globals.GetLocalFootprint();
+  // The result buffer holds a ulong for every work item.
+  global_bytes_ = globals.GetGlobalFootprint() +
+      8UL * CLProgramGenerator::get_threads();
+}
+
+double CostModel::GetTotalOps() const {
+  return kernel_cost_.ops * CLProgramGenerator::get_threads();
+}
+
+bool CostModel::ExceedsBudget(unsigned long budget) const {
+  return budget && GetTotalOps() > budget;
+}
+
+void CostModel::OutputSummary(std::ostream& out) const {
+  const unsigned threads = CLProgramGenerator::get_threads();
+  std::stringstream ss;
+  ss.precision(3);
+  ss << "// Estimated cost per work item: " << kernel_cost_.ops
+     << " operations, " << kernel_cost_.atomics << " atomic operations, "
+     << kernel_cost_.barriers << " barriers" << std::endl;
+  ss << "// Estimated cost for " << threads << " work items: "
+     << GetTotalOps() << " operations, " << kernel_cost_.atomics * threads
+     << " atomic operations" << std::endl;
+  ss << "// Estimated memory: " << struct_bytes_ + kernel_cost_.private_bytes
+     << " bytes private per work item, " << local_bytes_
+     << " bytes local per group, " << global_bytes_ << " bytes global"
+     << std::endl;
+  out << ss.str();
+}
+
+double CostModel::EstimateTripCount(const Statement *loop) {
+  if (loop->get_type() == eArrayOp)
+    return GetTripCount(dynamic_cast<const StatementArrayOp *>(loop));
+  assert(loop->get_type() == eFor);
+  const StatementFor *for_loop = dynamic_cast<const StatementFor *>(loop);
+  double trips = GetTripCount(for_loop);
+  if (AlwaysExits(for_loop->get_body())) trips = std::min(trips, 1.0);
+  return trips;
+}
+
+CostModel::Cost CostModel::EstimateFunction(const Function *function) {
+  auto it = function_costs_.find(function);
+  if (it != function_costs_.end()) return it->second;
+  if (in_progress_.count(function)) return Cost();
+  in_progress_.insert(function);
+
+  Cost cost = EstimateBlock(function->body);
+  unsigned long frame = GetLocalVariableSize(function->body);
+  for (const Variable *param : function->param)
+    frame += Globals::GetVariableSize(param);
+  cost.private_bytes += frame;
+
+  in_progress_.erase(function);
+  function_costs_[function] = cost;
+  return cost;
+}
+
+CostModel::Cost CostModel::EstimateBlock(const Block *block) {
+  Cost cost;
+  for (const Statement *statement : block->stms)
+    cost.Add(EstimateStatement(statement), 1);
+  return cost;
+}
+
+CostModel::Cost CostModel::EstimateStatement(const Statement *statement) {
+  Cost cost;
+  cost.ops = 1;
+  std::vector<const Expression *> exprs;
+  statement->get_exprs(exprs);
+  for (const Expression *expr : exprs)
+    cost.Add(EstimateExpression(expr), 1);
+
+  switch (statement->get_type()) {
+    case eBlock:
+      cost.Add(EstimateBlock(dynamic_cast<const Block *>(statement)), 1);
+      return cost;
+    case eFor: {
+      // The test is run once more than the body.
+      const StatementFor *loop = dynamic_cast<const StatementFor *>(statement);
+      Cost iteration = EstimateBlock(loop->get_body());
+      iteration.Add(EstimateExpression(loop->get_test()), 1);
+      iteration.ops += 1;
+      cost.Add(iteration, EstimateTripCount(loop));
+      return cost;
+    }
+    case eArrayOp: {
+      const StatementArrayOp *loop =
+          dynamic_cast<const StatementArrayOp *>(statement);
+      Cost iteration;
+      iteration.ops = loop->ctrl_vars.size();
+      if (loop->body) iteration.Add(EstimateBlock(loop->body), 1);
+      if (loop->init_value)
+        iteration.Add(EstimateExpression(loop->init_value), 1);
+      cost.Add(iteration, EstimateTripCount(loop));
+      return cost;
+    }
+    case eCLStatement: {
+      const CLStatement *cl_statement =
+          dynamic_cast<const CLStatement *>(statement);
+      switch (cl_statement->GetCLStatementType()) {
+        case CLStatement::kBarrier:
+          cost.barriers += dynamic_cast<const StatementBarrier *>(statement)
+              ->GetBarrierCount();
+          break;
+        case CLStatement::kAtomic:
+          if (dynamic_cast<const StatementAtomicReduction *>(statement))
+            cost.atomics += 1;
+          break;
+        case CLStatement::kAtomicStress: {
+          const StatementAtomicStress *stress =
+              dynamic_cast<const StatementAtomicStress *>(statement);
+          cost.ops += stress->GetAtomicCount();
+          cost.atomics += stress->GetAtomicCount();
+          break;
+        }
+        default: break;
+      }
+      break;
+    }
+    default: break;
+  }
+
+  // Only the most expensive branch is counted.
+  std::vector<const Block *> blocks;
+  statement->get_blocks(blocks);
+  Cost branch;
+  for (const Block *block : blocks) {
+    Cost block_cost = EstimateBlock(block);
+    if (block_cost.ops >= branch.ops) branch = block_cost;
+  }
+  cost.Add(branch, 1);
+  return cost;
+}
+
+CostModel::Cost CostModel::EstimateExpression(const Expression *expression) {
+  Cost cost;
+  cost.ops = expression->get_complexity();
+  VisitExpression(expression, &cost);
+  return cost;
+}
+
+void CostModel::VisitExpression(const Expression *expression, Cost *cost) {
+  switch (expression->term_type) {
+    case eFunction: {
+      const FunctionInvocation *invoke = expression->get_invoke();
+      const FunctionInvocationUser *call =
+          dynamic_cast<const FunctionInvocationUser *>(invoke);
+      if (call != NULL) cost->Add(EstimateFunction(call->get_func()), 1);
+      for (const Expression *param : invoke->param_value)
+        VisitExpression(param, cost);
+      break;
+    }
+    case eAssignment: {
+      const ExpressionAssign *assign =
+          dynamic_cast<const ExpressionAssign *>(expression);
+      VisitExpression(assign->get_lhs(), cost);
+      VisitExpression(assign->get_rhs(), cost);
+      break;
+    }
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      VisitExpression(comma->get_lhs(), cost);
+      VisitExpression(comma->get_rhs(), cost);
+      break;
+    }
+    case eCLExpression:
+      if (dynamic_cast<const CLExpression *>(expression)
+          ->GetCLExpressionType() == CLExpression::kAtomic)
+        cost->atomics += 1;
+      break;
+    default: break;
+  }
+}
+
+}  // namespace CLSmith
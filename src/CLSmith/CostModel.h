@@ -0,0 +1,94 @@
+// Static estimate of how expensive a generated kernel is to run, so that seeds
+// that would only time out on the device can be rejected up front.
+//
+// The estimate is an upper bound on the work done by a single work item:
+// - every statement costs 1, every expression its csmith complexity;
+// - loop bodies are multiplied by the trip count, computed from the constant
+//   init, limit and increment csmith gives every StatementFor, or from the
+//   array dimensions for StatementArrayOp;
+// - calls cost whatever the callee costs, at every call site;
+// - only the most expensive branch of an if is counted.
+// Memory use is estimated from the sizes of the global struct, the local
+// variables on the deepest call chain and the memory buffers.
+//
+// Nothing here is precise, breaks and returns are ignored and loops that wrap
+// around their induction variable are assumed to run for the whole range of
+// the type. It is only meant to tell the cheap kernels from the hopeless ones.
+
+#ifndef _CLSMITH_COSTMODEL_H_
+#define _CLSMITH_COSTMODEL_H_
+
+#include <map>
+#include <ostream>
+#include <set>
+
+#include "CommonMacros.h"
+
+class Block;
+class Expression;
+class Function;
+namespace CLSmith { class Globals; }
+class Statement;
+
+namespace CLSmith {
+
+class CostModel {
+ public:
+  // Cost of running some part of the program once, by a single work item.
+  struct Cost {
+    Cost() : ops(0), atomics(0), barriers(0), private_bytes(0) {}
+    // Adds other, executed the given number of times. The private memory is
+    // not added, as it is reused between calls.
+    void Add(const Cost& other, double times);
+
+    double ops;
+    double atomics;
+    double barriers;
+    // Private memory needed by the deepest call chain.
+    unsigned long private_bytes;
+  };
+
+  CostModel() {}
+  ~CostModel() {}
+
+  // Estimates the cost of the kernel starting at entry. The globals must have
+  // been collected, but not yet renamed.
+  void EstimateProgram(const Function *entry, const Globals& globals);
+
+  // Estimated number of operations run by all the work items together.
+  double GetTotalOps() const;
+
+  // Checks the total estimated operations against budget. A budget of 0 means
+  // unlimited.
+  bool ExceedsBudget(unsigned long budget) const;
+
+  // Outputs the estimates as comments.
+  void OutputSummary(std::ostream& out) const;
+
+  // Estimated number of times the body of loop is run, for a StatementFor or a
+  // StatementArrayOp.
+  static double EstimateTripCount(const Statement *loop);
+
+ private:
+  Cost EstimateFunction(const Function *function);
+  Cost EstimateBlock(const Block *block);
+  Cost EstimateStatement(const Statement *statement);
+  Cost EstimateExpression(const Expression *expression);
+  // Adds the calls and atomic operations found in expression to cost.
+  void VisitExpression(const Expression *expression, Cost *cost);
+
+  std::map<const Function *, Cost> function_costs_;
+  // Functions currently being estimated, as protection against recursion.
+  std::set<const Function *> in_progress_;
+
+  Cost kernel_cost_;
+  unsigned long struct_bytes_ = 0;
+  unsigned long local_bytes_ = 0;
+  unsigned long global_bytes_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(CostModel);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_COSTMODEL_H_
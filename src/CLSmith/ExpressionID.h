@@ -83,6 +83,9 @@ class ExpressionID : public CLExpression {
   // Both local and global IDs are always divergent.
   bool IsDivergent() const { return true; }
 
+  IDType GetIDType() const { return id_type_; }
+  int GetDimension() const { return dimension_; }
+
  protected:
   IDType id_type_;
   int dimension_;
@@ -0,0 +1,238 @@
+#include "CLSmith/FeedbackScheduler.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include "CLSmith/CLOptions.h"
+
+namespace CLSmith {
+namespace {
+// How much more likely a feature is in its heavy arm.
+const int kHeavyFactor = 4;
+
+struct Arm {
+  const char *name;
+  FeedbackScheduler::Feature feature;
+  bool heavy;
+};
+
+// Heavy arms are only given to features that have entries of their own in the
+// probability tables.
+const Arm kArms[] = {
+  {"baseline", FeedbackScheduler::kNoFeature, false},
+  {"atomics", FeedbackScheduler::kAtomics, false},
+  {"atomic_reductions", FeedbackScheduler::kAtomicReductions, false},
+  {"atomic_reductions_heavy", FeedbackScheduler::kAtomicReductions, true},
+  {"barriers", FeedbackScheduler::kBarriers, false},
+  {"emi", FeedbackScheduler::kEMI, false},
+  {"emi_heavy", FeedbackScheduler::kEMI, true},
+  {"fake_divergence", FeedbackScheduler::kFakeDivergence, false},
+  {"fake_divergence_heavy", FeedbackScheduler::kFakeDivergence, true},
+  {"group_divergence", FeedbackScheduler::kGroupDivergence, false},
+  {"inter_thread_comm", FeedbackScheduler::kInterThreadComm, false},
+  {"inter_thread_comm_heavy", FeedbackScheduler::kInterThreadComm, true},
+  {"vectors", FeedbackScheduler::kVectors, false},
+  {"vectors_heavy", FeedbackScheduler::kVectors, true},
+};
+const size_t kNumArms = sizeof(kArms) / sizeof(kArms[0]);
+
+const char *const kOutcomeNames[FeedbackScheduler::kNumOutcomes] = {
+  "pass", "build_failure", "crash", "timeout", "mismatch"
+};
+
+// Whether the feature can be enabled along with the options already set (see
+// CLOptions::Conflict()).
+bool IsAllowed(FeedbackScheduler::Feature feature) {
+  switch (feature) {
+    case FeedbackScheduler::kBarriers:
+      return !CLOptions::divergence() || CLOptions::track_divergence();
+    case FeedbackScheduler::kFakeDivergence:
+    case FeedbackScheduler::kInterThreadComm:
+      return !CLOptions::divergence();
+    case FeedbackScheduler::kVectors:
+      return !CLOptions::track_divergence();
+    default: return true;
+  }
+}
+
+void Enable(FeedbackScheduler::Feature feature) {
+  switch (feature) {
+    case FeedbackScheduler::kAtomics: CLOptions::atomics(true); break;
+    case FeedbackScheduler::kAtomicReductions:
+      CLOptions::atomic_reductions(true); break;
+    case FeedbackScheduler::kBarriers: CLOptions::barriers(true); break;
+    case FeedbackScheduler::kEMI: CLOptions::emi(true); break;
+    case FeedbackScheduler::kFakeDivergence:
+      CLOptions::fake_divergence(true); break;
+    case FeedbackScheduler::kGroupDivergence:
+      CLOptions::group_divergence(true); break;
+    case FeedbackScheduler::kInterThreadComm:
+      CLOptions::inter_thread_comm(true); break;
+    case FeedbackScheduler::kVectors: CLOptions::vectors(true); break;
+    default: break;
+  }
+}
+
+// Holds an exclusive lock on the file while in scope, through a lock file next
+// to it.
+class FileLock {
+ public:
+  explicit FileLock(const std::string& filename) : fd_(-1) {
+#ifndef _MSC_VER
+    fd_ = open((filename + ".lock").c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd_ >= 0) flock(fd_, LOCK_EX);
+#else
+    (void)filename;
+#endif
+  }
+  ~FileLock() {
+#ifndef _MSC_VER
+    if (fd_ >= 0) {
+      flock(fd_, LOCK_UN);
+      close(fd_);
+    }
+#endif
+  }
+
+ private:
+  int fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileLock);
+};
+}  // namespace
+
+FeedbackScheduler::Feature FeedbackScheduler::heavy_feature_ = kNoFeature;
+
+bool FeedbackScheduler::ChooseArm(unsigned long seed) {
+  FileLock lock(filename_);
+  if (!Load()) return false;
+
+  unsigned long total = 0;
+  for (const Arm& arm : kArms)
+    if (IsAllowed(arm.feature)) total += arms_[arm.name].pulls;
+
+  // Arms that were never chosen go first. Ties are broken from an arm given by
+  // the seed, so that campaigns starting together do not all choose the same.
+  const Arm *best = NULL;
+  double best_score = 0;
+  for (size_t idx = 0; idx < kNumArms; ++idx) {
+    const Arm& arm = kArms[(seed + idx) % kNumArms];
+    if (!IsAllowed(arm.feature)) continue;
+    const ArmState& state = arms_[arm.name];
+    double score = HUGE_VAL;
+    if (state.pulls) {
+      unsigned long bugs = state.outcomes[kBuildFailure] +
+          state.outcomes[kCrash] + state.outcomes[kMismatch];
+      score = static_cast<double>(bugs) / state.pulls +
+          std::sqrt(2 * std::log(static_cast<double>(total)) / state.pulls);
+    }
+    if (!best || score > best_score) {
+      best = &arm;
+      best_score = score;
+    }
+  }
+
+  // Chosen arms count straight away, even though their outcome is not known
+  // yet, so that campaigns running at the same time spread over the arms.
+  ++arms_[best->name].pulls;
+  pending_[seed] = best->name;
+  if (!Save()) return false;
+  Enable(best->feature);
+  heavy_feature_ = best->heavy ? best->feature : kNoFeature;
+  return true;
+}
+
+bool FeedbackScheduler::RecordOutcome(unsigned long seed, Outcome outcome) {
+  FileLock lock(filename_);
+  if (!Load()) return false;
+  std::map<unsigned long, std::string>::iterator it = pending_.find(seed);
+  if (it == pending_.end()) {
+    std::cerr << "No program generated from seed " << seed
+              << " is waiting for its outcome." << std::endl;
+    return false;
+  }
+  ++arms_[it->second].outcomes[outcome];
+  pending_.erase(it);
+  return Save();
+}
+
+bool FeedbackScheduler::ParseOutcome(const char *name, Outcome *outcome) {
+  for (int idx = 0; idx < kNumOutcomes; ++idx) {
+    if (!strcmp(name, kOutcomeNames[idx])) {
+      *outcome = static_cast<Outcome>(idx);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *FeedbackScheduler::GetOutcomeName(Outcome outcome) {
+  return kOutcomeNames[outcome];
+}
+
+int FeedbackScheduler::ScaleWeight(Feature feature, int weight) {
+  return feature == heavy_feature_ && feature != kNoFeature ?
+      weight * kHeavyFactor : weight;
+}
+
+bool FeedbackScheduler::Load() {
+  arms_.clear();
+  pending_.clear();
+  // A campaign starts with no file.
+  std::ifstream file(filename_.c_str());
+  if (!file.is_open()) return true;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::stringstream fields(line);
+    std::string name;
+    fields >> name;
+    bool valid;
+    if (name == "pending") {
+      unsigned long seed;
+      std::string arm;
+      valid = static_cast<bool>(fields >> seed >> arm);
+      if (valid) pending_[seed] = arm;
+    } else {
+      ArmState state = {0, {0}};
+      valid = static_cast<bool>(fields >> state.pulls);
+      for (int idx = 0; idx < kNumOutcomes && valid; ++idx)
+        valid = static_cast<bool>(fields >> state.outcomes[idx]);
+      if (valid) arms_[name] = state;
+    }
+    if (!valid) {
+      std::cerr << "Invalid line in " << filename_ << ": " << line
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FeedbackScheduler::Save() const {
+  std::ofstream file(filename_.c_str());
+  file << "# arm pulls";
+  for (const char *outcome : kOutcomeNames) file << " " << outcome;
+  file << std::endl;
+  for (const std::pair<const std::string, ArmState>& arm : arms_) {
+    file << arm.first << " " << arm.second.pulls;
+    for (unsigned long count : arm.second.outcomes) file << " " << count;
+    file << std::endl;
+  }
+  for (const std::pair<const unsigned long, std::string>& program : pending_)
+    file << "pending " << program.first << " " << program.second << std::endl;
+  return static_cast<bool>(file);
+}
+
+}  // namespace CLSmith
@@ -0,0 +1,93 @@
+// Chooses the features of each program in a testing campaign from the
+// outcomes of the programs before it, instead of leaving them to the user.
+//
+// Each arm of the scheduler enables one feature (atomics, barriers, vectors...)
+// on top of the options given, or also makes the feature more likely in the
+// probability tables of CLSmith (the heavy arms). The arm for a program is
+// chosen with UCB1, where a program that finds a bug (a build failure, a crash
+// or a result mismatch) is worth 1, and the outcome of the program is reported
+// back later, by running CLSmith again with the same seed and
+// --feedback_outcome. The number of times each arm was chosen and the outcomes
+// of its programs are kept in the --feedback file, along with the programs
+// still waiting for their outcome, so the campaign can stop and go on at any
+// time. The file is locked while it is used, so several campaigns can share
+// it.
+
+#ifndef _CLSMITH_FEEDBACKSCHEDULER_H_
+#define _CLSMITH_FEEDBACKSCHEDULER_H_
+
+#include <map>
+#include <string>
+
+#include "CommonMacros.h"
+
+namespace CLSmith {
+
+class FeedbackScheduler {
+ public:
+  enum Outcome {
+    kPass = 0,
+    kBuildFailure,
+    kCrash,
+    kTimeout,
+    kMismatch,
+    kNumOutcomes
+  };
+
+  // Features whose weight in the probability tables can be changed.
+  enum Feature {
+    kNoFeature = 0,
+    kAtomics,
+    kAtomicReductions,
+    kBarriers,
+    kEMI,
+    kFakeDivergence,
+    kGroupDivergence,
+    kInterThreadComm,
+    kVectors
+  };
+
+  explicit FeedbackScheduler(const std::string& filename)
+      : filename_(filename) {}
+  ~FeedbackScheduler() {}
+
+  // Chooses the arm for the program generated from the seed, and enables its
+  // feature. Must be called before the options are resolved. Returns false if
+  // the file cannot be used.
+  bool ChooseArm(unsigned long seed);
+
+  // Records the outcome of the program generated from the seed.
+  bool RecordOutcome(unsigned long seed, Outcome outcome);
+
+  static bool ParseOutcome(const char *name, Outcome *outcome);
+  static const char *GetOutcomeName(Outcome outcome);
+
+  // Weight of an entry for the feature in a probability table, given its
+  // default weight.
+  static int ScaleWeight(Feature feature, int weight);
+
+ private:
+  struct ArmState {
+    unsigned long pulls;
+    unsigned long outcomes[kNumOutcomes];
+  };
+
+  bool Load();
+  bool Save() const;
+
+  std::string filename_;
+  // By the name of the arm, arms that are no longer known are kept as is.
+  std::map<std::string, ArmState> arms_;
+  // Name of the arm each program waiting for its outcome was generated with,
+  // by seed.
+  std::map<unsigned long, std::string> pending_;
+
+  // The feature made more likely for this program.
+  static Feature heavy_feature_;
+
+  DISALLOW_COPY_AND_ASSIGN(FeedbackScheduler);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_FEEDBACKSCHEDULER_H_
@@ -0,0 +1,304 @@
+#include "CLSmith/Fingerprint.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ArrayVariable.h"
+#include "Block.h"
+#include "CLSmith/CLExpression.h"
+#include "CLSmith/CLStatement.h"
+#include "CLSmith/FunctionInvocationBuiltIn.h"
+#include "Constant.h"
+#include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
+#include "ExpressionVariable.h"
+#include "Function.h"
+#include "FunctionInvocation.h"
+#include "FunctionInvocationBinary.h"
+#include "FunctionInvocationUnary.h"
+#include "FunctionInvocationUser.h"
+#include "Lhs.h"
+#include "Statement.h"
+#include "StatementArrayOp.h"
+#include "StatementAssign.h"
+#include "StatementFor.h"
+#include "Type.h"
+#include "Variable.h"
+
+namespace CLSmith {
+namespace {
+// Length of the token sequences hashed into the SimHash.
+const size_t kNGram = 3;
+
+// FNV-1a, so that the tokens hash the same on every platform.
+unsigned long long HashString(const std::string& str) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  for (char c : str) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Mixes value into hash, with the splitmix64 finaliser.
+unsigned long long Combine(unsigned long long hash, unsigned long long value) {
+  hash = (hash ^ value) + 0x9e3779b97f4a7c15ULL;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  return hash ^ (hash >> 31);
+}
+}  // namespace
+
+void Fingerprint::FingerprintProgram() {
+  for (const Function *function : get_all_functions())
+    VisitFunction(function);
+
+  int counts[64] = {0};
+  exact_ = 0;
+  size_t grams = tokens_.size() < kNGram ? 1 : tokens_.size() - kNGram + 1;
+  for (size_t start = 0; start < grams; ++start) {
+    unsigned long long gram = 0;
+    for (size_t idx = start; idx < std::min(start + kNGram, tokens_.size());
+        ++idx)
+      gram = Combine(gram, tokens_[idx]);
+    for (int bit = 0; bit < 64; ++bit)
+      counts[bit] += (gram >> bit) & 1 ? 1 : -1;
+  }
+  for (unsigned long long token : tokens_) exact_ = Combine(exact_, token);
+  simhash_ = 0;
+  for (int bit = 0; bit < 64; ++bit)
+    if (counts[bit] > 0) simhash_ |= 1ULL << bit;
+}
+
+void Fingerprint::OutputSummary(std::ostream& out) const {
+  std::stringstream ss;
+  ss << std::hex << std::setfill('0') << "// Fingerprint: " << std::setw(16)
+     << simhash_ << " " << std::setw(16) << exact_ << std::endl;
+  out << ss.str();
+}
+
+bool Fingerprint::AppendToIndex(const std::string& filename,
+    unsigned long seed, const std::string& program) const {
+  std::stringstream line;
+  line << std::hex << std::setfill('0') << std::setw(16) << simhash_ << " "
+       << std::setw(16) << exact_ << std::dec << " " << seed << " " << program
+       << std::endl;
+  // Written at once, so that generators sharing the index do not interleave
+  // their lines.
+  std::ofstream index(filename.c_str(), std::ios::app);
+  index << line.str() << std::flush;
+  return static_cast<bool>(index);
+}
+
+void Fingerprint::VisitFunction(const Function *function) {
+  AddToken("function");
+  AddFunction(function);
+  AddType(function->return_type);
+  for (const Variable *param : function->param) AddVariable(param);
+  VisitBlock(function->body);
+}
+
+void Fingerprint::VisitBlock(const Block *block) {
+  AddToken("{");
+  for (const Variable *var : block->local_vars) {
+    AddToken("decl");
+    AddVariable(var);
+    if (var->init) VisitExpression(var->init);
+  }
+  for (const Statement *statement : block->stms) VisitStatement(statement);
+  AddToken("}");
+}
+
+void Fingerprint::VisitStatement(const Statement *statement) {
+  std::stringstream kind;
+  kind << "statement" << statement->get_type();
+  switch (statement->get_type()) {
+    case eAssign: {
+      const StatementAssign *assign =
+          dynamic_cast<const StatementAssign *>(statement);
+      assign->output_op(kind);
+      AddToken(kind.str());
+      VisitExpression(assign->get_lhs());
+      VisitExpression(assign->get_expr());
+      return;
+    }
+    case eBlock:
+      VisitBlock(dynamic_cast<const Block *>(statement));
+      return;
+    case eFor: {
+      const StatementFor *loop = dynamic_cast<const StatementFor *>(statement);
+      AddToken(kind.str());
+      VisitStatement(loop->get_init());
+      VisitExpression(loop->get_test());
+      VisitStatement(loop->get_incr());
+      VisitBlock(loop->get_body());
+      return;
+    }
+    case eArrayOp: {
+      const StatementArrayOp *loop =
+          dynamic_cast<const StatementArrayOp *>(statement);
+      AddToken(kind.str());
+      AddVariable(loop->array_var);
+      for (const Variable *var : loop->ctrl_vars) AddVariable(var);
+      break;
+    }
+    case eCLStatement:
+      kind << "." << dynamic_cast<const CLStatement *>(statement)
+          ->GetCLStatementType();
+      AddToken(kind.str());
+      break;
+    default:
+      AddToken(kind.str());
+      break;
+  }
+
+  std::vector<const Expression *> exprs;
+  statement->get_exprs(exprs);
+  for (const Expression *expr : exprs) VisitExpression(expr);
+  std::vector<const Block *> blocks;
+  statement->get_blocks(blocks);
+  for (const Block *block : blocks) VisitBlock(block);
+}
+
+void Fingerprint::VisitExpression(const Expression *expression) {
+  switch (expression->term_type) {
+    case eConstant:
+      AddConstant(dynamic_cast<const Constant *>(expression)->get_value());
+      return;
+    case eVariable: {
+      const ExpressionVariable *expr_var =
+          dynamic_cast<const ExpressionVariable *>(expression);
+      std::stringstream token;
+      token << "variable" << expr_var->get_indirect_level();
+      AddToken(token.str());
+      AddVariable(expr_var->get_var());
+      return;
+    }
+    case eLhs: {
+      const Lhs *lhs = dynamic_cast<const Lhs *>(expression);
+      std::stringstream token;
+      token << "lhs" << lhs->get_indirect_level();
+      AddToken(token.str());
+      AddVariable(lhs->get_var());
+      return;
+    }
+    case eFunction: {
+      const FunctionInvocation *invoke = expression->get_invoke();
+      std::stringstream token;
+      token << "invoke" << invoke->invoke_type << ".";
+      switch (invoke->invoke_type) {
+        case eBinaryPrim:
+          token << dynamic_cast<const FunctionInvocationBinary *>(invoke)
+              ->get_operation();
+          break;
+        case eUnaryPrim:
+          token << dynamic_cast<const FunctionInvocationUnary *>(invoke)
+              ->get_operation();
+          break;
+        case eBuiltIn:
+          dynamic_cast<const FunctionInvocationBuiltIn *>(invoke)
+              ->OutputFuncName(token);
+          break;
+        default: break;
+      }
+      AddToken(token.str());
+      if (invoke->invoke_type == eFuncCall)
+        AddFunction(
+            dynamic_cast<const FunctionInvocationUser *>(invoke)->get_func());
+      for (const Expression *param : invoke->param_value)
+        VisitExpression(param);
+      return;
+    }
+    case eAssignment: {
+      const ExpressionAssign *assign =
+          dynamic_cast<const ExpressionAssign *>(expression);
+      VisitStatement(assign->get_stm_assign());
+      return;
+    }
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      AddToken(",");
+      VisitExpression(comma->get_lhs());
+      VisitExpression(comma->get_rhs());
+      return;
+    }
+    case eCLExpression: {
+      std::stringstream token;
+      token << "clexpression" << dynamic_cast<const CLExpression *>(expression)
+          ->GetCLExpressionType();
+      AddToken(token.str());
+      AddType(&expression->get_type());
+      return;
+    }
+    default:
+      AddToken("expression");
+      return;
+  }
+}
+
+void Fingerprint::AddToken(const std::string& token) {
+  tokens_.push_back(HashString(token));
+}
+
+void Fingerprint::AddType(const Type *type) {
+  std::stringstream token;
+  token << "type" << type->eType;
+  // Only simple types have a simple type.
+  if (type->eType == eSimple) token << "." << type->simple_type;
+  AddToken(token.str());
+}
+
+void Fingerprint::AddVariable(const Variable *variable) {
+  auto it = variables_.find(variable);
+  if (it == variables_.end())
+    it = variables_.insert(std::make_pair(variable, variables_.size())).first;
+  std::stringstream token;
+  token << (variable->is_global() ? "g" : variable->is_argument() ? "p" : "l")
+        << it->second;
+  AddToken(token.str());
+  AddType(variable->type);
+}
+
+void Fingerprint::AddFunction(const Function *function) {
+  auto it = functions_.find(function);
+  if (it == functions_.end())
+    it = functions_.insert(std::make_pair(function, functions_.size())).first;
+  std::stringstream token;
+  token << "f" << it->second;
+  AddToken(token.str());
+}
+
+void Fingerprint::AddConstant(const std::string& value) {
+  std::string str = value;
+  str.erase(std::remove(str.begin(), str.end(), '('), str.end());
+  str.erase(std::remove(str.begin(), str.end(), ')'), str.end());
+  bool negative = !str.empty() && str[0] == '-';
+  if (negative) str.erase(0, 1);
+  char *end;
+  unsigned long long magnitude = strtoull(str.c_str(), &end, 0);
+  // Aggregate initialisers and the like are not bucketed any further.
+  if (end == str.c_str()) {
+    AddToken("constant");
+    return;
+  }
+  std::stringstream token;
+  token << "constant" << (negative ? "-" : "+");
+  if (magnitude <= 1) {
+    token << magnitude;
+  } else {
+    int width = 8;
+    while (width < 64 && magnitude >> width) width *= 2;
+    token << "w" << width;
+  }
+  AddToken(token.str());
+}
+
+}  // namespace CLSmith
@@ -0,0 +1,81 @@
+// Structural fingerprint of a generated program, so that programs differing
+// only in names and constant values can be recognised without comparing their
+// text.
+//
+// The functions are walked in order, turning the AST into a sequence of tokens:
+// statement and expression kinds, operators, types and built-in names, with
+// - variables and functions renamed by the order they first appear in, with
+//   their scope (global, parameter or local) kept;
+// - constants bucketed by sign and width (0, 1 and -1 are kept as they are).
+// Two hashes are computed from the tokens. The exact hash only matches
+// programs with the same normalised AST. The SimHash over every n-gram of
+// tokens differs in few bits for programs that share most of their structure,
+// so near duplicates can be found by Hamming distance (see
+// scripts/cl_dedup.py, which indexes the hashes by bands to avoid comparing
+// every pair of programs).
+
+#ifndef _CLSMITH_FINGERPRINT_H_
+#define _CLSMITH_FINGERPRINT_H_
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "CommonMacros.h"
+
+class Block;
+class Expression;
+class Function;
+class Statement;
+class Type;
+class Variable;
+
+namespace CLSmith {
+
+class Fingerprint {
+ public:
+  Fingerprint() : simhash_(0), exact_(0) {}
+  ~Fingerprint() {}
+
+  // Fingerprints every generated function. Must be done before the program is
+  // output, as the globals are renamed then.
+  void FingerprintProgram();
+
+  unsigned long long GetSimHash() const { return simhash_; }
+  unsigned long long GetExactHash() const { return exact_; }
+
+  // Outputs both hashes as a comment.
+  void OutputSummary(std::ostream& out) const;
+
+  // Appends a "<simhash> <exact hash> <seed> <program file>" line to the index
+  // file.
+  bool AppendToIndex(const std::string& filename, unsigned long seed,
+      const std::string& program) const;
+
+ private:
+  void VisitFunction(const Function *function);
+  void VisitBlock(const Block *block);
+  void VisitStatement(const Statement *statement);
+  void VisitExpression(const Expression *expression);
+
+  void AddToken(const std::string& token);
+  void AddType(const Type *type);
+  void AddVariable(const Variable *variable);
+  void AddFunction(const Function *function);
+  void AddConstant(const std::string& value);
+
+  std::vector<unsigned long long> tokens_;
+  // Names the variables and functions are renamed to.
+  std::map<const Variable *, size_t> variables_;
+  std::map<const Function *, size_t> functions_;
+
+  unsigned long long simhash_;
+  unsigned long long exact_;
+
+  DISALLOW_COPY_AND_ASSIGN(Fingerprint);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_FINGERPRINT_H_
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <ostream>
+#include <string>
 #include <vector>
 
 #include "CLSmith/CLOptions.h"
@@ -25,6 +26,13 @@ const char *const kIntegerNames[20] = {
     "clz"   , "ctz"    , "mad_hi"  , "mad_sat" , "max"  , "min"  , "mul_hi",
     "rotate", "sub_sat", "upsample", "popcount", "mad24", "mul24"
 };
+
+// Outputs the name of type used by the safe math functions, which is the
+// element type followed by the size for vectors.
+void OutputSafeFunctionType(std::ostream& out, const Type& type) {
+  Vector::DemoteVectorTypeToType(&type).Output(out);
+  if (type.eType == eVector) out << type.vector_length_;
+}
 }  // namespace
 
 namespace Internal {
@@ -252,6 +260,13 @@ void FunctionInvocationIntegerBuiltIn::OutputSafeMacro(std::ostream& out)
     const {
   bool requires_macro = (built_in_ == kMadHi && type_.is_signed()) ||
       built_in_ == kMul24 || built_in_ == kMad24 || built_in_ == kClamp;
+  // Functions cannot take the types the macros do, so there is one for each
+  // type, named after it.
+  bool functions = std::string(CLOptions::safe_math_impl()) == "functions";
+  // For clamp, the bounds may be a vector or scalar of the return type.
+  const Type& bound_type = built_in_ == kClamp &&
+      param_value[1]->get_type().eType != eVector ?
+      Vector::DemoteVectorTypeToType(&type_) : type_;
   if (requires_macro) {
     out << "safe_";
   }
@@ -260,21 +275,25 @@ void FunctionInvocationIntegerBuiltIn::OutputSafeMacro(std::ostream& out)
     out << "_func";
     if (built_in_ != kClamp) {
       out << '_';
-      Vector::DemoteVectorTypeToType(&type_).Output(out);
+      if (functions) OutputSafeFunctionType(out, type_);
+      else Vector::DemoteVectorTypeToType(&type_).Output(out);
       for (const Expression *expr : param_value)
         out << '_' << (expr->get_type().is_signed() ? 's' : 'u');
+    } else if (functions) {
+      out << '_';
+      OutputSafeFunctionType(out, type_);
+      out << '_';
+      OutputSafeFunctionType(out, bound_type);
     }
   }
   out << '(';
-  if (requires_macro) {
+  if (requires_macro && !functions) {
     // Conveniently, the first type for all of these macros is the same as the
-    // return type. For clamp, it may be a vector or scalar of the return type.
+    // return type.
     type_.Output(out);
     out << ',';
     if (built_in_ == kClamp) {
-      const Type& param_type = param_value[1]->get_type();
-      if (param_type.eType == eVector) type_.Output(out);
-      else Vector::DemoteVectorTypeToType(&type_).Output(out);
+      bound_type.Output(out);
       out << ',';
     }
   }
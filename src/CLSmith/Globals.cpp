@@ -2,19 +2,32 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <ostream>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "ArrayVariable.h"
 #include "util.h"
+#include "Block.h"
+#include "CLSmith/CLExpression.h"
+#include "CLSmith/ExpressionVector.h"
 #include "CLSmith/MemoryBuffer.h"
 #include "CVQualifiers.h"
+#include "Effect.h"
 #include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
 #include "ExpressionVariable.h"
 #include "Function.h"
+#include "FunctionInvocation.h"
 #include "FunctionInvocationUser.h"
+#include "Lhs.h"
+#include "Statement.h"
+#include "StatementArrayOp.h"
+#include "StatementFor.h"
 #include "Type.h"
 #include "Variable.h"
 #include "VariableSelector.h"
@@ -22,6 +35,185 @@
 namespace CLSmith {
 namespace {
 Globals *globals_inst = NULL;  // Singleton instance.
+
+// Minimum __constant buffer size that every OpenCL device must support. Globals
+// are only moved to constant memory while they fit in this.
+const unsigned long kMaxConstantBytes = 64 * 1024;
+
+bool IsIdentifierChar(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Finds the next reference to name in text at or after pos, ignoring matches
+// that are only part of a longer identifier.
+size_t FindReference(const std::string& text, const std::string& name,
+    size_t pos) {
+  while ((pos = text.find(name, pos)) != std::string::npos) {
+    size_t end = pos + name.length();
+    if ((pos == 0 || !IsIdentifierChar(text[pos - 1])) &&
+        (end == text.length() || !IsIdentifierChar(text[end])))
+      return pos;
+    pos = end;
+  }
+  return std::string::npos;
+}
+
+// Replaces every reference to from in text with to.
+void ReplaceReferences(std::string *text, const std::string& from,
+    const std::string& to) {
+  size_t pos = 0;
+  while ((pos = FindReference(*text, from, pos)) != std::string::npos) {
+    text->replace(pos, from.length(), to);
+    pos += to.length();
+  }
+}
+
+// How the globals are used by the generated functions, collected from their
+// statements and expressions. A reference to an element of a global array is
+// a reference to the array.
+class GlobalUses {
+ public:
+  void VisitFunction(const Function *function) { VisitBlock(function->body); }
+
+  void VisitInit(const Variable *var) {
+    if (var->init) VisitExpression(var->init);
+    if (var->isArray)
+      for (const Expression *init :
+          dynamic_cast<const ArrayVariable *>(var)->get_more_init_values())
+        VisitExpression(init);
+  }
+
+  unsigned GetReferences(const Variable *var) const {
+    auto it = refs_.find(var);
+    return it == refs_.end() ? 0 : it->second;
+  }
+  bool IsWritten(const Variable *var) const { return written_.count(var); }
+  bool IsAddressTaken(const Variable *var) const {
+    return address_taken_.count(var);
+  }
+
+ private:
+  void VisitBlock(const Block *block) {
+    for (const Variable *var : block->local_vars) VisitInit(var);
+    for (const Statement *statement : block->stms) VisitStatement(statement);
+  }
+
+  void VisitStatement(const Statement *statement) {
+    switch (statement->eType) {
+      case eFor: {
+        // The initialisation and increment are not among the expressions.
+        const StatementFor *loop =
+            dynamic_cast<const StatementFor *>(statement);
+        VisitStatement(loop->get_init());
+        VisitStatement(loop->get_incr());
+        break;
+      }
+      case eArrayOp: {
+        const StatementArrayOp *loop =
+            dynamic_cast<const StatementArrayOp *>(statement);
+        AddReference(loop->array_var, loop->init_value != NULL, false);
+        for (const Variable *var : loop->ctrl_vars)
+          AddReference(var, true, false);
+        break;
+      }
+      default: break;
+    }
+    std::vector<const Expression *> exprs;
+    statement->get_exprs(exprs);
+    for (const Expression *expr : exprs) VisitExpression(expr);
+    std::vector<const Block *> blocks;
+    statement->get_blocks(blocks);
+    for (const Block *block : blocks) VisitBlock(block);
+  }
+
+  void VisitExpression(const Expression *expression) {
+    switch (expression->term_type) {
+      case eVariable: {
+        const ExpressionVariable *expr_var =
+            dynamic_cast<const ExpressionVariable *>(expression);
+        AddReference(expr_var->get_var(), false,
+            expr_var->get_indirect_level() < 0);
+        break;
+      }
+      case eLhs: {
+        // Writes through a pointer can only reach globals whose address is
+        // taken.
+        const Lhs *lhs = dynamic_cast<const Lhs *>(expression);
+        AddReference(lhs->get_var(), lhs->get_indirect_level() == 0, false);
+        break;
+      }
+      case eFunction:
+        for (const Expression *param : expression->get_invoke()->param_value)
+          VisitExpression(param);
+        break;
+      case eAssignment:
+        VisitStatement(dynamic_cast<const ExpressionAssign *>(expression)
+            ->get_stm_assign());
+        break;
+      case eCommaExpr: {
+        const ExpressionComma *comma =
+            dynamic_cast<const ExpressionComma *>(expression);
+        VisitExpression(comma->get_lhs());
+        VisitExpression(comma->get_rhs());
+        break;
+      }
+      case eCLExpression:
+        if (dynamic_cast<const CLExpression *>(expression)
+            ->GetCLExpressionType() == CLExpression::kVector)
+          for (const auto& expr : dynamic_cast<const ExpressionVector *>(
+              expression)->GetExpressions())
+            VisitExpression(expr.get());
+        break;
+      default: break;
+    }
+  }
+
+  void AddReference(const Variable *var, bool written, bool address_taken) {
+    for (; var->field_var_of; var = var->field_var_of) {}
+    var = var->get_collective();
+    ++refs_[var];
+    if (written) written_.insert(var);
+    if (address_taken) address_taken_.insert(var);
+  }
+
+  std::map<const Variable *, unsigned> refs_;
+  std::set<const Variable *> written_;
+  std::set<const Variable *> address_taken_;
+};
+
+// Estimated size of a type on the device. Unlike Type::SizeInBytes(), this
+// handles pointers and unpacked structs, padding fields to their own size.
+unsigned long EstimateTypeSize(const Type *type) {
+  switch (type->eType) {
+    case ePointer: return 8;
+    case eStruct: {
+      unsigned long size = 0, align = 1;
+      for (const Type *field : type->fields) {
+        unsigned long field_size = EstimateTypeSize(field);
+        unsigned long field_align = std::min(std::max(field_size, 1UL), 8UL);
+        size = (size + field_align - 1) / field_align * field_align;
+        size += field_size;
+        align = std::max(align, field_align);
+      }
+      return (size + align - 1) / align * align;
+    }
+    case eUnion: {
+      unsigned long size = 0;
+      for (const Type *field : type->fields)
+        size = std::max(size, EstimateTypeSize(field));
+      return size;
+    }
+    default: return type->SizeInBytes();
+  }
+}
+
+unsigned long EstimateVariableSize(const Variable *var) {
+  unsigned long size = EstimateTypeSize(var->type);
+  if (var->isArray)
+    for (unsigned dim : dynamic_cast<const ArrayVariable *>(var)->get_sizes())
+      size *= dim;
+  return size;
+}
 }  // namespace
 
 void Globals::AddLocalMemoryBuffer(MemoryBuffer *buffer) {
@@ -59,6 +251,12 @@ void Globals::ReleaseGlobals() {
 
 void Globals::OutputStructDefinition(std::ostream& out) {
   if (!struct_type_) CreateGlobalStruct();
+  if (layout_optimised_) {
+    out << "// Global struct: " << GetPrivateFootprint()
+        << " bytes of private memory per work item, " << constant_vars_.size()
+        << " globals (" << GetConstantFootprint()
+        << " bytes) in __constant memory." << std::endl;
+  }
   struct_type_->Output(out);
   out << " {" << std::endl;
   for (Variable *var : global_vars_) {
@@ -66,16 +264,55 @@ void Globals::OutputStructDefinition(std::ostream& out) {
     if (var->isArray && dynamic_cast<ArrayVariable *>(var)->collective)
       continue;
     output_tab(out, 1);
-    var->OutputDecl(out);
+    OutputUnmodifiedDecl(out, var);
     out << ";" << std::endl;
   }
   for (MemoryBuffer *buffer : buffers_) {
     if (buffer->collective) continue;
     output_tab(out, 1);
-    buffer->OutputAliasDecl(out);
+    if (original_names_.count(buffer)) {
+      std::string name = buffer->name;
+      *const_cast<std::string *>(&buffer->name) = original_names_[buffer];
+      buffer->OutputAliasDecl(out);
+      *const_cast<std::string *>(&buffer->name) = name;
+    } else {
+      buffer->OutputAliasDecl(out);
+    }
     out << ";" << std::endl;
   }
   out << "};" << std::endl;
+
+  // The constant globals are initialised where they are declared, as there is
+  // no per work item copy.
+  for (Variable *var : constant_vars_) {
+    MemoryBuffer::OutputMemorySpace(out, MemoryBuffer::kConst);
+    out << " ";
+    var->OutputDecl(out);
+    out << " = ";
+    if (var->isArray) {
+      ArrayVariable *var_array = dynamic_cast<ArrayVariable *>(var);
+      std::vector<std::string> init_strings;
+      init_strings.push_back(var_array->init->to_string());
+      for (const Expression *init : var_array->get_more_init_values())
+        init_strings.push_back(init->to_string());
+      out << var_array->build_initializer_str(init_strings);
+    } else {
+      var->init->Output(out);
+    }
+    out << ";" << std::endl;
+  }
+}
+
+void Globals::OutputUnmodifiedDecl(std::ostream& out, Variable *var) {
+  auto it = original_names_.find(var);
+  if (it == original_names_.end()) {
+    var->OutputDecl(out);
+    return;
+  }
+  std::string name = var->name;
+  *const_cast<std::string *>(&var->name) = it->second;
+  var->OutputDecl(out);
+  *const_cast<std::string *>(&var->name) = name;
 }
 
 void Globals::OutputStructInit(std::ostream& out) {
@@ -146,9 +383,8 @@ void Globals::ModifyGlobalVariableReferences() {
   if (!struct_type_) CreateGlobalStruct();
   // Append the name of our newly created struct to the front of every global
   // variable (eugghhh).
-  std::vector<std::string> names;
   for (Variable *var : global_vars_) {
-    names.push_back(var->name);
+    original_names_[var] = var->name;
     *const_cast<std::string *>(&var->name) =
         struct_var_->name + "->" + var->name;
     if (var->is_aggregate()) ModifyGlobalAggregateVariableReferences(var);
@@ -176,14 +412,129 @@ void Globals::ModifyGlobalVariableReferences() {
 
   // Now add to the buffers.
   for (MemoryBuffer *buffer : buffers_) {
+    original_names_[buffer] = buffer->name;
     *const_cast<std::string *>(&buffer->name) =
         struct_var_->name + "->" + buffer->name;
     if (buffer->is_aggregate()) ModifyGlobalAggregateVariableReferences(buffer);
   }
 }
 
+void Globals::OptimiseLayout() {
+  assert(!original_names_.empty());
+  // The initialisers of the globals may also take addresses.
+  GlobalUses uses;
+  for (Function *function : get_all_functions())
+    if (!function->is_builtin) uses.VisitFunction(function);
+  for (Variable *var : global_vars_) uses.VisitInit(var);
+
+  // Only the globals of the generated program are moved, those added for the
+  // OpenCL features are written by code that is output directly.
+  const std::vector<Variable *>& program_vars =
+      *VariableSelector::GetGlobalVariables();
+  std::vector<Variable *> candidates;
+  for (Variable *var : global_vars_) {
+    if (std::find(program_vars.begin(), program_vars.end(), var) ==
+        program_vars.end())
+      continue;
+    // The effects also see writes made through pointers and by callees.
+    bool written = uses.IsWritten(var);
+    for (Function *function : get_all_functions()) {
+      const Effect& effect = function->get_feffect();
+      if (effect.is_written(var)) written = true;
+      for (const Variable *write_var : effect.get_write_vars())
+        if (write_var->get_collective() == var) written = true;
+    }
+
+    // Aggregates, pointers and volatiles stay in the struct; their fields and
+    // targets are tied to the struct references.
+    if (!written && !uses.IsAddressTaken(var) && var->type->eType == eSimple &&
+        !var->is_volatile() &&
+        (!var->isArray ||
+         dynamic_cast<ArrayVariable *>(var)->collective == NULL))
+      candidates.push_back(var);
+  }
+
+  // The least used globals are moved first, keeping the hot read-only globals
+  // in private memory while the constant memory budget runs out.
+  std::stable_sort(candidates.begin(), candidates.end(),
+      [&uses](const Variable *a, const Variable *b) {
+        return uses.GetReferences(a) < uses.GetReferences(b);
+      });
+  unsigned long constant_bytes = 0;
+  for (Variable *var : candidates) {
+    unsigned long size = EstimateVariableSize(var);
+    if (constant_bytes + size > kMaxConstantBytes) break;
+    constant_bytes += size;
+    constant_vars_.push_back(var);
+  }
+
+  // Remove the constant globals from the struct, then order the remaining
+  // fields by how often they are referenced.
+  for (Variable *var : constant_vars_) {
+    global_vars_.erase(
+        std::find(global_vars_.begin(), global_vars_.end(), var));
+    std::string name = var->name;
+    std::string original_name = original_names_[var];
+    original_names_.erase(var);
+    // Also catches the itemised arrays and the indices using the global.
+    for (Variable *other : *VariableSelector::GetAllVariables())
+      ReplaceReferences(const_cast<std::string *>(&other->name), name,
+          original_name);
+    for (Variable *other : *VariableSelector::GetGlobalVariables())
+      ReplaceReferences(const_cast<std::string *>(&other->name), name,
+          original_name);
+  }
+  std::stable_sort(global_vars_.begin(), global_vars_.end(),
+      [&uses](const Variable *a, const Variable *b) {
+        return uses.GetReferences(a) > uses.GetReferences(b);
+      });
+  layout_optimised_ = true;
+}
+
+unsigned long Globals::GetPrivateFootprint() const {
+  unsigned long size = 0;
+  for (Variable *var : global_vars_) {
+    if (var->isArray && dynamic_cast<ArrayVariable *>(var)->collective)
+      continue;
+    size += EstimateVariableSize(var);
+  }
+  // Buffers are only held as pointers.
+  for (MemoryBuffer *buffer : buffers_)
+    if (!buffer->collective) size += 8;
+  return size;
+}
+
+unsigned long Globals::GetConstantFootprint() const {
+  unsigned long size = 0;
+  for (Variable *var : constant_vars_) size += EstimateVariableSize(var);
+  return size;
+}
+
+unsigned long Globals::GetLocalFootprint() const {
+  unsigned long size = 0;
+  for (MemoryBuffer *buffer : buffers_)
+    if (!buffer->collective &&
+        buffer->GetMemorySpace() == MemoryBuffer::kLocal)
+      size += EstimateVariableSize(buffer);
+  return size;
+}
+
+unsigned long Globals::GetGlobalFootprint() const {
+  unsigned long size = 0;
+  for (MemoryBuffer *buffer : buffers_)
+    if (!buffer->collective &&
+        buffer->GetMemorySpace() == MemoryBuffer::kGlobal)
+      size += EstimateVariableSize(buffer);
+  return size;
+}
+
+unsigned long Globals::GetVariableSize(const Variable *var) {
+  return EstimateVariableSize(var);
+}
+
 void Globals::OutputArrayControlVars(std::ostream& out) const {
   size_t max_dim = Variable::GetMaxArrayDimension(global_vars_);
+  max_dim = std::max(max_dim, Variable::GetMaxArrayDimension(constant_vars_));
   for (MemoryBuffer *buf : buffers_)
     max_dim = std::max(max_dim, buf->get_dimension());
   std::vector<const Variable *>& ctrl_vars = Variable::get_new_ctrl_vars();
@@ -191,8 +542,18 @@ void Globals::OutputArrayControlVars(std::ostream& out) const {
 }
 
 void Globals::HashLocalBuffers(std::ostream& out) const {
-  for (MemoryBuffer *buffer : buffers_)
-    if (buffer->GetMemorySpace() == MemoryBuffer::kLocal) buffer->hash(out);
+  for (MemoryBuffer *buffer : buffers_) {
+    // Only plain values can be folded into the hash.
+    if (buffer->GetMemorySpace() != MemoryBuffer::kLocal ||
+        buffer->collective != NULL || buffer->type->eType != eSimple)
+      continue;
+    unsigned long items = 1;
+    for (unsigned size : buffer->get_sizes()) items *= size;
+    output_tab(out, 1);
+    out << "hash_local_buffer(crc64_context, hash_scratch, ";
+    buffer->Output(out);
+    out << ", " << items << ");" << std::endl;
+  }
 }
 
 const Type& Globals::GetGlobalStructPtrType() {
@@ -35,6 +35,7 @@
 #define _CLSMITH_GLOBALS_H_
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <ostream>
 #include <sstream>
@@ -113,11 +114,39 @@ class Globals {
   // "local_struct->" to the start of every global variable.
   void ModifyGlobalVariableReferences();
 
+  // Chooses the layout of the global struct based on how the globals are used
+  // by the statements of the generated functions and by the initialisers.
+  // Fields are ordered by the number of references to them, so the hot fields
+  // share cache lines. Globals that are never written and never have their
+  // address taken (including those never referenced at all) are moved out of
+  // the struct into program scope __constant memory, shrinking the private
+  // memory needed by each work item. Writes and address taking are found from
+  // the assignments and expressions, and from the effects of the functions.
+  // Must be called after ModifyGlobalVariableReferences().
+  void OptimiseLayout();
+
+  // Estimated size in bytes of the global struct, which is held in private
+  // memory by every work item, and of the globals held in __constant memory.
+  unsigned long GetPrivateFootprint() const;
+  unsigned long GetConstantFootprint() const;
+
+  // Estimated size in bytes of the local buffers, allocated once per group,
+  // and of the global buffers passed to the kernel.
+  unsigned long GetLocalFootprint() const;
+  unsigned long GetGlobalFootprint() const;
+
+  // Estimated size of a variable on the device, including all the elements of
+  // an array. Unlike Type::SizeInBytes(), this handles pointers and unpacked
+  // structs.
+  static unsigned long GetVariableSize(const Variable *var);
+
   // Output index variables that will cover all of the indexes for all of the
   // arrays in the global struct.
   void OutputArrayControlVars(std::ostream& out) const;
 
-  // Hash the item in all local buffers that belongs to the work item.
+  // Hash all the items of the local buffers, cooperatively across the group.
+  // A __local uint64_t hash_scratch array with an item for each work item must
+  // be in scope.
   void HashLocalBuffers(std::ostream& out) const;
 
   // Gets the type of the global struct, as a ptr type. The actual type can be
@@ -147,8 +176,17 @@ class Globals {
   // is set to contain the index, rather than it being an itemized variable)
   void FixStructArrays(Variable *field_var, size_t pos);
 
+  // Outputs the declaration of var using the name it had before the reference
+  // to the global struct was added.
+  void OutputUnmodifiedDecl(std::ostream& out, Variable *var);
+
  private:
   std::vector<Variable *> global_vars_;
+  // Globals moved out of the struct by OptimiseLayout().
+  std::vector<Variable *> constant_vars_;
+  bool layout_optimised_ = false;
+  // Names of the globals and buffers before ModifyGlobalVariableReferences().
+  std::map<const Variable *, std::string> original_names_;
   std::vector<MemoryBuffer *> buffers_;
   // Type class generated lazily, needs all the global variables to have been
   // added before creation.
@@ -0,0 +1,277 @@
+#include "CLSmith/KernelFeatures.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Block.h"
+#include "Bookkeeper.h"
+#include "CLSmith/CLExpression.h"
+#include "CLSmith/CLStatement.h"
+#include "CLSmith/ExpressionAtomic.h"
+#include "CLSmith/ExpressionVector.h"
+#include "CLSmith/StatementAtomicReduction.h"
+#include "CLSmith/Vector.h"
+#include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
+#include "FactPointTo.h"
+#include "Function.h"
+#include "FunctionInvocation.h"
+#include "Statement.h"
+#include "Variable.h"
+#include "VariableSelector.h"
+
+namespace CLSmith {
+namespace {
+const char kMagic[] = "CLSFEAT1";
+
+// Indexed by Feature.
+const char *const kFeatureNames[] = {
+  "max_struct_depth",
+  "union_variables",
+  "bitfields",
+  "pointers",
+  "address_taken",
+  "read_dereferences",
+  "write_dereferences",
+  "max_dereference_level",
+  "pointer_null_comparisons",
+  "pointer_comparisons",
+  "pointer_address_comparisons",
+  "volatile_reads",
+  "volatile_writes",
+  "non_volatile_reads",
+  "non_volatile_writes",
+  "forward_jumps",
+  "backward_jumps",
+  "new_variable_uses",
+  "old_variable_uses",
+  "functions",
+  "statements",
+  "max_block_depth",
+  "expressions",
+  "max_expression_depth",
+  "calls",
+  "built_in_calls",
+  "loops",
+  "ifs",
+  "barriers",
+  "emi_blocks",
+  "atomic_blocks",
+  "atomic_reductions",
+  "atomic_stress",
+  "comm_statements",
+  "message_statements",
+  "fake_divergence",
+  "id_expressions",
+  "vector_expressions",
+  "vector_variables",
+};
+static_assert(sizeof(kFeatureNames) / sizeof(kFeatureNames[0]) ==
+    KernelFeatures::kNumFeatures, "every feature must have a name");
+
+void AppendInteger(unsigned long long value, int bytes, std::string *out) {
+  for (int idx = 0; idx < bytes; ++idx)
+    out->push_back(static_cast<char>((value >> (8 * idx)) & 0xff));
+}
+
+// Highest index of a counter that is set, as Bookkeeper prints it.
+unsigned GetMaxLevel(const std::vector<int>& counters) {
+  return counters.empty() ? 0 : counters.size() - 1;
+}
+
+std::string GetHeader() {
+  std::string header(kMagic);
+  AppendInteger(KernelFeatures::kNumFeatures, 4, &header);
+  for (int idx = 0; idx < KernelFeatures::kNumFeatures; ++idx) {
+    header += kFeatureNames[idx];
+    header.push_back('\0');
+  }
+  return header;
+}
+}  // namespace
+
+KernelFeatures::KernelFeatures() {
+  std::fill(counts_, counts_ + kNumFeatures, 0);
+}
+
+void KernelFeatures::CountProgram() {
+  counts_[kMaxStructDepth] = GetMaxLevel(Bookkeeper::struct_depth_cnts);
+  counts_[kUnionVariables] = Bookkeeper::union_var_cnt;
+  counts_[kBitfields] = Bookkeeper::bitfields_in_total;
+  counts_[kPointers] = FactPointTo::all_ptrs.size();
+  counts_[kAddressTaken] = Bookkeeper::address_taken_cnt;
+  counts_[kReadDereferences] = calc_total(Bookkeeper::read_dereference_cnts);
+  counts_[kWriteDereferences] = calc_total(Bookkeeper::write_dereference_cnts);
+  counts_[kMaxDereferenceLevel] =
+      GetMaxLevel(Bookkeeper::dereference_level_cnts);
+  counts_[kPointerNullComparisons] = Bookkeeper::cmp_ptr_to_null;
+  counts_[kPointerComparisons] = Bookkeeper::cmp_ptr_to_ptr;
+  counts_[kPointerAddressComparisons] = Bookkeeper::cmp_ptr_to_addr;
+  counts_[kVolatileReads] = Bookkeeper::read_volatile_cnt;
+  counts_[kVolatileWrites] = Bookkeeper::write_volatile_cnt;
+  counts_[kNonVolatileReads] = Bookkeeper::read_non_volatile_cnt;
+  counts_[kNonVolatileWrites] = Bookkeeper::write_non_volatile_cnt;
+  counts_[kForwardJumps] = Bookkeeper::forward_jump_cnt;
+  counts_[kBackwardJumps] = Bookkeeper::backward_jump_cnt;
+  counts_[kNewVariableUses] = Bookkeeper::use_new_var_cnt;
+  counts_[kOldVariableUses] = Bookkeeper::use_old_var_cnt;
+
+  for (const Function *function : get_all_functions())
+    if (!function->is_builtin) VisitFunction(function);
+  for (const Variable *var : *VariableSelector::GetGlobalVariables())
+    VisitVariable(var);
+}
+
+const char *KernelFeatures::GetFeatureName(Feature feature) {
+  return kFeatureNames[feature];
+}
+
+bool KernelFeatures::CreateFile(const std::string& filename) {
+  std::string header = GetHeader();
+  {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    std::string existing;
+    if (in) {
+      existing.resize(header.size());
+      in.read(&existing[0], header.size());
+      existing.resize(in.gcount());
+    }
+    if (existing == header) return true;
+    if (!existing.empty()) return false;
+  }
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  out << header << std::flush;
+  return static_cast<bool>(out);
+}
+
+bool KernelFeatures::AppendToFile(const std::string& filename,
+    unsigned long seed) const {
+  std::string row;
+  AppendInteger(seed, 8, &row);
+  for (unsigned count : counts_) AppendInteger(count, 4, &row);
+  // Written at once, so that generators sharing the file do not interleave
+  // their rows.
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::app);
+  out << row << std::flush;
+  return static_cast<bool>(out);
+}
+
+void KernelFeatures::VisitFunction(const Function *function) {
+  Count(kFunctions);
+  for (const Variable *param : function->param) VisitVariable(param);
+  VisitBlock(function->body);
+}
+
+void KernelFeatures::VisitBlock(const Block *block) {
+  for (const Variable *var : block->local_vars) {
+    VisitVariable(var);
+    if (var->init) VisitExpression(var->init);
+  }
+  for (const Statement *statement : block->stms) VisitStatement(statement);
+}
+
+void KernelFeatures::VisitStatement(const Statement *statement) {
+  // Counted as Bookkeeper::stat_blk_depths() does.
+  if (statement->eType != eBlock) {
+    Count(kStatements);
+    CountMax(kMaxBlockDepth, statement->get_blk_depth() - 1);
+  }
+  switch (statement->eType) {
+    case eFor:
+    case eArrayOp:
+      Count(kLoops);
+      break;
+    case eIfElse:
+      Count(kIfs);
+      break;
+    case eCLStatement:
+      switch (dynamic_cast<const CLStatement *>(statement)
+          ->GetCLStatementType()) {
+        case CLStatement::kBarrier: Count(kBarriers); break;
+        case CLStatement::kEMI: Count(kEMIBlocks); break;
+        case CLStatement::kFakeDiverge: Count(kFakeDivergence); break;
+        // Both the reductions and the statements recording the results of the
+        // atomic blocks, which are counted at their condition instead.
+        case CLStatement::kAtomic:
+          if (dynamic_cast<const StatementAtomicReduction *>(statement))
+            Count(kAtomicReductions);
+          break;
+        case CLStatement::kComm: Count(kCommStatements); break;
+        case CLStatement::kMessage: Count(kMessageStatements); break;
+        case CLStatement::kAtomicStress: Count(kAtomicStress); break;
+        default: break;
+      }
+      break;
+    default: break;
+  }
+
+  std::vector<const Expression *> exprs;
+  statement->get_exprs(exprs);
+  for (const Expression *expr : exprs) {
+    Count(kExpressions);
+    CountMax(kMaxExpressionDepth, expr->get_complexity());
+    VisitExpression(expr);
+  }
+  std::vector<const Block *> blocks;
+  statement->get_blocks(blocks);
+  for (const Block *block : blocks) VisitBlock(block);
+}
+
+void KernelFeatures::VisitExpression(const Expression *expression) {
+  switch (expression->term_type) {
+    case eFunction: {
+      const FunctionInvocation *invoke = expression->get_invoke();
+      if (invoke->invoke_type == eFuncCall) Count(kCalls);
+      if (invoke->invoke_type == eBuiltIn) Count(kBuiltInCalls);
+      for (const Expression *param : invoke->param_value)
+        VisitExpression(param);
+      break;
+    }
+    case eAssignment: {
+      const ExpressionAssign *assign =
+          dynamic_cast<const ExpressionAssign *>(expression);
+      VisitExpression(assign->get_lhs());
+      VisitExpression(assign->get_rhs());
+      break;
+    }
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      VisitExpression(comma->get_lhs());
+      VisitExpression(comma->get_rhs());
+      break;
+    }
+    case eCLExpression:
+      switch (dynamic_cast<const CLExpression *>(expression)
+          ->GetCLExpressionType()) {
+        case CLExpression::kID: Count(kIDExpressions); break;
+        case CLExpression::kVector:
+          Count(kVectorExpressions);
+          for (const auto& expr : dynamic_cast<const ExpressionVector *>(
+              expression)->GetExpressions())
+            VisitExpression(expr.get());
+          break;
+        // Only made as the condition of an atomic block.
+        case CLExpression::kAtomic:
+          if (dynamic_cast<const ExpressionAtomic *>(expression))
+            Count(kAtomicBlocks);
+          break;
+        default: break;
+      }
+      break;
+    default: break;
+  }
+}
+
+void KernelFeatures::VisitVariable(const Variable *variable) {
+  if (dynamic_cast<const Vector *>(variable)) Count(kVectorVariables);
+}
+
+void KernelFeatures::CountMax(Feature feature, unsigned value) {
+  counts_[feature] = std::max(counts_[feature], value);
+}
+
+}  // namespace CLSmith
@@ -0,0 +1,124 @@
+// Counts of what a generated kernel contains, written to a binary side file
+// with one row per program, so that features can be related to the outcomes
+// of millions of programs without parsing them again.
+//
+// The counts are the statistics Bookkeeper collects during generation
+// (pointers, dereferences, volatile accesses, jumps, struct depth, ...), the
+// block and expression depths it computes when printing its statistics, and
+// counts of the OpenCL features: barriers, EMI blocks, atomic blocks (each
+// counted once, at the atomic condition guarding it) and atomic reductions,
+// inter-thread communication, vector expressions and variables, built-in
+// calls, and so on.
+//
+// The file written by --features starts with a header:
+//   "CLSFEAT1", the number of columns as a 32-bit integer, then the name of
+//   every column, each terminated by a NUL character;
+// followed by the rows, each the 64-bit seed of the program then a 32-bit
+// count per column. Every integer is little-endian. As the rows all have the
+// same width, the file can be mapped as an array of records and read a column
+// at a time (see scripts/cl_features.py, which also joins the rows with the
+// outcomes in a campaign index).
+//
+// The header is written once, before any program is generated, and every
+// program appends its row with a single write, so the generators of a
+// campaign can share the file.
+
+#ifndef _CLSMITH_KERNELFEATURES_H_
+#define _CLSMITH_KERNELFEATURES_H_
+
+#include <string>
+
+#include "CommonMacros.h"
+
+class Block;
+class Expression;
+class Function;
+class Statement;
+class Variable;
+
+namespace CLSmith {
+
+class KernelFeatures {
+ public:
+  enum Feature {
+    // Collected by Bookkeeper.
+    kMaxStructDepth = 0,
+    kUnionVariables,
+    kBitfields,
+    kPointers,
+    kAddressTaken,
+    kReadDereferences,
+    kWriteDereferences,
+    kMaxDereferenceLevel,
+    kPointerNullComparisons,
+    kPointerComparisons,
+    kPointerAddressComparisons,
+    kVolatileReads,
+    kVolatileWrites,
+    kNonVolatileReads,
+    kNonVolatileWrites,
+    kForwardJumps,
+    kBackwardJumps,
+    kNewVariableUses,
+    kOldVariableUses,
+    // Counted over the generated functions.
+    kFunctions,
+    kStatements,
+    kMaxBlockDepth,
+    kExpressions,
+    kMaxExpressionDepth,
+    kCalls,
+    kBuiltInCalls,
+    kLoops,
+    kIfs,
+    // OpenCL features.
+    kBarriers,
+    kEMIBlocks,
+    kAtomicBlocks,
+    kAtomicReductions,
+    kAtomicStress,
+    kCommStatements,
+    kMessageStatements,
+    kFakeDivergence,
+    kIDExpressions,
+    kVectorExpressions,
+    kVectorVariables,
+    kNumFeatures
+  };
+
+  KernelFeatures();
+  ~KernelFeatures() {}
+
+  // Counts the features of the program just generated. Must be done before the
+  // program is output, as the globals are moved then.
+  void CountProgram();
+
+  unsigned GetCount(Feature feature) const { return counts_[feature]; }
+  static const char *GetFeatureName(Feature feature);
+
+  // Writes the header to the file if it is empty or does not exist, or checks
+  // that it has the columns of this version otherwise.
+  static bool CreateFile(const std::string& filename);
+
+  // Appends the row of the program to the file.
+  bool AppendToFile(const std::string& filename, unsigned long seed) const;
+
+ private:
+  void VisitFunction(const Function *function);
+  void VisitBlock(const Block *block);
+  void VisitStatement(const Statement *statement);
+  // Top level expressions of a statement are counted, and their depth.
+  void VisitExpression(const Expression *expression);
+  void VisitVariable(const Variable *variable);
+
+  void Count(Feature feature) { ++counts_[feature]; }
+  void CountMax(Feature feature, unsigned value);
+
+  unsigned counts_[kNumFeatures];
+
+  DISALLOW_COPY_AND_ASSIGN(KernelFeatures);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_KERNELFEATURES_H_
@@ -0,0 +1,334 @@
+#include "CLSmith/KernelReducer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Block.h"
+#include "CGOptions.h"
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CLOutputMgr.h"
+#include "CLSmith/ParallelJobs.h"
+#include "Constant.h"
+#include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
+#include "ExpressionVariable.h"
+#include "Function.h"
+#include "FunctionInvocation.h"
+#include "FunctionInvocationBinary.h"
+#include "Reducer.h"
+#include "Statement.h"
+#include "StatementIf.h"
+#include "Type.h"
+#include "Variable.h"
+
+namespace CLSmith {
+namespace {
+// Number of statements in the largest block reachable from the given one.
+size_t GetLargestBlockSize(const Block *block) {
+  size_t largest = block->stms.size();
+  for (const Statement *statement : block->stms) {
+    std::vector<const Block *> blocks;
+    if (statement->eType == eBlock)
+      blocks.push_back(dynamic_cast<const Block *>(statement));
+    else
+      statement->get_blocks(blocks);
+    for (const Block *inner : blocks)
+      largest = std::max(largest, GetLargestBlockSize(inner));
+  }
+  return largest;
+}
+}  // namespace
+
+KernelReducer::KernelReducer(CLOutputMgr *output_mgr)
+    : output_mgr_(output_mgr), reducer_(NULL), jobs_(CLOptions::reduce_jobs()), tests_run_(0) {
+  // The expression outputs only consult the reducer once it is installed, it
+  // is never configured from a file.
+  if (!CGOptions::get_reducer()) CGOptions::init_reducer("");
+  reducer_ = CGOptions::get_reducer();
+  if (!jobs_) jobs_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool KernelReducer::Reduce() {
+  header_ = output_mgr_->GetBuffer();
+  output_mgr_->StopBuffering();
+  output_mgr_->PrepareOutput();
+  current_ = Render();
+  size_t original_size = current_.size();
+
+  bool interesting = Test(std::vector<std::string>(1, current_))[0];
+  if (!interesting) {
+    std::cerr << "The unreduced program is not interesting, it is output as is."
+              << std::endl;
+  } else {
+    bool progress = true;
+    while (progress) {
+      progress = false;
+      size_t largest = 0;
+      for (const Function *function : get_all_functions())
+        largest = std::max(largest, GetLargestBlockSize(function->body));
+      for (size_t chunk = largest; chunk > 0; chunk /= 2)
+        progress |= RunPass(kDeleteStatements, chunk);
+      progress |= RunPass(kReduceIf, 0);
+      progress |= RunPass(kReduceBinary, 0);
+      progress |= RunPass(kReduceVariable, 0);
+      progress |= RunPass(kReduceInit, 0);
+      std::cerr << "Reduced from " << original_size << " to "
+                << current_.size() << " characters in " << tests_run_
+                << " tests." << std::endl;
+    }
+  }
+
+  for (size_t slot = 0; slot < jobs_; ++slot)
+    std::remove(GetCandidateFile(slot).c_str());
+  output_mgr_->get_main_out() << current_;
+  return interesting;
+}
+
+bool KernelReducer::RunPass(EditKind kind, size_t chunk) {
+  bool progress = false;
+  size_t next = 0;
+  while (true) {
+    // The edits are listed again after every change, as they may have moved.
+    std::vector<Edit> edits;
+    CollectEdits(kind, chunk, &edits);
+    if (next >= edits.size()) break;
+    size_t end = std::min(edits.size(), next + jobs_);
+
+    std::vector<std::string> programs;
+    std::vector<size_t> candidates;
+    for (size_t idx = next; idx < end; ++idx) {
+      Apply(&edits[idx]);
+      std::string program = Render();
+      Undo(&edits[idx]);
+      // Edits to code that is never printed are not worth testing.
+      if (program == current_) continue;
+      programs.push_back(program);
+      candidates.push_back(idx);
+    }
+
+    std::vector<bool> results = Test(programs);
+    size_t accepted = end;
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+      if (!results[idx]) continue;
+      accepted = candidates[idx];
+      current_ = programs[idx];
+      break;
+    }
+    if (accepted == end) {
+      next = end;
+      continue;
+    }
+    Apply(&edits[accepted]);
+    progress = true;
+    next = accepted;
+  }
+  return progress;
+}
+
+void KernelReducer::CollectEdits(EditKind kind, size_t chunk,
+    std::vector<Edit> *edits) {
+  for (Function *function : get_all_functions())
+    CollectBlockEdits(function->body, kind, chunk, edits);
+}
+
+void KernelReducer::CollectBlockEdits(Block *block, EditKind kind,
+    size_t chunk, std::vector<Edit> *edits) {
+  Edit edit = {kind, block, 0, 0, NULL, NULL, NULL, {}, NULL};
+  std::vector<Statement *>& stms = block->stms;
+  // Each block is only split once the chunk is no more than twice its size, so
+  // that deleting a whole block is only tried once.
+  if (kind == kDeleteStatements && !stms.empty() && chunk / 2 < stms.size()) {
+    for (size_t idx = 0; idx < stms.size(); idx += chunk) {
+      edit.index = idx;
+      edit.count = std::min(chunk, stms.size() - idx);
+      edits->push_back(edit);
+    }
+  }
+  if (kind == kReduceInit) {
+    for (Variable *var : block->local_vars) {
+      if (var->type->eType != eSimple || var->isArray || var->init->equals(0))
+        continue;
+      edit.variable = var;
+      edits->push_back(edit);
+    }
+  }
+
+  for (size_t idx = 0; idx < stms.size(); ++idx) {
+    Statement *statement = stms[idx];
+    if (statement->eType == eBlock) {
+      CollectBlockEdits(dynamic_cast<Block *>(statement), kind, chunk, edits);
+      continue;
+    }
+    if (kind == kReduceIf && statement->eType == eIfElse) {
+      edit.index = idx;
+      for (edit.count = 0; edit.count < 2; ++edit.count)
+        edits->push_back(edit);
+    }
+    if (kind == kReduceBinary || kind == kReduceVariable) {
+      std::vector<const Expression *> expressions;
+      statement->get_exprs(expressions);
+      for (const Expression *expression : expressions)
+        CollectExpressionEdits(expression, kind, edits);
+    }
+    std::vector<const Block *> blocks;
+    statement->get_blocks(blocks);
+    for (const Block *inner : blocks)
+      CollectBlockEdits(const_cast<Block *>(inner), kind, chunk, edits);
+  }
+}
+
+void KernelReducer::CollectExpressionEdits(const Expression *expression,
+    EditKind kind, std::vector<Edit> *edits) {
+  Edit edit = {kind, NULL, 0, 0, NULL, NULL, NULL, {}, NULL};
+  switch (expression->term_type) {
+    case eVariable: {
+      const ExpressionVariable *expr_var =
+          dynamic_cast<const ExpressionVariable *>(expression);
+      if (kind != kReduceVariable || expr_var->get_indirect_level() != 0 ||
+          expr_var->get_type().eType != eSimple ||
+          reducer_->map_reduced_vars.count(expression))
+        return;
+      edit.expression = expression;
+      edits->push_back(edit);
+      return;
+    }
+    case eFunction: {
+      const FunctionInvocation *invoke = expression->get_invoke();
+      // Only the replacement of a reduced operation is still printed.
+      auto replaced = reducer_->map_reduced_invocations.find(invoke);
+      if (replaced != reducer_->map_reduced_invocations.end()) {
+        CollectExpressionEdits(replaced->second, kind, edits);
+        return;
+      }
+      if (kind == kReduceBinary &&
+          dynamic_cast<const FunctionInvocationBinary *>(invoke)) {
+        edit.invoke = invoke;
+        for (edit.count = 0; edit.count < 2; ++edit.count) {
+          edit.expression = invoke->param_value[edit.count];
+          // Comparisons of pointers cannot be replaced by the pointers.
+          if (edit.expression->get_type().eType == ePointer) continue;
+          edits->push_back(edit);
+        }
+      }
+      for (const Expression *param : invoke->param_value)
+        CollectExpressionEdits(param, kind, edits);
+      return;
+    }
+    case eAssignment:
+      CollectExpressionEdits(
+          dynamic_cast<const ExpressionAssign *>(expression)->get_rhs(), kind,
+          edits);
+      return;
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      CollectExpressionEdits(comma->get_lhs(), kind, edits);
+      CollectExpressionEdits(comma->get_rhs(), kind, edits);
+      return;
+    }
+    default: return;
+  }
+}
+
+void KernelReducer::Apply(Edit *edit) {
+  switch (edit->kind) {
+    case kDeleteStatements: {
+      std::vector<Statement *>& stms = edit->block->stms;
+      edit->removed.assign(stms.begin() + edit->index,
+          stms.begin() + edit->index + edit->count);
+      stms.erase(stms.begin() + edit->index,
+          stms.begin() + edit->index + edit->count);
+      break;
+    }
+    case kReduceIf: {
+      Statement *&statement = edit->block->stms[edit->index];
+      const StatementIf *if_statement =
+          dynamic_cast<const StatementIf *>(statement);
+      assert(if_statement != NULL);
+      edit->removed.assign(1, statement);
+      statement = const_cast<Block *>(edit->count ?
+          if_statement->get_false_branch() : if_statement->get_true_branch());
+      break;
+    }
+    case kReduceBinary:
+      reducer_->map_reduced_invocations[edit->invoke] = edit->expression;
+      break;
+    case kReduceVariable:
+      reducer_->map_reduced_vars[edit->expression] = "0";
+      break;
+    case kReduceInit:
+      // Variables own their initialiser, so each gets its own constant.
+      edit->init = edit->variable->init;
+      edit->variable->init = Constant::make_int(0);
+      break;
+    default: assert(false);
+  }
+}
+
+void KernelReducer::Undo(Edit *edit) {
+  switch (edit->kind) {
+    case kDeleteStatements: {
+      std::vector<Statement *>& stms = edit->block->stms;
+      stms.insert(stms.begin() + edit->index, edit->removed.begin(),
+          edit->removed.end());
+      break;
+    }
+    case kReduceIf:
+      edit->block->stms[edit->index] = edit->removed[0];
+      break;
+    case kReduceBinary:
+      reducer_->map_reduced_invocations.erase(edit->invoke);
+      break;
+    case kReduceVariable:
+      reducer_->map_reduced_vars.erase(edit->expression);
+      break;
+    case kReduceInit:
+      delete edit->variable->init;
+      edit->variable->init = edit->init;
+      break;
+    default: assert(false);
+  }
+}
+
+std::string KernelReducer::Render() {
+  std::stringstream program;
+  program << header_;
+  output_mgr_->OutputProgram(program);
+  return program.str();
+}
+
+std::vector<bool> KernelReducer::Test(
+    const std::vector<std::string>& programs) {
+  assert(programs.size() <= jobs_);
+  std::vector<std::string> commands;
+  for (size_t slot = 0; slot < programs.size(); ++slot) {
+    std::ofstream file(GetCandidateFile(slot).c_str());
+    file << programs[slot];
+    commands.push_back(std::string(CLOptions::reduce()) + " " +
+        GetCandidateFile(slot));
+  }
+  tests_run_ += programs.size();
+
+  std::vector<std::function<bool()> > jobs;
+  for (const std::string& command : commands)
+    jobs.push_back([command]() { return std::system(command.c_str()) == 0; });
+  return RunJobs(jobs);
+}
+
+std::string KernelReducer::GetCandidateFile(size_t slot) const {
+  std::stringstream name;
+  name << CLOptions::output() << ".reduce" << slot << ".cl";
+  return name.str();
+}
+
+}  // namespace CLSmith
@@ -0,0 +1,113 @@
+// Reduces a generated kernel while it is still in memory, instead of
+// regenerating it from its seed for every candidate as the Reducer driver
+// scripts do.
+//
+// The candidates are the edits made by the csmith Reducer, applied directly to
+// the AST:
+// - deleting statements, in chunks from half a block down to single statements
+//   (active block and statement reduction);
+// - replacing an if with one of its branches (if reduction);
+// - replacing a binary operation with one of its operands, through the
+//   Reducer's reduced invocations (binary reduction);
+// - replacing the use of a variable with 0, through the Reducer's reduced
+//   variables;
+// - setting the initialiser of a local variable to 0 (variable init
+//   reduction).
+// Each candidate is printed to a file and given to the interestingness command
+// set by --reduce, which is run in --reduce_jobs parallel processes. The command
+// gets the file as its last argument and exits with 0 when it is interesting.
+// The first interesting candidate in every batch is kept, so the result does
+// not depend on the order the processes finish in. Passes are repeated until
+// none of them makes progress.
+
+#ifndef _CLSMITH_KERNELREDUCER_H_
+#define _CLSMITH_KERNELREDUCER_H_
+
+#include <string>
+#include <vector>
+
+#include "CommonMacros.h"
+
+class Block;
+class Expression;
+class FunctionInvocation;
+class Reducer;
+class Statement;
+class Variable;
+
+namespace CLSmith {
+
+class CLOutputMgr;
+
+class KernelReducer {
+ public:
+  // The output manager must be buffering, with the header already printed.
+  explicit KernelReducer(CLOutputMgr *output_mgr);
+  ~KernelReducer() {}
+
+  // Reduces the program and writes the result to the output file. If the
+  // unreduced program is not interesting, it is written as is and false is
+  // returned.
+  bool Reduce();
+
+ private:
+  enum EditKind {
+    kDeleteStatements = 0,
+    kReduceIf,
+    kReduceBinary,
+    kReduceVariable,
+    kReduceInit
+  };
+
+  // A single reversible change to the program.
+  struct Edit {
+    EditKind kind;
+    Block *block;
+    size_t index;
+    // Number of statements deleted, or the branch (0 or 1) / operand chosen.
+    size_t count;
+    const FunctionInvocation *invoke;
+    const Expression *expression;
+    Variable *variable;
+    // What the edit replaced, to undo it.
+    std::vector<Statement *> removed;
+    const Expression *init;
+  };
+
+  // Tries every edit of the kind, keeping the interesting ones. chunk is the
+  // number of statements deleted at once.
+  bool RunPass(EditKind kind, size_t chunk);
+
+  // Lists the edits of the kind that can be made to the current program.
+  void CollectEdits(EditKind kind, size_t chunk, std::vector<Edit> *edits);
+  void CollectBlockEdits(Block *block, EditKind kind, size_t chunk,
+      std::vector<Edit> *edits);
+  void CollectExpressionEdits(const Expression *expression, EditKind kind,
+      std::vector<Edit> *edits);
+
+  void Apply(Edit *edit);
+  void Undo(Edit *edit);
+
+  // Prints the whole program, header included.
+  std::string Render();
+
+  // Runs the interestingness command on each of the programs, in parallel.
+  std::vector<bool> Test(const std::vector<std::string>& programs);
+
+  // Path of the file the candidate in the given slot is written to.
+  std::string GetCandidateFile(size_t slot) const;
+
+  CLOutputMgr *output_mgr_;
+  Reducer *reducer_;
+  std::string header_;
+  // The program as it is with every accepted edit.
+  std::string current_;
+  size_t jobs_;
+  size_t tests_run_;
+
+  DISALLOW_COPY_AND_ASSIGN(KernelReducer);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_KERNELREDUCER_H_
@@ -76,7 +76,7 @@ class MemoryBuffer : public ArrayVariable {
   // Alias must be declared with a * instead of a [] for some reason.
   void OutputAliasDecl(std::ostream& out) const;
 
-  MemorySpace GetMemorySpace() { return memory_space_; }
+  MemorySpace GetMemorySpace() const { return memory_space_; }
  private:
   MemorySpace memory_space_;
 };
@@ -0,0 +1,233 @@
+#include "CLSmith/ParallelJobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+namespace CLSmith {
+namespace {
+volatile std::sig_atomic_t interrupted = 0;
+
+void OnInterrupt(int) {
+  interrupted = 1;
+}
+}  // namespace
+
+std::vector<bool> RunJobs(const std::vector<std::function<bool()> >& jobs) {
+  std::vector<bool> results(jobs.size(), false);
+#ifdef _MSC_VER
+  for (size_t idx = 0; idx < jobs.size(); ++idx) results[idx] = jobs[idx]();
+#else
+  size_t copy = Branch(jobs.size(), &results);
+  // _exit, so the buffers inherited from the parent are not flushed twice.
+  if (copy < jobs.size()) _exit(jobs[copy]() ? 0 : 1);
+#endif
+  return results;
+}
+
+void RunJobQueue(size_t workers,
+    const std::function<bool(std::function<bool()> *)>& next_job,
+    const std::function<void(size_t, bool)>& job_done) {
+  size_t started = 0;
+  std::function<bool()> job;
+#ifdef _MSC_VER
+  (void)workers;
+  while (next_job(&job)) {
+    size_t idx = started++;
+    job_done(idx, job());
+  }
+#else
+  std::map<pid_t, size_t> running;
+  pid_t parent = getpid();
+  bool stopping = false;
+  while (true) {
+    while (!stopping && running.size() < workers && next_job(&job)) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        // A process group of its own, so the processes the job starts are
+        // stopped with it.
+        setpgid(0, 0);
+#ifdef __linux__
+        // Stopped as well if this process is killed outright.
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != parent) _exit(1);
+#endif
+        _exit(job() ? 0 : 1);
+      }
+      size_t idx = started++;
+      if (pid < 0) {
+        job_done(idx, false);
+        continue;
+      }
+      setpgid(pid, pid);
+      running[pid] = idx;
+    }
+    if (running.empty()) break;
+    if (!stopping && Interrupted()) {
+      stopping = true;
+      for (const auto& worker : running) kill(-worker.first, SIGTERM);
+    }
+    int status;
+    // Returns early when interrupted, see StopOnInterrupt().
+    pid_t pid = waitpid(-1, &status, 0);
+    std::map<pid_t, size_t>::iterator it = running.find(pid);
+    if (it == running.end()) continue;
+    size_t idx = it->second;
+    running.erase(it);
+    job_done(idx, WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+#endif
+}
+
+size_t Branch(size_t copies, std::vector<bool> *results) {
+  results->assign(copies, false);
+#ifndef _MSC_VER
+  std::vector<pid_t> pids;
+  for (size_t copy = 0; copy < copies; ++copy) {
+    pid_t pid = fork();
+    if (pid == 0) return copy;
+    pids.push_back(pid);
+  }
+  for (size_t idx = 0; idx < pids.size(); ++idx) {
+    int status;
+    if (pids[idx] > 0 && waitpid(pids[idx], &status, 0) == pids[idx])
+      (*results)[idx] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+#endif
+  return copies;
+}
+
+bool JobsHaveOwnProcess() {
+#ifdef _MSC_VER
+  return false;
+#else
+  return true;
+#endif
+}
+
+void KillAfter(long milliseconds) {
+#ifndef _MSC_VER
+  struct itimerval timer = {{0, 0}, {0, 0}};
+  timer.it_value.tv_sec = milliseconds / 1000;
+  timer.it_value.tv_usec = milliseconds % 1000 * 1000;
+  setitimer(ITIMER_REAL, &timer, NULL);
+#else
+  (void)milliseconds;
+#endif
+}
+
+void LimitMemory(unsigned long megabytes) {
+#ifndef _MSC_VER
+  if (!megabytes) return;
+  struct rlimit limit;
+  limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(megabytes) << 20;
+  setrlimit(RLIMIT_AS, &limit);
+#else
+  (void)megabytes;
+#endif
+}
+
+void StopOnInterrupt() {
+#ifndef _MSC_VER
+  // Not restarted, so a wait for a job or command returns when interrupted.
+  struct sigaction action;
+  action.sa_handler = OnInterrupt;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = 0;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+#else
+  std::signal(SIGINT, OnInterrupt);
+  std::signal(SIGTERM, OnInterrupt);
+#endif
+}
+
+void DieOnInterrupt() {
+  std::signal(SIGINT, SIG_DFL);
+  std::signal(SIGTERM, SIG_DFL);
+}
+
+bool Interrupted() {
+  return interrupted;
+}
+
+CommandResult RunCommand(const std::string& command,
+    const std::string& output_file, long milliseconds,
+    unsigned long megabytes) {
+  CommandResult result = {CommandResult::kExited, -1};
+#ifdef _MSC_VER
+  (void)milliseconds;
+  (void)megabytes;
+  result.code =
+      std::system((command + " > " + output_file + " 2>&1").c_str());
+#else
+  pid_t pid = fork();
+  if (pid == 0) {
+    // A process group of its own, so everything it starts can be killed.
+    setpgid(0, 0);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    LimitMemory(megabytes);
+    int in = open("/dev/null", O_RDONLY);
+    int out = open(output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (in < 0 || out < 0) _exit(127);
+    dup2(in, 0);
+    dup2(out, 1);
+    dup2(out, 2);
+    execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(NULL));
+    _exit(127);
+  }
+  if (pid < 0) return result;
+  setpgid(pid, pid);
+
+  // Polls, backing off to 20ms, so short commands are not slowed down.
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(milliseconds);
+  long sleep_us = 500;
+  int status = 0;
+  while (waitpid(pid, &status, WNOHANG) == 0) {
+    bool timed_out = milliseconds &&
+        std::chrono::steady_clock::now() >= deadline;
+    if (timed_out || Interrupted()) {
+      kill(-pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      result.status = timed_out ? CommandResult::kTimedOut :
+          CommandResult::kInterrupted;
+      return result;
+    }
+    struct timespec pause = {0, sleep_us * 1000};
+    nanosleep(&pause, NULL);
+    sleep_us = std::min(sleep_us * 2, 20000L);
+  }
+  kill(-pid, SIGKILL);
+  if (WIFSIGNALED(status)) {
+    result.status = CommandResult::kSignalled;
+    result.code = WTERMSIG(status);
+  } else {
+    result.code = WEXITSTATUS(status);
+  }
+#endif
+  return result;
+}
+
+}  // namespace CLSmith
@@ -0,0 +1,89 @@
+// Runs jobs in separate processes, used by the reducers to test several
+// candidates at once. A separate process also keeps the state of the generator
+// in the parent untouched, and isolates it from candidates that crash.
+//
+// Forking is also how the generator is checkpointed: a forked process is a
+// snapshot of the whole generator (the AST, the facts, the variable tables and
+// the position in the random sequence), copied lazily by the system, that
+// several processes can then continue from in different ways.
+
+#ifndef _CLSMITH_PARALLELJOBS_H_
+#define _CLSMITH_PARALLELJOBS_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace CLSmith {
+
+// Runs every job in a child process of its own, all at the same time, and
+// waits for them. A job succeeds if it returns true, a job that crashes fails.
+// Without fork (on Windows), the jobs are run one after the other in this
+// process instead.
+std::vector<bool> RunJobs(const std::vector<std::function<bool()> >& jobs);
+
+// Runs jobs in up to workers child processes at a time, starting the next job
+// as soon as one ends. next_job is called in this process to get the next job,
+// and returns false when there is none for the moment. job_done is called when
+// a job ends, with its index in the order the jobs were given and whether it
+// succeeded, and may make more jobs available. Returns once there are neither
+// jobs running nor jobs left. Each job runs in a process group of its own.
+// Once this process is interrupted (see StopOnInterrupt()), no more jobs are
+// started, and the process groups of the jobs running are sent SIGTERM and
+// waited for. On Linux, the jobs are also sent SIGTERM if this process dies.
+void RunJobQueue(size_t workers,
+    const std::function<bool(std::function<bool()> *)>& next_job,
+    const std::function<void(size_t, bool)>& job_done);
+
+// Forks the process into copies, all continuing from where Branch() was
+// called, with the whole state of the generator as it is then. Returns the
+// index of the copy in each copy, which must end with _exit(0) when it
+// succeeds. In this process, waits for the copies and returns copies, with
+// whether each one succeeded in results. Only available when
+// JobsHaveOwnProcess(), otherwise no copy is made.
+size_t Branch(size_t copies, std::vector<bool> *results);
+
+// Whether RunJobs() gives each job a process of its own.
+bool JobsHaveOwnProcess();
+
+// Kills this process with SIGALRM after the given number of milliseconds, or
+// never if 0. Used to stop jobs that may never end.
+void KillAfter(long milliseconds);
+
+// Limits the address space of this process, and of the processes it starts, to
+// the given number of megabytes, or not at all if 0.
+void LimitMemory(unsigned long megabytes);
+
+// Makes SIGINT and SIGTERM set a flag instead of killing this process, and the
+// processes forked from it afterwards, so they can stop cleanly.
+void StopOnInterrupt();
+
+// Makes SIGINT and SIGTERM kill this process again, for the processes forked
+// after StopOnInterrupt() that have nothing to clean up.
+void DieOnInterrupt();
+
+// Whether SIGINT or SIGTERM was received since StopOnInterrupt().
+bool Interrupted();
+
+// How a command run by RunCommand() ended.
+struct CommandResult {
+  enum Status { kExited, kSignalled, kTimedOut, kInterrupted };
+  Status status;
+  // The exit code or the signal.
+  int code;
+};
+
+// Runs the command with the shell, with both its outputs written to the output
+// file, and within the given memory limit (see LimitMemory()). The command and
+// every process it starts are killed once it ends, after the given number of
+// milliseconds (never if 0), or when this process is interrupted (see
+// StopOnInterrupt()), so none of them are left behind. Without fork (on
+// Windows), the command is run with std::system(), with neither limit.
+CommandResult RunCommand(const std::string& command,
+    const std::string& output_file, long milliseconds,
+    unsigned long megabytes);
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_PARALLELJOBS_H_
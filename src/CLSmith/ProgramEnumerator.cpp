@@ -0,0 +1,220 @@
+#include "CLSmith/ProgramEnumerator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/ParallelJobs.h"
+#include "Error.h"
+
+namespace CLSmith {
+namespace {
+// Depth the tree is split at when --enumerate_split is not given.
+const size_t kDefaultSplit = 2;
+// Milliseconds a single program may take to generate.
+const long kProgramTimeout = 10000;
+}  // namespace
+
+ProgramEnumerator::ProgramEnumerator(const std::function<int()>& generate)
+    : generate_(generate), output_(CLOptions::output()),
+    progress_file_(CLOptions::enumerate_progress() ?
+        CLOptions::enumerate_progress() : output_ + ".progress"),
+    depth_(CLOptions::enumerate()), split_(CLOptions::enumerate_split()),
+    jobs_(CLOptions::enumerate_jobs()), programs_(0), subtrees_(0) {
+  if (!split_) split_ = std::min(depth_, kDefaultSplit);
+  if (!jobs_) jobs_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool ProgramEnumerator::Enumerate() {
+  ReadProgress();
+  AddTask(split_ > 0, ChoiceSequence());
+  bool complete = true;
+  StopOnInterrupt();
+  RunJobQueue(jobs_, [this](std::function<bool()> *job) {
+    if (frontier_.empty()) return false;
+    size_t id = tasks_.size();
+    tasks_.push_back(frontier_.front());
+    frontier_.pop_front();
+    const Task& task = tasks_.back();
+    if (task.expand) {
+      *job = [this, id, task]() {
+        DieOnInterrupt();
+        return Generate(id, task.prefix);
+      };
+    } else {
+      *job = [this, id, task]() {
+        DieOnInterrupt();
+        return Explore(id, task.prefix);
+      };
+    }
+    return true;
+  }, [this, &complete](size_t id, bool success) {
+    const Task& task = tasks_[id];
+    if (task.expand) {
+      // The program itself is found again when its subtree is explored.
+      ChoiceSequence made;
+      if (ReadChoices(GetTaskFile(id, ".seq.out"), &made))
+        Expand(task.prefix, made);
+      else
+        complete = false;
+    } else {
+      size_t count = 0;
+      std::ifstream(GetTaskFile(id, ".count").c_str()) >> count;
+      if (success) {
+        programs_ += count;
+        ++subtrees_;
+        WriteProgress(task.prefix, count);
+      } else {
+        if (!Interrupted()) {
+          std::cerr << "Could not explore the subtree under the choices "
+                    << FormatPrefix(task.prefix) << "." << std::endl;
+        }
+        complete = false;
+      }
+    }
+    std::remove(GetTaskFile(id, ".cl").c_str());
+    std::remove(GetTaskFile(id, ".seq.in").c_str());
+    std::remove(GetTaskFile(id, ".seq.out").c_str());
+    std::remove(GetTaskFile(id, ".count").c_str());
+  });
+
+  if (Interrupted()) std::cerr << "Interrupted." << std::endl;
+  std::cerr << "Enumerated " << programs_ << " programs in " << subtrees_
+            << " subtrees." << std::endl;
+  return complete;
+}
+
+void ProgramEnumerator::AddTask(bool expand, const ChoiceSequence& prefix) {
+  if (!expand) {
+    std::map<std::string, size_t>::const_iterator it =
+        explored_.find(FormatPrefix(prefix));
+    if (it != explored_.end()) {
+      programs_ += it->second;
+      ++subtrees_;
+      return;
+    }
+  }
+  Task task = {expand, prefix};
+  frontier_.push_back(task);
+}
+
+void ProgramEnumerator::Expand(const ChoiceSequence& prefix,
+    const ChoiceSequence& made) {
+  // The generator does not allow the last choice of the prefix.
+  if (!HasPrefix(made, prefix)) return;
+  // The program ends before the split, it is a subtree of its own.
+  if (made.size() == prefix.size()) {
+    AddTask(false, prefix);
+    return;
+  }
+  ChoiceSequence child = prefix;
+  child.push_back(Choice(0, made[prefix.size()].second));
+  for (; child.back().first < child.back().second; ++child.back().first)
+    AddTask(child.size() < split_, child);
+}
+
+bool ProgramEnumerator::Generate(size_t id, const ChoiceSequence& choices) {
+  WriteChoices(GetTaskFile(id, ".seq.in"), choices);
+  if (!ReplayChoices(GetTaskFile(id, ".seq.in"), GetTaskFile(id, ".seq.out"),
+      true))
+    return false;
+  program_file_ = GetTaskFile(id, ".cl");
+  CLOptions::output(program_file_.c_str());
+  // Sequences that are mostly made up can send the generator into loops that
+  // never end.
+  KillAfter(kProgramTimeout);
+  int status = generate_();
+  KillAfter(0);
+  return status == 0 && Error::get_error() == SUCCESS;
+}
+
+bool ProgramEnumerator::Explore(size_t id, const ChoiceSequence& prefix) {
+  ChoiceSequence choices = prefix;
+  size_t count = 0;
+  while (true) {
+    std::vector<bool> generated = RunJobs(std::vector<std::function<bool()> >(
+        1, [this, id, &choices]() { return Generate(id, choices); }));
+    ChoiceSequence made;
+    bool matches = ReadChoices(GetTaskFile(id, ".seq.out"), &made) &&
+        HasPrefix(made, choices);
+    if (generated[0] && matches)
+      std::rename(GetTaskFile(id, ".cl").c_str(),
+          GetProgramFile(prefix, count++).c_str());
+    else
+      std::remove(GetTaskFile(id, ".cl").c_str());
+    // The generator does not allow the prefix, the subtree is empty.
+    if (!matches && choices.size() == prefix.size()) break;
+
+    // Go down the choices made after these, up to the enumeration depth, then
+    // on to the next value of the deepest choice that has one left.
+    if (matches) {
+      size_t end = std::max(choices.size(), std::min(made.size(), depth_));
+      choices.insert(choices.end(), made.begin() + choices.size(),
+          made.begin() + end);
+    }
+    while (choices.size() > prefix.size() &&
+        choices.back().first + 1 >= choices.back().second)
+      choices.pop_back();
+    if (choices.size() == prefix.size()) break;
+    ++choices.back().first;
+  }
+  std::ofstream(GetTaskFile(id, ".count").c_str()) << count << std::endl;
+  return true;
+}
+
+bool ProgramEnumerator::HasPrefix(const ChoiceSequence& made,
+    const ChoiceSequence& choices) {
+  return made.size() >= choices.size() &&
+      std::equal(choices.begin(), choices.end(), made.begin());
+}
+
+std::string ProgramEnumerator::FormatPrefix(const ChoiceSequence& prefix) {
+  std::stringstream text;
+  for (const Choice& choice : prefix) text << "_" << choice.first;
+  return text.str();
+}
+
+void ProgramEnumerator::ReadProgress() {
+  std::ifstream file(progress_file_.c_str());
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t sep = line.rfind(' ');
+    if (sep == std::string::npos) continue;
+    explored_[line.substr(0, sep)] = std::strtoul(line.c_str() + sep + 1,
+        NULL, 10);
+  }
+}
+
+void ProgramEnumerator::WriteProgress(const ChoiceSequence& prefix,
+    size_t count) const {
+  std::ofstream file(progress_file_.c_str(), std::ios::app);
+  file << FormatPrefix(prefix) << " " << count << std::endl;
+}
+
+std::string ProgramEnumerator::GetProgramFile(const ChoiceSequence& prefix,
+    size_t idx) const {
+  size_t dot = output_.rfind('.');
+  if (dot == std::string::npos || output_.find('/', dot) != std::string::npos)
+    dot = output_.size();
+  std::stringstream name;
+  name << output_.substr(0, dot) << FormatPrefix(prefix) << "-" << idx
+       << output_.substr(dot);
+  return name.str();
+}
+
+std::string ProgramEnumerator::GetTaskFile(size_t id,
+    const char *suffix) const {
+  std::stringstream name;
+  name << output_ << ".enum" << id << suffix;
+  return name.str();
+}
+
+}  // namespace CLSmith
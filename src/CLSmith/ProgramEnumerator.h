@@ -0,0 +1,106 @@
+// Enumerates every program that can be generated with the first --enumerate
+// random choices, in parallel.
+//
+// The programs form a tree, where each node is a choice and each branch one of
+// its values. Programs are found depth-first, by replaying a sequence of
+// choices leniently (see DeltaMonitor::is_lenient()): the choices after the
+// sequence are drawn from the seed (see DeltaMonitor::draws_missing()), as
+// using 0 for all of them can keep the generator retrying forever, and the
+// sequence the generator actually used gives the bounds of the choices to try
+// next. The choices after the enumeration depth are never changed from the
+// ones first drawn. A value that
+// the generator does not allow is moved on to the next one it does, so the
+// program is then skipped, as it is the one for the value it was moved to.
+//
+// The tree is split at the --enumerate_split depth into subtrees. The nodes
+// above it are expanded in worker processes, that feed the subtrees they find
+// to a queue the workers take work from as soon as they are free, so a
+// worker is never idle while there are subtrees left. Each subtree is explored
+// depth-first by a single worker, generating each program in a process of
+// its own, and its programs are named after the choices above the split and
+// their position in the subtree, so the output does not depend on the order
+// the workers run in. Explored subtrees are appended to the progress file, and
+// skipped when the enumeration is run again. Interrupting the enumeration
+// (SIGINT or SIGTERM) kills the workers and the programs they are generating,
+// and the subtrees they were exploring are explored again by the next run.
+
+#ifndef _CLSMITH_PROGRAMENUMERATOR_H_
+#define _CLSMITH_PROGRAMENUMERATOR_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CLSmith/ChoiceSequence.h"
+#include "CommonMacros.h"
+
+namespace CLSmith {
+
+class ProgramEnumerator {
+ public:
+  // generate creates the program with the current options, returning the exit
+  // code of the generator.
+  explicit ProgramEnumerator(const std::function<int()>& generate);
+  ~ProgramEnumerator() {}
+
+  // Writes every program to a file of its own, named after the output file.
+  // Returns false if a subtree could not be explored.
+  bool Enumerate();
+
+ private:
+  // A node of the tree, given by the choices leading to it, which is either
+  // expanded into its children, or explored as a subtree.
+  struct Task {
+    bool expand;
+    ChoiceSequence prefix;
+  };
+
+  // Adds the task, unless it is a subtree explored in a previous run.
+  void AddTask(bool expand, const ChoiceSequence& prefix);
+  // Adds a task for each child of the prefix, given the choices made when
+  // generating the program for it.
+  void Expand(const ChoiceSequence& prefix, const ChoiceSequence& made);
+
+  // Generates the program for the choices, in the files of the task. Only
+  // called in a child process.
+  bool Generate(size_t id, const ChoiceSequence& choices);
+  // Generates every program in the subtree under the prefix, and writes how
+  // many there are to a file of the task. Only called in a worker process.
+  bool Explore(size_t id, const ChoiceSequence& prefix);
+
+  // Whether the choices made start with the given ones.
+  static bool HasPrefix(const ChoiceSequence& made,
+      const ChoiceSequence& choices);
+  // The values of the choices, as used in file names and the progress file.
+  static std::string FormatPrefix(const ChoiceSequence& prefix);
+
+  void ReadProgress();
+  void WriteProgress(const ChoiceSequence& prefix, size_t count) const;
+
+  std::string GetProgramFile(const ChoiceSequence& prefix, size_t idx) const;
+  std::string GetTaskFile(size_t id, const char *suffix) const;
+
+  std::function<int()> generate_;
+  std::string output_;
+  std::string progress_file_;
+  size_t depth_;
+  size_t split_;
+  size_t jobs_;
+  std::deque<Task> frontier_;
+  // Every task started, by id.
+  std::vector<Task> tasks_;
+  // Number of programs in each subtree explored in a previous run.
+  std::map<std::string, size_t> explored_;
+  size_t programs_;
+  size_t subtrees_;
+  // Output file of the program being generated.
+  std::string program_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProgramEnumerator);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_PROGRAMENUMERATOR_H_
@@ -0,0 +1,385 @@
+#include "CLSmith/SafeMathElision.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "Block.h"
+#include "CGOptions.h"
+#include "CLSmith/CLExpression.h"
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CLProgramGenerator.h"
+#include "CLSmith/ExpressionID.h"
+#include "Constant.h"
+#include "Expression.h"
+#include "ExpressionAssign.h"
+#include "ExpressionComma.h"
+#include "Function.h"
+#include "FunctionInvocation.h"
+#include "FunctionInvocationBinary.h"
+#include "FunctionInvocationUnary.h"
+#include "SafeOpFlags.h"
+#include "Statement.h"
+#include "StatementAssign.h"
+#include "StatementFor.h"
+#include "Type.h"
+#include "Variable.h"
+
+namespace CLSmith {
+namespace {
+typedef SafeMathElision::Range Range;
+
+// Values of an integer type of the given size. Unsigned 64 bit integers do not
+// fit, and are unknown.
+Range TypeRange(unsigned bytes, bool is_signed) {
+  if (is_signed) {
+    if (bytes >= 8) return Range(LLONG_MIN, LLONG_MAX);
+    long long max = (1LL << (bytes * 8 - 1)) - 1;
+    return Range(-max - 1, max);
+  }
+  if (bytes >= 8) return Range();
+  return Range(0, (1LL << (bytes * 8)) - 1);
+}
+
+Range TypeRange(const Type& type) {
+  if (type.eType != eSimple || type.simple_type == eVoid) return Range();
+  return TypeRange(type.SizeInBytes(), type.is_signed());
+}
+
+// Whether value is a value of the integer type of the given size.
+bool FitsType(long long value, unsigned bytes, bool is_signed) {
+  if (!is_signed && bytes >= 8) return value >= 0;
+  Range range = TypeRange(bytes, is_signed);
+  return value >= range.lo && value <= range.hi;
+}
+
+bool FitsType(const Range& range, unsigned bytes, bool is_signed) {
+  return range.known && FitsType(range.lo, bytes, is_signed) &&
+      FitsType(range.hi, bytes, is_signed);
+}
+
+// Range of an operand once converted to the type of the operation, which keeps
+// it as it is if it fits.
+Range Convert(const Range& range, unsigned bytes, bool is_signed) {
+  return FitsType(range, bytes, is_signed) ? range :
+      TypeRange(bytes, is_signed);
+}
+
+// Arithmetic on the bounds, failing instead of overflowing.
+bool Add(long long a, long long b, long long *result) {
+  if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b))
+    return false;
+  *result = a + b;
+  return true;
+}
+
+bool Sub(long long a, long long b, long long *result) {
+  if ((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b))
+    return false;
+  *result = a - b;
+  return true;
+}
+
+bool Mul(long long a, long long b, long long *result) {
+  if (a > 0 ? (b > 0 ? a > LLONG_MAX / b : b < LLONG_MIN / a)
+            : (b > 0 ? a < LLONG_MIN / b : a != 0 && b < LLONG_MAX / a))
+    return false;
+  *result = a * b;
+  return true;
+}
+
+// Range of a binary operation applied to every pair of bounds, for operations
+// that are monotonic in both operands.
+template <typename Op>
+Range Corners(const Range& a, const Range& b, Op op) {
+  long long corners[4];
+  if (!op(a.lo, b.lo, &corners[0]) || !op(a.lo, b.hi, &corners[1]) ||
+      !op(a.hi, b.lo, &corners[2]) || !op(a.hi, b.hi, &corners[3]))
+    return Range();
+  return Range(*std::min_element(corners, corners + 4),
+      *std::max_element(corners, corners + 4));
+}
+
+bool Div(long long a, long long b, long long *result) {
+  if (b == 0 || (a == LLONG_MIN && b == -1)) return false;
+  *result = a / b;
+  return true;
+}
+
+// Range of the value of a constant, if it fits its type. The literals are
+// decimal or hexadecimal, may be negative, suffixed or in parentheses.
+Range ConstantRange(const Constant *constant) {
+  std::string value = constant->get_value();
+  if (!value.empty() && value[0] == '(' && value[value.size() - 1] == ')')
+    value = value.substr(1, value.size() - 2);
+  bool negative = !value.empty() && value[0] == '-';
+  if (negative) value = value.substr(1);
+  if (value.empty() || value[0] < '0' || value[0] > '9') return Range();
+  char *end;
+  errno = 0;
+  unsigned long long magnitude = std::strtoull(value.c_str(), &end, 0);
+  if (errno || value.find_first_not_of("uUlL", end - value.c_str()) !=
+      std::string::npos)
+    return Range();
+  if (magnitude > static_cast<unsigned long long>(LLONG_MAX)) return Range();
+  long long literal = negative ? -static_cast<long long>(magnitude) :
+      static_cast<long long>(magnitude);
+  const Type& type = constant->get_type();
+  if (type.eType != eSimple || type.simple_type == eVoid ||
+      !FitsType(literal, type.SizeInBytes(), type.is_signed()))
+    return Range();
+  return Range(literal, literal);
+}
+
+// Range of get_*_id(), from the work sizes given to the kernel.
+Range IDRange(const ExpressionID *id) {
+  const std::vector<unsigned int>& global =
+      CLProgramGenerator::get_global_dims();
+  const std::vector<unsigned int>& local = CLProgramGenerator::get_local_dims();
+  long long count = 1;
+  switch (id->GetIDType()) {
+    case ExpressionID::kGlobal: count = global[id->GetDimension()]; break;
+    case ExpressionID::kLocal: count = local[id->GetDimension()]; break;
+    case ExpressionID::kGroup:
+      count = global[id->GetDimension()] / local[id->GetDimension()];
+      break;
+    case ExpressionID::kLinearGlobal:
+      for (unsigned int dim : global) count *= dim;
+      break;
+    case ExpressionID::kLinearLocal:
+      for (unsigned int dim : local) count *= dim;
+      break;
+    case ExpressionID::kLinearGroup:
+      for (size_t dim = 0; dim < global.size(); ++dim)
+        count *= global[dim] / local[dim];
+      break;
+  }
+  return Range(0, count - 1);
+}
+
+// Range of a binary safe math operation. Sets elidable if the wrapper can be
+// replaced by the plain operator.
+Range BinaryRange(const FunctionInvocationBinary *invoke, bool *elidable) {
+  const SafeOpFlags *flags = invoke->get_op_flags();
+  unsigned bytes = 1u << flags->get_op_size();
+  bool is_signed = flags->get_op1_sign();
+  Range type = TypeRange(bytes, is_signed);
+  Range a = Convert(SafeMathElision::GetRange(invoke->param_value[0]), bytes,
+      is_signed);
+  Range b = SafeMathElision::GetRange(invoke->param_value[1]);
+  eBinaryOps op = invoke->get_operation();
+  // The shift amount is converted to an int, which keeps it if it is in range.
+  if (op != eLShift && op != eRShift) b = Convert(b, bytes, is_signed);
+
+  Range result;
+  if (a.known && b.known) {
+    switch (op) {
+      case eAdd: result = Corners(a, b, Add); break;
+      case eSub: result = Corners(a, b, Sub); break;
+      case eMul: result = Corners(a, b, Mul); break;
+      case eDiv:
+        if (b.lo > 0 || b.hi < 0) result = Corners(a, b, Div);
+        break;
+      case eMod:
+        // As for the division, the remainder of the minimum by -1 overflows.
+        if ((b.lo > 0 || b.hi < 0) &&
+            !(is_signed && a.lo == type.lo && b.lo <= -1 && b.hi >= -1)) {
+          // The remainder is smaller than the divisor, with the sign of the
+          // dividend.
+          long long max = std::max(b.hi, b.lo == LLONG_MIN ? LLONG_MAX : -b.lo);
+          result = Range(std::max(std::min(a.lo, 0LL), 1 - max),
+              std::min(std::max(a.hi, 0LL), max - 1));
+        }
+        break;
+      case eLShift:
+        if (a.lo >= 0 && b.lo >= 0 && b.hi < static_cast<long long>(bytes * 8)
+            && b.hi < 63 && a.hi <= (LLONG_MAX >> b.hi))
+          result = Range(a.lo << b.lo, a.hi << b.hi);
+        break;
+      case eRShift:
+        if (a.lo >= 0 && b.lo >= 0 && b.hi < static_cast<long long>(bytes * 8))
+          result = Range(a.lo >> std::min(b.hi, 63LL), a.hi >> b.lo);
+        break;
+      default: break;
+    }
+  }
+  // Signed wrappers guard against the overflow, but the unsigned ones wrap
+  // around as the plain operators do, except for the multiplication which
+  // is done on promoted operands. Below 32 bits, the unsigned additions and
+  // subtractions are not converted back to the type.
+  bool plain = !is_signed && (op == eAdd || op == eSub);
+  *elidable = plain || FitsType(result, bytes, is_signed);
+  if (*elidable && result.known && (bytes < 4 || FitsType(result, bytes,
+      is_signed)))
+    return result;
+  return type;
+}
+
+// Range of a unary minus. Sets elidable if the wrapper can be replaced by the
+// plain operator.
+Range MinusRange(const FunctionInvocationUnary *invoke, bool *elidable) {
+  const SafeOpFlags *flags = invoke->get_op_flags();
+  unsigned bytes = 1u << flags->get_op_size();
+  bool is_signed = flags->get_op1_sign();
+  Range a = Convert(SafeMathElision::GetRange(invoke->param_value[0]), bytes,
+      is_signed);
+  // The unsigned wrapper is the plain operator, which is not converted back to
+  // the type below 32 bits.
+  if (!is_signed) {
+    *elidable = true;
+    if (bytes < 4) return Range(-a.hi, -a.lo);
+    return TypeRange(bytes, is_signed);
+  }
+  *elidable = a.known && a.lo > TypeRange(bytes, is_signed).lo;
+  if (*elidable) return Range(-a.hi, -a.lo);
+  return TypeRange(bytes, is_signed);
+}
+}  // namespace
+
+void SafeMathElision::CountProgram() {
+  for (const Function *function : get_all_functions())
+    CountBlock(function->body);
+}
+
+void SafeMathElision::OutputSummary(std::ostream& out) const {
+  std::stringstream ss;
+  ss.precision(3);
+  ss << "// Safe math wrappers: " << wrappers_ << ", elided: " << elided_;
+  if (wrappers_) ss << " (" << 100.0 * elided_ / wrappers_ << "%)";
+  ss << std::endl;
+  out << ss.str();
+}
+
+bool SafeMathElision::IsWrapped(const FunctionInvocation *invoke) {
+  if ((invoke->invoke_type != eBinaryPrim &&
+      invoke->invoke_type != eUnaryPrim) ||
+      !CGOptions::avoid_signed_overflow() || !invoke->get_op_flags() ||
+      invoke->param_value[0]->get_type().eType == eVector)
+    return false;
+  std::string fname;
+  if (invoke->invoke_type == eBinaryPrim) {
+    const FunctionInvocationBinary *binary =
+        dynamic_cast<const FunctionInvocationBinary *>(invoke);
+    if (!FunctionInvocationBinary::safe_ops(binary->get_operation()))
+      return false;
+    fname = invoke->get_op_flags()->to_string(binary->get_operation());
+  } else {
+    const FunctionInvocationUnary *unary =
+        dynamic_cast<const FunctionInvocationUnary *>(invoke);
+    if (unary->get_operation() != eMinus) return false;
+    fname = invoke->get_op_flags()->to_string(unary->get_operation());
+  }
+  return CGOptions::safe_math_wrapper(SafeOpFlags::to_id(fname));
+}
+
+bool SafeMathElision::CanElide(const FunctionInvocation *invoke) {
+  if (!CLOptions::elide_safe_math() || !IsWrapped(invoke)) return false;
+  bool elidable = false;
+  if (invoke->invoke_type == eBinaryPrim)
+    BinaryRange(dynamic_cast<const FunctionInvocationBinary *>(invoke),
+        &elidable);
+  else
+    MinusRange(dynamic_cast<const FunctionInvocationUnary *>(invoke),
+        &elidable);
+  return elidable;
+}
+
+SafeMathElision::Range SafeMathElision::GetRange(
+    const Expression *expression) {
+  switch (expression->term_type) {
+    case eConstant:
+      return ConstantRange(dynamic_cast<const Constant *>(expression));
+    case eVariable:
+      return TypeRange(expression->get_type());
+    case eCLExpression:
+      // Not the expressions faking divergence, which are derived from IDs.
+      if (typeid(*expression) == typeid(ExpressionID))
+        return IDRange(dynamic_cast<const ExpressionID *>(expression));
+      return Range();
+    case eFunction: break;
+    default: return Range();
+  }
+
+  const FunctionInvocation *invoke = expression->get_invoke();
+  bool elidable;
+  if (invoke->invoke_type == eBinaryPrim) {
+    const FunctionInvocationBinary *binary =
+        dynamic_cast<const FunctionInvocationBinary *>(invoke);
+    if (IsWrapped(invoke)) return BinaryRange(binary, &elidable);
+    switch (binary->get_operation()) {
+      case eCmpGt: case eCmpLt: case eCmpGe: case eCmpLe: case eCmpEq:
+      case eCmpNe: case eAnd: case eOr:
+        if (expression->get_type().eType == eVector) return Range();
+        return Range(0, 1);
+      default: return Range();
+    }
+  }
+  if (invoke->invoke_type == eUnaryPrim) {
+    const FunctionInvocationUnary *unary =
+        dynamic_cast<const FunctionInvocationUnary *>(invoke);
+    if (IsWrapped(invoke)) return MinusRange(unary, &elidable);
+    if (expression->get_type().eType == eVector) return Range();
+    switch (unary->get_operation()) {
+      case eNot: return Range(0, 1);
+      case ePlus: return GetRange(invoke->param_value[0]);
+      default: return Range();
+    }
+  }
+  return Range();
+}
+
+void SafeMathElision::CountBlock(const Block *block) {
+  for (const Variable *var : block->local_vars)
+    if (var->init) CountExpression(var->init);
+  for (const Statement *statement : block->stms) CountStatement(statement);
+}
+
+void SafeMathElision::CountStatement(const Statement *statement) {
+  if (statement->get_type() == eFor) {
+    const StatementFor *loop = dynamic_cast<const StatementFor *>(statement);
+    CountStatement(loop->get_init());
+    CountStatement(loop->get_incr());
+  }
+  std::vector<const Expression *> exprs;
+  statement->get_exprs(exprs);
+  for (const Expression *expr : exprs) CountExpression(expr);
+  std::vector<const Block *> blocks;
+  statement->get_blocks(blocks);
+  for (const Block *block : blocks) CountBlock(block);
+}
+
+void SafeMathElision::CountExpression(const Expression *expression) {
+  switch (expression->term_type) {
+    case eFunction: {
+      const FunctionInvocation *invoke = expression->get_invoke();
+      if (IsWrapped(invoke)) {
+        ++wrappers_;
+        if (CanElide(invoke)) ++elided_;
+      }
+      for (const Expression *param : invoke->param_value)
+        CountExpression(param);
+      return;
+    }
+    case eAssignment:
+      CountStatement(
+          dynamic_cast<const ExpressionAssign *>(expression)->get_stm_assign());
+      return;
+    case eCommaExpr: {
+      const ExpressionComma *comma =
+          dynamic_cast<const ExpressionComma *>(expression);
+      CountExpression(comma->get_lhs());
+      CountExpression(comma->get_rhs());
+      return;
+    }
+    default:
+      return;
+  }
+}
+
+}  // namespace CLSmith
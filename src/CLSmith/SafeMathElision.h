@@ -0,0 +1,83 @@
+// Value range analysis deciding which safe math wrappers can be replaced by
+// the plain operator, because the operation provably cannot overflow, divide
+// by zero or shift out of range.
+//
+// The range of an expression is only known when it can be derived exactly:
+// - constants whose value fits their type;
+// - variables, which hold any value of their type;
+// - get_*_id() calls, bounded by the work sizes chosen for the kernel;
+// - comparisons and logical operators, which are 0 or 1;
+// - safe math operations, from the ranges of their operands converted to the
+//   type of the operation, or the whole type when they may overflow.
+// Anything else (calls, assignments, bitwise operators, ...) is unknown, and
+// no operation using it is elided. Unsigned 64 bit values do not fit the
+// ranges, which are kept as long longs, so they are unknown too.
+//
+// An elided operation is output as a plain operator on operands cast to the
+// type of the operation, as it is without --safe-math-wrapper. As it cannot
+// overflow, it computes the same value as the wrapper would have.
+
+#ifndef _CLSMITH_SAFEMATHELISION_H_
+#define _CLSMITH_SAFEMATHELISION_H_
+
+#include <ostream>
+
+#include "CommonMacros.h"
+
+class Block;
+class Expression;
+class FunctionInvocation;
+class Statement;
+
+namespace CLSmith {
+
+class SafeMathElision {
+ public:
+  // Inclusive range of the values an expression may have.
+  struct Range {
+    Range() : known(false), lo(0), hi(0) {}
+    Range(long long lo, long long hi) : known(true), lo(lo), hi(hi) {}
+    bool Within(const Range& other) const {
+      return known && other.known && lo >= other.lo && hi <= other.hi;
+    }
+
+    bool known;
+    long long lo;
+    long long hi;
+  };
+
+  SafeMathElision() : wrappers_(0), elided_(0) {}
+  ~SafeMathElision() {}
+
+  // Counts the safe math wrappers in every generated function, and how many
+  // of them are elided.
+  void CountProgram();
+
+  // Outputs the counts as a comment.
+  void OutputSummary(std::ostream& out) const;
+
+  // Whether the unary or binary operation invoke is output with a safe math
+  // wrapper, before any elision.
+  static bool IsWrapped(const FunctionInvocation *invoke);
+
+  // Whether the wrapper of invoke is elided, which is only done with
+  // --elide_safe_math.
+  static bool CanElide(const FunctionInvocation *invoke);
+
+  // Range of the values expression may evaluate to.
+  static Range GetRange(const Expression *expression);
+
+ private:
+  void CountBlock(const Block *block);
+  void CountStatement(const Statement *statement);
+  void CountExpression(const Expression *expression);
+
+  unsigned long wrappers_;
+  unsigned long elided_;
+
+  DISALLOW_COPY_AND_ASSIGN(SafeMathElision);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_SAFEMATHELISION_H_
@@ -0,0 +1,265 @@
+#include "CLSmith/SequenceReducer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/ParallelJobs.h"
+#include "DeltaMonitor.h"
+#include "Error.h"
+#include "Sequence.h"
+
+namespace CLSmith {
+namespace {
+// Generating a candidate may take this many times as long as generating and
+// testing the original program, and at least kMinTimeout milliseconds.
+const long kTimeoutFactor = 10;
+const long kMinTimeout = 1000;
+}  // namespace
+
+SequenceReducer::SequenceReducer(const std::function<int()>& generate)
+    : generate_(generate), command_(CLOptions::reduce()),
+    output_(CLOptions::output()), jobs_(CLOptions::reduce_jobs()),
+    timeout_(0), tests_run_(0), count_(0), branched_(false) {
+  if (!jobs_) jobs_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool SequenceReducer::Reduce() {
+  if (!ReadChoices(CLOptions::reduce_sequence(), &current_)) {
+    std::cerr << "Cannot read the sequence from "
+              << CLOptions::reduce_sequence() << "." << std::endl;
+    return false;
+  }
+  size_t original_length = current_.size();
+
+  std::vector<ChoiceSequence> candidates(1, current_);
+  std::vector<std::string> programs(1);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (!Test(&candidates, &programs)[0]) {
+    std::cerr << "The program generated from the sequence is not interesting."
+              << std::endl;
+    return false;
+  }
+  // Candidates taking much longer than the original are assumed to be stuck.
+  timeout_ = std::max<long>(kMinTimeout, kTimeoutFactor *
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count());
+  current_ = candidates[0];
+  program_ = programs[0];
+
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (size_t chunk = std::max<size_t>(1, current_.size() / 2); chunk > 0;
+        chunk /= 2) {
+      progress |= RunPass([this, chunk](size_t idx, ChoiceSequence *candidate) {
+        if (idx * chunk >= current_.size()) return false;
+        *candidate = current_;
+        candidate->erase(candidate->begin() + idx * chunk,
+            candidate->begin() + std::min(current_.size(), (idx + 1) * chunk));
+        return true;
+      });
+    }
+    progress |= RunPass([this](size_t idx, ChoiceSequence *candidate) {
+      if (idx >= current_.size()) return false;
+      *candidate = current_;
+      (*candidate)[idx].first = 0;
+      return true;
+    });
+    progress |= RunPass([this](size_t idx, ChoiceSequence *candidate) {
+      if (idx >= current_.size()) return false;
+      *candidate = current_;
+      (*candidate)[idx].first /= 2;
+      return true;
+    });
+    std::cerr << "Reduced from " << original_length << " to "
+              << current_.size() << " choices in " << tests_run_ << " tests."
+              << std::endl;
+  }
+
+  std::ofstream program(output_.c_str());
+  program << program_;
+  WriteChoices(CLOptions::record_sequence() ? CLOptions::record_sequence() :
+      output_ + ".seq", current_);
+  return true;
+}
+
+bool SequenceReducer::RunPass(
+    const std::function<bool(size_t, ChoiceSequence *)>& make_candidate) {
+  bool progress = false;
+  size_t next = 0;
+  while (true) {
+    std::vector<ChoiceSequence> candidates;
+    std::vector<size_t> indices;
+    size_t idx = next;
+    bool more = true;
+    while (more && candidates.size() < jobs_) {
+      ChoiceSequence candidate;
+      more = make_candidate(idx, &candidate);
+      // Setting a choice to the value it already has changes nothing.
+      if (more && candidate != current_) {
+        candidates.push_back(candidate);
+        indices.push_back(idx);
+      }
+      ++idx;
+    }
+    if (candidates.empty()) break;
+
+    std::vector<std::string> programs(candidates.size());
+    std::vector<bool> results = Test(&candidates, &programs);
+    size_t accepted = candidates.size();
+    for (size_t slot = 0; slot < candidates.size(); ++slot) {
+      if (results[slot] && IsSmaller(candidates[slot], current_)) {
+        accepted = slot;
+        break;
+      }
+    }
+    if (accepted == candidates.size()) {
+      if (!more) break;
+      next = idx;
+      continue;
+    }
+    current_ = candidates[accepted];
+    program_ = programs[accepted];
+    progress = true;
+    // The choices after the accepted one have moved, so it is tried again.
+    next = indices[accepted];
+  }
+  return progress;
+}
+
+std::vector<bool> SequenceReducer::Test(std::vector<ChoiceSequence> *candidates,
+    std::vector<std::string> *programs) {
+  // The candidates are generated together up to the first choice where any of
+  // them differs from the first one.
+  size_t prefix = (*candidates)[0].size();
+  for (const ChoiceSequence& candidate : *candidates) {
+    size_t pos = 0;
+    while (pos < prefix && pos < candidate.size() &&
+        candidate[pos] == (*candidates)[0][pos])
+      ++pos;
+    prefix = pos;
+  }
+  for (size_t slot = 0; slot < candidates->size(); ++slot)
+    WriteChoices(GetCandidateFile(slot, ".seq.in"), (*candidates)[slot]);
+  std::remove(GetResultsFile().c_str());
+  size_t count = candidates->size();
+  tests_run_ += count;
+  RunJobs(std::vector<std::function<bool()> >(1, [this, count, prefix]() {
+    return RunCandidates(count, prefix);
+  }));
+
+  // A missing file means the generator was killed before the checkpoint.
+  std::string flags;
+  std::ifstream(GetResultsFile().c_str()) >> flags;
+  std::remove(GetResultsFile().c_str());
+  std::vector<bool> results(count, false);
+  for (size_t slot = 0; slot < count; ++slot) {
+    if (slot < flags.size() && flags[slot] == '1') {
+      // Keep the sequence as it was actually used by the generator.
+      results[slot] = ReadChoices(GetCandidateFile(slot, ".seq.out"),
+          &(*candidates)[slot]);
+      std::ifstream program(GetCandidateFile(slot, ".cl").c_str());
+      std::stringstream text;
+      text << program.rdbuf();
+      (*programs)[slot] = text.str();
+    }
+    std::remove(GetCandidateFile(slot, ".seq.in").c_str());
+    std::remove(GetCandidateFile(slot, ".seq.out").c_str());
+    std::remove(GetCandidateFile(slot, ".cl").c_str());
+  }
+  return results;
+}
+
+bool SequenceReducer::RunCandidates(size_t count, size_t prefix) {
+  count_ = count;
+  branched_ = false;
+  if (!StartCandidate(0)) return false;
+  if (count > 1)
+    DeltaMonitor::set_checkpoint(static_cast<int>(prefix),
+        &SequenceReducer::OnCheckpoint, this);
+  // Edited sequences can send the generator into loops that never end.
+  KillAfter(timeout_);
+  int status = generate_();
+  KillAfter(0);
+  bool interesting = status == 0 && Error::get_error() == SUCCESS &&
+      std::system((command_ + " " + program_file_).c_str()) == 0;
+  // If the checkpoint was never reached, the other candidates only differ in
+  // choices that are not made, so they would just repeat this one.
+  if (!branched_) {
+    std::vector<bool> results(count, false);
+    results[0] = interesting;
+    WriteResults(results);
+  }
+  return interesting;
+}
+
+bool SequenceReducer::StartCandidate(size_t slot) {
+  if (!ReplayChoices(GetCandidateFile(slot, ".seq.in"),
+      GetCandidateFile(slot, ".seq.out"), false))
+    return false;
+  program_file_ = GetCandidateFile(slot, ".cl");
+  CLOptions::output(program_file_.c_str());
+  return true;
+}
+
+void SequenceReducer::OnCheckpoint(void *data) {
+  SequenceReducer *reducer = static_cast<SequenceReducer *>(data);
+  // The copies do not inherit the timer, they each start their own.
+  KillAfter(0);
+  std::vector<bool> results;
+  size_t copy = Branch(reducer->count_, &results);
+  if (copy == reducer->count_) {
+    reducer->WriteResults(results);
+    _exit(0);
+  }
+  reducer->branched_ = true;
+  if (!reducer->StartCandidate(copy)) _exit(1);
+  // Only the choices from here on differ from the first candidate's.
+  DeltaMonitor::GetSequence()->init_sequence();
+  KillAfter(reducer->timeout_);
+}
+
+void SequenceReducer::WriteResults(const std::vector<bool>& results) const {
+  std::ofstream file(GetResultsFile().c_str());
+  for (bool result : results) file << (result ? '1' : '0');
+  file << std::endl;
+}
+
+bool SequenceReducer::IsSmaller(const ChoiceSequence& sequence,
+    const ChoiceSequence& other) {
+  if (sequence.size() != other.size()) return sequence.size() < other.size();
+  long sum = 0, other_sum = 0;
+  for (size_t idx = 0; idx < sequence.size(); ++idx) {
+    sum += sequence[idx].first;
+    other_sum += other[idx].first;
+  }
+  return sum < other_sum;
+}
+
+std::string SequenceReducer::GetCandidateFile(size_t slot,
+    const char *suffix) const {
+  std::stringstream name;
+  name << output_ << ".reduce" << slot << suffix;
+  return name.str();
+}
+
+std::string SequenceReducer::GetResultsFile() const {
+  return output_ + ".reduce.results";
+}
+
+}  // namespace CLSmith
@@ -0,0 +1,101 @@
+// Reduces the sequence of random choices a program was generated from, rather
+// than the program itself, so the result is always a program the generator
+// could have produced.
+//
+// The sequence is read from the file given by --reduce_sequence, in the
+// SimpleDeltaSequence format written by --record_sequence (one "value,bound"
+// line per choice). Candidates are replayed leniently (see
+// DeltaMonitor::is_lenient()), so that deleting or changing a choice shifts the
+// ones after it rather than making the replay fail. The reduction is
+// ddmin-style: chunks of choices are deleted, from half the sequence down to
+// single choices, then every choice is set to 0 (usually the simplest option)
+// and otherwise halved. Passes repeat until none makes progress.
+//
+// Every batch of candidates is generated in a child process, forked before
+// anything is generated in the parent, so no state has to be reset between
+// candidates. The candidates of a batch usually only differ late in the
+// sequence, so the child generates the choices they share once, then
+// checkpoints the generator by forking a copy for each candidate (see
+// Branch()). Each copy writes the program and the sequence it actually used,
+// then runs the --reduce command on the program. A candidate is only kept if
+// that sequence is smaller than the current one (shorter, or as long with a
+// smaller sum), which makes sure the reduction ends. Edited sequences can make
+// the generator loop forever, so candidates are killed once they take much
+// longer to generate than the original.
+
+#ifndef _CLSMITH_SEQUENCEREDUCER_H_
+#define _CLSMITH_SEQUENCEREDUCER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "CLSmith/ChoiceSequence.h"
+#include "CommonMacros.h"
+
+namespace CLSmith {
+
+class SequenceReducer {
+ public:
+  // generate creates the program with the current options, returning the exit
+  // code of the generator.
+  explicit SequenceReducer(const std::function<int()>& generate);
+  ~SequenceReducer() {}
+
+  // Writes the program generated from the reduced sequence to the output file,
+  // and the sequence itself to the --record_sequence file, or to the output
+  // file with ".seq" appended. Returns false if the sequence cannot be read or
+  // is not interesting to begin with.
+  bool Reduce();
+
+ private:
+  // Tries the candidates in batches of --reduce_jobs, keeping the first
+  // interesting one in each batch.
+  bool RunPass(
+      const std::function<bool(size_t, ChoiceSequence *)>& make_candidate);
+
+  // Tests the candidates in parallel. The sequence and program generated by
+  // each interesting one replace the given candidate and program.
+  std::vector<bool> Test(std::vector<ChoiceSequence> *candidates,
+      std::vector<std::string> *programs);
+  // Generates the programs for the first count candidates, then runs the
+  // interestingness command on them, writing the results to the results file.
+  // The first candidate is generated up to the prefix (the first position
+  // where any of the candidates differs), where the generator is checkpointed
+  // and continues with each candidate in a copy of the process. Only called in
+  // a child process, returns whether the candidate it ends with is interesting.
+  bool RunCandidates(size_t count, size_t prefix);
+  // Replays the candidate in the slot from now on, and outputs to its files.
+  bool StartCandidate(size_t slot);
+  // The checkpoint callback, data is the reducer.
+  static void OnCheckpoint(void *data);
+  void WriteResults(const std::vector<bool>& results) const;
+
+  static bool IsSmaller(const ChoiceSequence& sequence,
+      const ChoiceSequence& other);
+
+  // Names of the files used by the candidate in the slot.
+  std::string GetCandidateFile(size_t slot, const char *suffix) const;
+  std::string GetResultsFile() const;
+
+  std::function<int()> generate_;
+  std::string command_;
+  std::string output_;
+  ChoiceSequence current_;
+  std::string program_;
+  size_t jobs_;
+  // Milliseconds a candidate may take to generate, 0 for no limit.
+  long timeout_;
+  size_t tests_run_;
+  // State of the child generating candidates: how many there are, whether it
+  // has been checkpointed, and the program file of the current candidate.
+  size_t count_;
+  bool branched_;
+  std::string program_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(SequenceReducer);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_SEQUENCEREDUCER_H_
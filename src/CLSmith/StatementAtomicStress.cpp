@@ -0,0 +1,171 @@
+#include "CLSmith/StatementAtomicStress.h"
+
+#include <ostream>
+#include <vector>
+
+#include "Block.h"
+#include "CGContext.h"
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CLProgramGenerator.h"
+#include "CLSmith/Globals.h"
+#include "CLSmith/MemoryBuffer.h"
+#include "CLSmith/StatementBarrier.h"
+#include "Constant.h"
+#include "CVQualifiers.h"
+#include "Expression.h"
+#include "random.h"
+#include "Type.h"
+#include "util.h"
+
+namespace CLSmith {
+namespace {
+// Number of uints in a 64 byte cache line, the distance between two strided
+// counters.
+const unsigned kStride = 16;
+// Number of strided counters, also the number of local counters used by the
+// hierarchical reductions.
+const unsigned kStripes = 8;
+// Maximum number of times a work-item repeats the atomic operation.
+const int kMaxIterations = 32;
+
+// Global buffer holding the counters of every group, passed to the kernel.
+MemoryBuffer *global_stress = NULL;
+// Local buffer holding the per-group partial sums of hierarchical reductions.
+MemoryBuffer *local_stress = NULL;
+}  // namespace
+
+StatementAtomicStress *StatementAtomicStress::make_random(
+    CGContext& cg_context) {
+  // The hierarchical pattern contains barriers, which cannot be placed in code
+  // that may be divergent.
+  bool allow_barrier = !CLOptions::divergence();
+  StressPattern pattern = (StressPattern)rnd_upto(
+      allow_barrier ? kHierarchical + 1 : kHierarchical);
+  int iterations = rnd_upto(kMaxIterations) + 1;
+  Expression *expr = Expression::make_random(
+      cg_context, &Type::get_simple_type(eUInt));
+  return new StatementAtomicStress(cg_context.get_current_block(), expr,
+      pattern, iterations);
+}
+
+void StatementAtomicStress::InitBuffers() {
+  CVQualifiers qfer(std::vector<bool>({false}), std::vector<bool>({true}));
+  global_stress = new MemoryBuffer(MemoryBuffer::kGlobal, "g_atomic_stress",
+      &Type::get_simple_type(eUInt), Constant::make_int(0), &qfer,
+      {CLProgramGenerator::get_groups() * GetRegionSize()});
+  local_stress = new MemoryBuffer(MemoryBuffer::kLocal, "l_atomic_stress",
+      &Type::get_simple_type(eUInt), Constant::make_int(0), &qfer,
+      {kStripes});
+}
+
+unsigned StatementAtomicStress::GetRegionSize() {
+  return (kStripes + 2) * kStride;
+}
+
+void StatementAtomicStress::AddVarsToGlobals(Globals *globals) {
+  assert(global_stress != NULL && local_stress != NULL);
+  globals->AddLocalMemoryBuffer(local_stress);
+  globals->AddGlobalMemoryBuffer(global_stress);
+}
+
+void StatementAtomicStress::OutputHashing(std::ostream& out) {
+  assert(global_stress != NULL && local_stress != NULL);
+  output_tab(out, 1);
+  out << "if (!get_linear_local_id())" << std::endl;
+  output_tab(out, 1);
+  out << "{" << std::endl;
+  output_tab(out, 2);
+  out << "for (i = 0; i < " << GetRegionSize() << "; i += " << kStride << ")"
+      << std::endl;
+  output_tab(out, 3);
+  out << "transparent_crc(";
+  global_stress->Output(out);
+  out << "[get_linear_group_id() * " << GetRegionSize() << " + i], \"";
+  global_stress->Output(out);
+  out << "[get_linear_group_id() * " << GetRegionSize() << " + i]\", "
+      << "print_hash_value);" << std::endl;
+  output_tab(out, 2);
+  out << "for (i = 0; i < " << kStripes << "; i++)" << std::endl;
+  output_tab(out, 3);
+  out << "transparent_crc(";
+  local_stress->Output(out);
+  out << "[i], \"";
+  local_stress->Output(out);
+  out << "[i]\", print_hash_value);" << std::endl;
+  output_tab(out, 1);
+  out << "}" << std::endl;
+}
+
+unsigned StatementAtomicStress::GetAtomicCount() const {
+  // The first work item of the group also pushes the partial sums.
+  return iterations_ + (pattern_ == kHierarchical ? kStripes : 0);
+}
+
+void StatementAtomicStress::OutputGlobalIndex(std::ostream& out) const {
+  out << "get_linear_group_id() * " << GetRegionSize();
+  switch (pattern_) {
+    case kSingleCounter: break;
+    case kStrided:
+      out << " + (1 + get_linear_local_id() % " << kStripes << ") * "
+          << kStride;
+      break;
+    case kHierarchical:
+      out << " + " << (kStripes + 1) * kStride;
+      break;
+    default: assert(false);
+  }
+}
+
+void StatementAtomicStress::Output(std::ostream& out, FactMgr */*fm*/,
+    int indent) const {
+  // The value is computed once, as the expression may have side effects that
+  // csmith expects to happen exactly once.
+  output_tab(out, indent);
+  out << "{" << std::endl;
+  output_tab(out, indent + 1);
+  out << "uint stress_val = ";
+  expr_->Output(out);
+  out << ";" << std::endl;
+  output_tab(out, indent + 1);
+  out << "for (int stress_i = 0; stress_i < " << iterations_
+      << "; stress_i++)" << std::endl;
+  output_tab(out, indent + 2);
+  out << "atomic_add(&";
+  if (pattern_ == kHierarchical) {
+    local_stress->Output(out);
+    out << "[get_linear_local_id() % " << kStripes << "]";
+  } else {
+    global_stress->Output(out);
+    out << "[";
+    OutputGlobalIndex(out);
+    out << "]";
+  }
+  out << ", stress_val);" << std::endl;
+
+  if (pattern_ == kHierarchical) {
+    // Once every work-item has contributed to the local counters, a single
+    // work-item pushes the partial sums to global memory.
+    output_tab(out, indent + 1);
+    out << "barrier(CLK_LOCAL_MEM_FENCE);" << std::endl;
+    output_tab(out, indent + 1);
+    out << "if (get_linear_local_id() == 0)" << std::endl;
+    output_tab(out, indent + 2);
+    out << "for (int stress_i = 0; stress_i < " << kStripes
+        << "; stress_i++)" << std::endl;
+    output_tab(out, indent + 3);
+    out << "atomic_add(&";
+    global_stress->Output(out);
+    out << "[";
+    OutputGlobalIndex(out);
+    out << "], ";
+    local_stress->Output(out);
+    out << "[stress_i]);" << std::endl;
+    output_tab(out, indent + 1);
+    StatementBarrier::OutputBarrier(out);
+    out << std::endl;
+  }
+  output_tab(out, indent);
+  out << "}" << std::endl;
+}
+
+}  // namespace CLSmith
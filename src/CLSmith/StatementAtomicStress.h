@@ -0,0 +1,94 @@
+// Atomic stress statement, used to produce high-contention atomic patterns so
+// that generated kernels can double as scalability benchmarks for atomic
+// implementations.
+// Every work-group owns a region of the g_atomic_stress buffer, split into
+// cache line sized chunks:
+//   line 0             - a single counter hit by every work-item in the group;
+//   lines 1..kStripes  - counters strided one cache line apart;
+//   line kStripes + 1  - the target of local-then-global hierarchical
+//                        reductions through l_atomic_stress.
+// The values of the atomic operations are never read back during execution,
+// only the final sums are hashed at the end of the kernel, so the result stays
+// deterministic regardless of the order the work-items arrive in.
+
+#ifndef _CLSMITH_STATEMENTATOMICSTRESS_H_
+#define _CLSMITH_STATEMENTATOMICSTRESS_H_
+
+#include <ostream>
+#include <vector>
+
+#include "CLSmith/CLStatement.h"
+#include "CommonMacros.h"
+
+class Block;
+class CGContext;
+namespace CLSmith { class Globals; }
+namespace CLSmith { class MemoryBuffer; }
+class Expression;
+class FactMgr;
+
+namespace CLSmith {
+
+class StatementAtomicStress : public CLStatement {
+ public:
+  // The contention pattern produced by the statement.
+  enum StressPattern {
+    kSingleCounter = 0,
+    kStrided,
+    kHierarchical
+  };
+
+  StatementAtomicStress(Block *blk, Expression *expr, StressPattern pattern,
+      int iterations)
+      : CLStatement(kAtomicStress, blk), expr_(expr), pattern_(pattern),
+      iterations_(iterations) {
+  }
+  StatementAtomicStress(StatementAtomicStress&& other) = default;
+  StatementAtomicStress& operator=(StatementAtomicStress&& other) = default;
+  virtual ~StatementAtomicStress() {}
+
+  // Creates a random stress pattern. The hierarchical pattern requires
+  // barriers, so it will only be chosen when the control flow is known to be
+  // uniform.
+  static StatementAtomicStress *make_random(CGContext& cg_context);
+
+  // Creates the global and local buffers used by the stress statements.
+  static void InitBuffers();
+
+  // Number of uints in the region of g_atomic_stress owned by each group.
+  // Passed to the launcher so it can allocate the buffer.
+  static unsigned GetRegionSize();
+
+  // Adds the stress buffers to the global struct.
+  static void AddVarsToGlobals(Globals *globals);
+
+  // Hash the final counter values of the group. Must be called at the end of
+  // the kernel, as the counters are only stable after the final barrier.
+  static void OutputHashing(std::ostream& out);
+
+  // Pure virtual in Statement.
+  void get_blocks(std::vector<const Block *>& /*blks*/) const {}
+  void get_exprs(std::vector<const Expression *>& exps) const {
+    exps.push_back(expr_);
+  }
+
+  // Number of atomic operations performed by each work item.
+  unsigned GetAtomicCount() const;
+
+  // Outputs the value computation followed by the atomic loop.
+  void Output(std::ostream& out, FactMgr *fm, int indent) const;
+
+ private:
+  // Outputs the index into g_atomic_stress targeted by this statement.
+  void OutputGlobalIndex(std::ostream& out) const;
+
+  Expression *expr_;
+  StressPattern pattern_;
+  int iterations_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatementAtomicStress);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_STATEMENTATOMICSTRESS_H_
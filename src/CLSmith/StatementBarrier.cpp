@@ -5,6 +5,8 @@
 #include <utility>
 #include <vector>
 
+#include "CLSmith/CLOptions.h"
+#include "CLSmith/CLProgramGenerator.h"
 #include "CLSmith/Divergence.h"
 #include "CLSmith/Globals.h"
 #include "CLSmith/MemoryBuffer.h"
@@ -12,12 +14,18 @@
 #include "Constant.h"
 #include "CVQualifiers.h"
 #include "Function.h"
+#include "random.h"
 #include "Type.h"
 #include "util.h"
 #include "Variable.h"
 #include "VariableSelector.h"
 
 namespace CLSmith {
+namespace {
+// Local buffer holding a value for every work item in the group, shared by all
+// the producer/consumer regions.
+MemoryBuffer *exchange_buffer = NULL;
+}  // namespace
 
 StatementBarrier *StatementBarrier::make_random(Block *block) {
   CVQualifiers gate_qfer(std::vector<bool>({false}), std::vector<bool>({false}));
@@ -25,13 +33,75 @@ StatementBarrier *StatementBarrier::make_random(Block *block) {
       &Type::get_simple_type(eInt), Constant::make_int(0), &gate_qfer);
   MemoryBuffer *buffer = MemoryBuffer::CreateMemoryBuffer(MemoryBuffer::kLocal,
       gensym("lb_"), &Type::get_simple_type(eUInt), Constant::make_int(1), {32});
-  return new StatementBarrier(block, gate, buffer);
+  return new StatementBarrier(block, gate, buffer, ChooseFence());
+}
+
+StatementBarrier *StatementBarrier::make_producer_consumer(Block *block) {
+  StatementBarrier *barrier = new StatementBarrier(block, ChooseFence());
+  barrier->exchange_ = GetExchangeBuffer();
+  return barrier;
+}
+
+StatementBarrier::Fence StatementBarrier::ChooseFence() {
+  const std::string fence = CLOptions::barrier_fence();
+  if (fence == "local") return kLocalFence;
+  if (fence == "global") return kGlobalFence;
+  if (fence == "random") return (Fence)rnd_upto(kBothFences + 1);
+  return kBothFences;
+}
+
+MemoryBuffer *StatementBarrier::GetExchangeBuffer() {
+  if (exchange_buffer == NULL)
+    exchange_buffer = MemoryBuffer::CreateMemoryBuffer(MemoryBuffer::kLocal,
+        "l_barrier_exchange", &Type::get_simple_type(eUInt),
+        Constant::make_int(1), {CLProgramGenerator::get_threads_per_group()});
+  return exchange_buffer;
+}
+
+void StatementBarrier::HashExchangeBuffer(std::ostream& out) {
+  if (exchange_buffer != NULL) exchange_buffer->hash(out);
+}
+
+void StatementBarrier::OutputBarrier(std::ostream& out, Fence fence) {
+  out << "barrier(";
+  switch (fence) {
+    case kLocalFence: out << "CLK_LOCAL_MEM_FENCE"; break;
+    case kGlobalFence: out << "CLK_GLOBAL_MEM_FENCE"; break;
+    case kBothFences: out << "CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE"; break;
+    default: assert(false);
+  }
+  out << ");";
 }
 
 void StatementBarrier::Output(std::ostream& out, FactMgr */*fm*/, int indent) const {
+  if (exchange_ != NULL) {
+    // Consume the value of the neighbour, then produce our own.
+    output_tab(out, indent);
+    out << "{" << std::endl;
+    output_tab(out, indent + 1);
+    exchange_->type->Output(out);
+    out << " exchange_val = ";
+    exchange_->Output(out);
+    out << "[(get_linear_local_id() + 1) % "
+        << CLProgramGenerator::get_threads_per_group() << "];" << std::endl;
+    output_tab(out, indent + 1);
+    OutputBarrier(out, GetLocalFence());
+    out << std::endl;
+    output_tab(out, indent + 1);
+    exchange_->OutputWithOwnedItem(out);
+    out << " = ";
+    exchange_->OutputWithOwnedItem(out);
+    out << " * 31 + exchange_val;" << std::endl;
+    output_tab(out, indent + 1);
+    OutputBarrier(out, GetLocalFence());
+    out << std::endl;
+    output_tab(out, indent);
+    out << "}" << std::endl;
+    return;
+  }
   if (gate_ == NULL) {
     output_tab(out, indent);
-    OutputBarrier(out);
+    OutputBarrier(out, fence_);
     out << std::endl;
     return;
   }
@@ -51,7 +121,7 @@ void StatementBarrier::Output(std::ostream& out, FactMgr */*fm*/, int indent) co
   out << "temp *= get_local_id(0);" << std::endl;
   // Block all threads with a barrier.
   output_tab(out, indent + 1);
-  OutputBarrier(out);
+  OutputBarrier(out, GetLocalFence());
   out << std::endl;
   // Store result in paired thread's item.
   output_tab(out, indent + 1);
@@ -59,7 +129,7 @@ void StatementBarrier::Output(std::ostream& out, FactMgr */*fm*/, int indent) co
   out << "[get_local_id(0) ^ 1] = temp;" << std::endl;
   // Block all threads with a barrier.
   output_tab(out, indent + 1);
-  OutputBarrier(out);
+  OutputBarrier(out, GetLocalFence());
   out << std::endl;
   // Close the gate and exit.
   output_tab(out, indent + 1);
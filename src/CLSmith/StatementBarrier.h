@@ -30,11 +30,25 @@ namespace CLSmith {
 // where appropriate.
 class StatementBarrier : public CLStatement {
  public:
+  // The memory fences a barrier is given.
+  enum Fence {
+    kLocalFence = 0,
+    kGlobalFence,
+    kBothFences
+  };
+
   StatementBarrier(Block *block)
-      : CLStatement(kBarrier, block), gate_(NULL), buffer_() {
+      : CLStatement(kBarrier, block), gate_(NULL), buffer_(),
+      exchange_(NULL), fence_(kBothFences) {
+  }
+  StatementBarrier(Block *block, Fence fence)
+      : CLStatement(kBarrier, block), gate_(NULL), buffer_(),
+      exchange_(NULL), fence_(fence) {
   }
-  StatementBarrier(Block *block, Variable *gate, MemoryBuffer *buffer)
-      : CLStatement(kBarrier, block), gate_(gate), buffer_(buffer) {
+  StatementBarrier(Block *block, Variable *gate, MemoryBuffer *buffer,
+      Fence fence)
+      : CLStatement(kBarrier, block), gate_(gate), buffer_(buffer),
+      exchange_(NULL), fence_(fence) {
   }
   StatementBarrier(StatementBarrier&& other) = default;
   StatementBarrier& operator=(StatementBarrier&& other) = default;
@@ -44,6 +58,24 @@ class StatementBarrier : public CLStatement {
   // any specific context, so no CGContext object is needed.
   static StatementBarrier *make_random(Block *block);
 
+  // Creates a producer/consumer region around two barriers. Each work item
+  // reads the value produced by its neighbour in the exchange buffer, then
+  // replaces its own value. The barriers keep the reads and writes apart, so
+  // the result does not depend on the order of the work items.
+  // Must only be placed where every work item in the group reaches it.
+  static StatementBarrier *make_producer_consumer(Block *block);
+
+  // Picks the fences for a barrier, based on --barrier_fence.
+  static Fence ChooseFence();
+
+  // The local buffer shared by all the producer/consumer regions. Created on
+  // first use, must be added to the globals by whoever places the regions.
+  static MemoryBuffer *GetExchangeBuffer();
+
+  // Hashes the item of the exchange buffer owned by the work item, if any
+  // producer/consumer regions were created.
+  static void HashExchangeBuffer(std::ostream& out);
+
   // Pure virtual in Statement. Not really needed.
   void get_blocks(std::vector<const Block *>& blks) const {}
   void get_exprs(std::vector<const Expression *>& exps) const {}
@@ -54,15 +86,28 @@ class StatementBarrier : public CLStatement {
 
   // Outputs a simple barrier that blocks every thread (local and global).
   static void OutputBarrier(std::ostream& out) {
-    out << "barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);";
+    OutputBarrier(out, kBothFences);
   }
+  // Outputs a barrier with the given fences.
+  static void OutputBarrier(std::ostream& out, Fence fence);
+
+  // Number of barriers hit by each work item that runs the statement.
+  int GetBarrierCount() const { return gate_ == NULL && !exchange_ ? 1 : 2; }
 
   Variable *GetGate() { return gate_; }
   MemoryBuffer *GetBuffer() { return buffer_.get(); }
 
  private:
+  // The barriers that protect a local buffer must always fence local memory.
+  Fence GetLocalFence() const {
+    return fence_ == kGlobalFence ? kBothFences : fence_;
+  }
+
   Variable *gate_;
   std::unique_ptr<MemoryBuffer> buffer_;
+  // Shared exchange buffer of a producer/consumer region, not owned.
+  MemoryBuffer *exchange_;
+  Fence fence_;
 
   DISALLOW_COPY_AND_ASSIGN(StatementBarrier);
 };
@@ -400,7 +400,6 @@ std::vector<StatementMessage *>::iterator Message::GetsbIterator(Node node) {
 StatementMessage *StatementMessage::make_random(CGContext& cg_context) {
   Message *message = MessagePassing::RandomMessage();
   unsigned int tid_max = CLProgramGenerator::get_threads_per_group();
-  std::cout << tid_max << std::endl; // TODO deleteme
   // Limit threads to at most 5.
   if (tid_max > 5) tid_max = 5;
   StatementMessage *st_msg = new StatementMessage(
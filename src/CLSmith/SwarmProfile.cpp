@@ -0,0 +1,210 @@
+#include "CLSmith/SwarmProfile.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CLSmith/CLOptions.h"
+
+namespace CLSmith {
+namespace {
+// splitmix64, so the options drawn for a seed are the same on every platform,
+// and do not move the random sequence of the generator.
+class SwarmRandom {
+ public:
+  explicit SwarmRandom(unsigned long seed)
+      : state_(seed ^ 0x5357524d50524f46ULL) {}
+
+  // Uniform in [0, 1).
+  double Next() {
+    unsigned long long z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+ private:
+  unsigned long long state_;
+};
+
+// Whether the options set conflict, without the explanation
+// CLOptions::Conflict() writes out.
+bool QuietConflict() {
+  std::streambuf *buffer = std::cout.rdbuf(NULL);
+  bool conflict = CLOptions::Conflict();
+  std::cout.rdbuf(buffer);
+  std::cout.clear();
+  return conflict;
+}
+}  // namespace
+
+std::string SwarmProfile::feature_vector_;
+
+SwarmProfile::SwarmProfile(const std::string& filename,
+    const std::function<bool(const std::vector<const char *>&)>& apply)
+    : filename_(filename), apply_(apply) {
+}
+
+bool SwarmProfile::Load() {
+  std::ifstream in(filename_.c_str());
+  if (!in) {
+    std::cout << "Cannot read the swarm profile " << filename_ << "."
+              << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!ParseLine(line)) {
+      std::cout << "Invalid line in the swarm profile: " << line << std::endl;
+      return false;
+    }
+  }
+
+  // Every option must at least be valid on its own.
+  for (const Option& option : options_) {
+    std::vector<const char *> args(1, option.flag.c_str());
+    bool valid = option.values.empty() ? apply_(args) : true;
+    for (const std::string& value : option.values) {
+      args.resize(1);
+      args.push_back(value.c_str());
+      valid &= apply_(args);
+    }
+    if (!valid) {
+      std::cout << "Invalid option in the swarm profile: " << option.flag
+                << std::endl;
+      return false;
+    }
+  }
+
+  std::vector<size_t> switches;
+  for (size_t idx = 0; idx < options_.size(); ++idx)
+    if (options_[idx].values.empty()) switches.push_back(idx);
+  for (size_t idx : switches)
+    options_[idx].possible = !Conflicts(std::vector<size_t>(1, idx));
+  // A switch that is invalid alone may be valid with another one.
+  for (size_t idx : switches) {
+    Option& option = options_[idx];
+    for (size_t other : switches) {
+      if (option.possible) break;
+      const Option& required = options_[other];
+      if (other == idx || !required.possible || required.required != other)
+        continue;
+      option.required = other;
+      option.possible = !Conflicts(std::vector<size_t>(1, idx));
+      if (!option.possible) option.required = idx;
+    }
+    if (!option.possible) {
+      std::cout << "The swarm option " << option.flag << " cannot be given "
+                   "with the other options, it is never chosen." << std::endl;
+    }
+  }
+  for (size_t idx : switches) {
+    for (size_t other : switches) {
+      if (other >= idx) break;
+      if (!options_[idx].possible || !options_[other].possible) continue;
+      std::vector<size_t> pair;
+      pair.push_back(other);
+      pair.push_back(idx);
+      bool conflicts = Conflicts(pair);
+      options_[idx].conflicts[other] = conflicts;
+      options_[other].conflicts[idx] = conflicts;
+    }
+  }
+
+  order_.clear();
+  for (size_t idx = 0; idx < options_.size(); ++idx)
+    if (options_[idx].required == idx) order_.push_back(idx);
+  for (size_t idx = 0; idx < options_.size(); ++idx)
+    if (options_[idx].required != idx) order_.push_back(idx);
+  return true;
+}
+
+bool SwarmProfile::Choose(unsigned long seed) {
+  // Every option takes a draw, in the order of the profile, whether it can be
+  // chosen or not, so the draws of the others do not depend on it.
+  SwarmRandom random(seed);
+  double program_probability = random.Next();
+  std::vector<double> draws;
+  for (size_t idx = 0; idx < options_.size(); ++idx)
+    draws.push_back(random.Next());
+
+  std::vector<bool> chosen(options_.size(), false);
+  for (size_t idx : order_) {
+    const Option& option = options_[idx];
+    if (!option.values.empty()) continue;
+    double probability = option.probability < 0 ? program_probability :
+        option.probability;
+    if (!option.possible || draws[idx] >= probability) continue;
+    if (option.required != idx && !chosen[option.required]) continue;
+    bool conflicts = false;
+    for (size_t other = 0; other < options_.size(); ++other)
+      conflicts |= chosen[other] && option.conflicts[other];
+    chosen[idx] = !conflicts;
+  }
+
+  std::vector<const char *> args;
+  std::ostringstream features;
+  for (size_t idx = 0; idx < options_.size(); ++idx) {
+    const Option& option = options_[idx];
+    features << (idx ? " " : "") << option.flag.substr(2) << "=";
+    if (option.values.empty()) {
+      features << chosen[idx];
+      if (chosen[idx]) args.push_back(option.flag.c_str());
+    } else {
+      const std::string& value = option.values[
+          static_cast<size_t>(draws[idx] * option.values.size())];
+      features << value;
+      args.push_back(option.flag.c_str());
+      args.push_back(value.c_str());
+    }
+  }
+  feature_vector_ = features.str();
+  return apply_(args);
+}
+
+bool SwarmProfile::ParseLine(const std::string& line) {
+  std::istringstream fields(line);
+  Option option;
+  if (!(fields >> option.flag) || option.flag[0] == '#') return true;
+  if (option.flag.compare(0, 2, "--") || option.flag.size() == 2)
+    return false;
+  std::string field;
+  if (!(fields >> field)) return false;
+  option.probability = -1;
+  if (field == "=") {
+    while (fields >> field) option.values.push_back(field);
+    if (option.values.empty()) return false;
+  } else if (field != "*") {
+    char *end;
+    option.probability = std::strtod(field.c_str(), &end);
+    if (*end || option.probability < 0 || option.probability > 1)
+      return false;
+    if (fields >> field) return false;
+  }
+  option.required = options_.size();
+  option.possible = option.values.empty();
+  options_.push_back(option);
+  for (Option& other : options_) other.conflicts.resize(options_.size());
+  return true;
+}
+
+bool SwarmProfile::Conflicts(const std::vector<size_t>& switches) {
+  std::vector<const char *> args;
+  for (size_t idx : switches) AddSwitch(idx, &args);
+  return !apply_(args) || QuietConflict();
+}
+
+void SwarmProfile::AddSwitch(size_t idx,
+    std::vector<const char *> *args) const {
+  const Option& option = options_[idx];
+  if (option.required != idx)
+    args->push_back(options_[option.required].flag.c_str());
+  args->push_back(option.flag.c_str());
+}
+
+}  // namespace CLSmith
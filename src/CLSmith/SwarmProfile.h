@@ -0,0 +1,94 @@
+// Swarm testing: chooses the options of each program at random, on top of the
+// options given, as the random_test script does with csmith, so that a
+// campaign covers many combinations of features.
+//
+// The --swarm profile gives the options that may be chosen, one per line, as
+// they are given on the command line:
+//   --atomics 0.3              given with probability 0.3;
+//   --no-pointers *            given with a probability drawn for each program,
+//                              which is what swarm testing does;
+//   --barrier_density = 5 20   given with one of the values, each as likely.
+// Lines starting with # are comments.
+//
+// The options are drawn from the seed of the program, with a generator of
+// their own, so the same seed gives the same options and the same program.
+// Options that cannot be given together (see CLOptions::Conflict()) are found
+// when the profile is loaded: every switch is tried alone and with every other
+// one. A switch that is only valid with another one, such as
+// --barrier_producer_consumer with --barriers, is only chosen along with it,
+// and of two switches that conflict, the first one in the profile wins.
+// Loading is done once for a campaign, the programs then only draw their
+// options.
+//
+// The options chosen are written in the header of the program, as
+//   // Swarm: atomics=1 no-pointers=0 barrier_density=20
+// with every option of the profile, so results can be grouped by feature.
+
+#ifndef _CLSMITH_SWARMPROFILE_H_
+#define _CLSMITH_SWARMPROFILE_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "CommonMacros.h"
+
+namespace CLSmith {
+
+class SwarmProfile {
+ public:
+  // apply sets the options given on the command line, followed by the given
+  // arguments, and returns false if one of them is invalid.
+  SwarmProfile(const std::string& filename,
+      const std::function<bool(const std::vector<const char *>&)>& apply);
+  ~SwarmProfile() {}
+
+  // Reads the profile, and finds which options conflict. Returns false if the
+  // profile cannot be read or has an invalid option.
+  bool Load();
+
+  // Chooses the options for the program generated from the seed, and sets
+  // them along with the options on the command line.
+  bool Choose(unsigned long seed);
+
+  // The options chosen, as written in the header of the program, or an empty
+  // string when no options were chosen.
+  static const std::string& GetFeatureVector() { return feature_vector_; }
+
+ private:
+  struct Option {
+    std::string flag;
+    // Probability of a switch, negative for the probability of the program.
+    double probability;
+    // Values of an option that has them, one of which is given.
+    std::vector<std::string> values;
+    // Switch it must be given with, or its own index if none.
+    size_t required;
+    // Whether it can be chosen at all.
+    bool possible;
+    // Switches it conflicts with.
+    std::vector<bool> conflicts;
+  };
+
+  bool ParseLine(const std::string& line);
+  // Whether the switches cannot be given together, with the ones they must be
+  // given with.
+  bool Conflicts(const std::vector<size_t>& switches);
+  // Adds the arguments for the switch, and for the one it must be given with.
+  void AddSwitch(size_t idx, std::vector<const char *> *args) const;
+
+  std::string filename_;
+  std::function<bool(const std::vector<const char *>&)> apply_;
+  std::vector<Option> options_;
+  // Indices of the options, with the switches other switches must be given
+  // with first.
+  std::vector<size_t> order_;
+
+  static std::string feature_vector_;
+
+  DISALLOW_COPY_AND_ASSIGN(SwarmProfile);
+};
+
+}  // namespace CLSmith
+
+#endif  // _CLSMITH_SWARMPROFILE_H_
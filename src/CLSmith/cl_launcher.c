@@ -72,6 +72,7 @@ bool disable_fake = false;
 bool disable_group = false;
 bool disable_atomics = false;
 bool output_binary = false;
+bool profile = false;
 bool set_device_from_name = false;
 
 // Kernel parameters.
@@ -81,6 +82,8 @@ bool atomic_reductions = false;
 bool emi = false;
 bool fake_divergence = false;
 bool inter_thread_comm = false;
+bool atomic_stress = false;
+int atomic_stress_region = 0;
 
 // Data to free.
 char *source_text = NULL;
@@ -95,6 +98,7 @@ char* local_dims = "";
 char* global_dims = "";
 int *sequence_input = NULL;
 cl_long *comm_vals = NULL;
+cl_uint *stress_vals = NULL;
 
 // Other parameters
 cl_platform_id *platform;
@@ -138,6 +142,8 @@ void print_help() {
   printf("                      ---emi                Test uses EMI\n");
   printf("                      ---fake_divergence    Test uses fake divergence\n");
   printf("                      ---inter_thread_comm  Test uses inter-thread communication\n");
+  printf("          --atomic_stress N                 Test uses atomic stress patterns, N counters per group\n");
+  printf("                      ---profile            Print the kernel execution time to stderr\n");
   printf("                      ---debug              Print debug info\n");
   printf("                      ---bin                Output disassembly of kernel in out.bin\n");
   printf("                      ---disable_opts       Disable OpenCL compile optimisations\n");
@@ -493,6 +499,9 @@ int main(int argc, char **argv) {
   if (inter_thread_comm) {
     free(comm_vals);
   }
+  if (atomic_stress) {
+    free(stress_vals);
+  }
 
 #ifdef XOPENME
   xopenme_dump_state();
@@ -545,7 +554,11 @@ int run_on_platform_device(cl_platform_id *platform, cl_device_id *device, cl_ui
   // CHANGE when cl 2.0 is released.
   //cl_command_queue com_queue =
   //    clCreateCommandQueueWithProperties(context, *device, NULL, &err);
-  cl_command_queue com_queue = clCreateCommandQueue(context, *device, 0, &err);
+  // Atomic stress tests are also used as benchmarks, so always time them.
+  cl_command_queue_properties queue_props =
+      (profile || atomic_stress) ? CL_QUEUE_PROFILING_ENABLE : 0;
+  cl_command_queue com_queue =
+      clCreateCommandQueue(context, *device, queue_props, &err);
   if (cl_error_check(err, "Error creating command queue"))
     return 1;
 
@@ -768,13 +781,27 @@ int run_on_platform_device(cl_platform_id *platform, cl_device_id *device, cl_ui
       return 1;
   }
 
+  if (atomic_stress) {
+    // Create the zeroed counters for the atomic stress patterns.
+    int total_counters = atomic_stress_region * no_groups;
+    stress_vals = (cl_uint*)calloc(total_counters, sizeof(cl_uint));
+    cl_mem stress_input = clCreateBuffer(
+        context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, total_counters * sizeof(cl_uint), stress_vals, &err);
+    if (cl_error_check(err, "Error creating atomic stress buffer"))
+      return 1;
+    err = clSetKernelArg(kernel, kernel_arg++, sizeof(cl_mem), &stress_input);
+    if (cl_error_check(err, "Error setting kernel argument for atomic stress"))
+      return 1;
+  }
+
 
   // Create command to launch the kernel.
 #ifdef _MSC_VER
   execution_in_progress = true;
 #endif
+  cl_event kernel_event;
   err = clEnqueueNDRangeKernel(
-      com_queue, kernel, work_dim, NULL, global_size, local_size, 0, NULL, NULL);
+      com_queue, kernel, work_dim, NULL, global_size, local_size, 0, NULL, &kernel_event);
   if (cl_error_check(err, "Error enqueueing kernel"))
     return 1;
 
@@ -782,6 +809,22 @@ int run_on_platform_device(cl_platform_id *platform, cl_device_id *device, cl_ui
   err = clFinish(com_queue);
   if (cl_error_check(err, "Error sending finish command"))
     return 1;
+
+  // Timing goes to stderr, so that the results on stdout can still be compared
+  // directly.
+  if (profile || atomic_stress) {
+    cl_ulong time_start, time_end;
+    err = clGetEventProfilingInfo(
+        kernel_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &time_start, NULL);
+    if (cl_error_check(err, "Error getting kernel start time"))
+      return 1;
+    err = clGetEventProfilingInfo(
+        kernel_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &time_end, NULL);
+    if (cl_error_check(err, "Error getting kernel end time"))
+      return 1;
+    fprintf(stderr, "Kernel time: %.3f ms\n", (time_end - time_start) / 1e6);
+  }
+  clReleaseEvent(kernel_event);
 #ifdef _MSC_VER
   execution_in_progress = false;
 #endif
@@ -820,8 +863,8 @@ int parse_file_args(const char* filename) {
     return 0;
   }
 
-  char arg_buf[128];
-  fgets(arg_buf, 128, source);
+  char arg_buf[256];
+  fgets(arg_buf, 256, source);
   char* new_line;
   if ((new_line = strchr(arg_buf, '\n')))
     arg_buf[(int) (new_line - arg_buf)] = '\0';
@@ -893,6 +936,15 @@ int parse_arg(char* arg, char* val) {
     atomic_counter_no = atoi(val);
     return 1;
   }
+  if (!strcmp(arg, "--atomic_stress")) {
+    atomic_stress = true;
+    atomic_stress_region = atoi(val);
+    return 1;
+  }
+  if (!strcmp(arg, "---profile")) {
+    profile = true;
+    return 1;
+  }
   if (!strcmp(arg, "---set_device_from_name")) {
     set_device_from_name = true;
     return 1;
@@ -36,6 +36,8 @@
 #include <cmath>
 #include <climits>
 #include <cctype>
+#include <map>
+#include <unordered_map>
 
 #include "CGContext.h"
 #include "Type.h"
@@ -55,6 +57,10 @@ static string GenerateRandomConstant(const Type* type);
  * TODO: make well-known constants
  */
 
+map<const Type*, unordered_map<string, Constant::Literal> > Constant::literals;
+
+map<int, const Constant::Literal*> Constant::int_literals;
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /*
@@ -63,7 +69,17 @@ static string GenerateRandomConstant(const Type* type);
 Constant::Constant(const Type *t, const string &v)
 	: Expression(eConstant),
 	  type(t),
-	  value(v)
+	  literal(intern(t, v))
+{
+}
+
+/*
+ * 
+ */
+Constant::Constant(const Type *t, const Literal *l)
+	: Expression(eConstant),
+	  type(t),
+	  literal(l)
 {
 }
 
@@ -73,7 +89,7 @@ Constant::Constant(const Type *t, const string &v)
 Constant::Constant(const Constant &c)
 	: Expression(eConstant),
 	  type(c.type),
-	  value(c.value)
+	  literal(c.literal)
 {
 }
 
@@ -93,6 +109,30 @@ Constant::clone() const
 	return new Constant(*this);
 }
 
+/*
+ * Return the interned literal for value `v' of type `t', formatting its
+ * output text the first time it is seen.  The literals are kept until
+ * doFinalization.
+ */
+const Constant::Literal *
+Constant::intern(const Type *t, const string &v)
+{
+	unordered_map<string, Literal> &values = literals[t];
+	unordered_map<string, Literal>::iterator iter = values.find(v);
+	if (iter != values.end())
+		return &iter->second;
+
+	Literal &l = values[v];
+	l.value = v;
+	//enclose negative numbers in parenthesis to avoid syntax errors such as "--8"
+	if (!v.empty() && v[0] == '-') {
+		l.text = "(" + v + ")";
+	} else if (t && t->eType == ePointer && StringUtils::str2int(v) == 0) {
+		l.text = CGOptions::lang_cpp() ? "NULL" : "(void*)" + v;
+	}
+	return &l;
+}
+
 // --------------------------------------------------------------
 static void
 PutRandomSignedConstantInRange(string *ch) {
@@ -370,47 +410,36 @@ Constant::make_random_nonzero(const Type* type)
 }
 
 /*
- * Return a `Constant' representing the integer value `v'.  Note that the
- * return value may not be "fresh."
+ * Return a `Constant' representing the integer value `v'.
  */
 Constant *
 Constant::make_int(int v)
 {
-	// Commented out code for the cache:
-	// It's hard for releasint the memory for those cached Constants. 
-#if 0
-	static const int cache_size = 256;
-	static bool cache_inited = false;
-	static Constant *cache_constants[cache_size];
-#endif
-
+	// The node itself is always fresh, as each one has its own cast and id and
+	// is deleted by the expression that owns it.  Only the literal is shared,
+	// and the ints are looked up before being formatted.
 	const Type &int_type = Type::get_simple_type(eInt);
 	ERROR_GUARD(NULL);
 
-#if 0
-	// Initialize our cache of small-number constants.
-	if (!cache_inited) {
-		cache_inited = true;
-
+	map<int, const Literal*>::iterator iter = int_literals.find(v);
+	if (iter == int_literals.end()) {
 		ostringstream oss;
-		for (int i = 0; i < cache_size; ++i) {
-			oss.str("");
-			oss << i;
-			cache_constants[i] = new Constant(&int_type, oss.str());
-		}
+		oss << v;
+		string s = CGOptions::mark_mutable_const() ? ("(" + oss.str() + ")") : oss.str();
+		iter = int_literals.insert(make_pair(v, intern(&int_type, s))).first;
 	}
+	return new Constant(&int_type, iter->second);
+}
 
-	// Get small numbers out of the cache.
-	if ((v >= 0) && (v < cache_size)) {
-		return cache_constants[v];
-	}
-#endif
-
-	// Create fresh constants for values outside of our cache limit.
-	ostringstream oss;
-	oss << v;
-	string s = CGOptions::mark_mutable_const() ? ("(" + oss.str() + ")") : oss.str();
-	return new Constant(&int_type, s);
+/*
+ * Release the interned literals.  The literals are keyed by type, so this
+ * must be done when the types go, and no constant may be left using them.
+ */
+void
+Constant::doFinalization(void)
+{
+	int_literals.clear();
+	literals.clear();
 }
 
 bool
@@ -433,26 +462,26 @@ Constant::compatible(const Expression *exp) const
 bool 
 Constant::less_than(int num) const
 {
-	return StringUtils::str2int(value) < num;
+	return StringUtils::str2int(literal->value) < num;
 }
 
 bool 
 Constant::not_equals(int num) const
 {
-	return StringUtils::str2int(value) != num;
+	return StringUtils::str2int(literal->value) != num;
 }
 
 bool 
 Constant::equals(int num) const
 {
-	return StringUtils::str2int(value) == num;
+	return StringUtils::str2int(literal->value) == num;
 }
 
 string
 Constant::get_field(size_t fid) const
 {
 	vector<string> fields;
-	StringUtils::split_string(value, fields, "{},");
+	StringUtils::split_string(literal->value, fields, "{},");
 	if (fid < fields.size()) {
 		return fields[fid];
 	}
@@ -477,18 +506,7 @@ void
 Constant::Output(std::ostream &out) const
 {
 	output_cast(out);
-	//enclose negative numbers in parenthesis to avoid syntax errors such as "--8"
-	if (!value.empty() && value[0] == '-') {
-		out << "(" << value << ")";
-	} else if (type->eType == ePointer && equals(0)){
-		if (CGOptions::lang_cpp()) {
-			out << "NULL";
-		} else {
-		out << "(void*)" << value;
-		}
-	} else {
-		out << value;
-	}
+	out << (literal->text.empty() ? literal->value : literal->text);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -32,8 +32,10 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <map>
 #include <ostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Expression.h"
@@ -59,6 +61,9 @@ public:
 
 	// Factory method.
 	static Constant *make_int(int v);
+
+	// Frees the interned literals, once no constant uses them any more.
+	static void doFinalization(void);
 	
 	Expression *clone() const;
 
@@ -74,7 +79,7 @@ public:
 
 	virtual const Type &get_type(void) const;
 	// Unused:
-	const std::string &get_value(void) const { return value; }
+	const std::string &get_value(void) const { return literal->value; }
 	
 	string get_field(size_t fid) const;
 
@@ -88,8 +93,26 @@ public:
 	virtual void Output(std::ostream &) const;
 
 private:	
+	// The text of a literal, interned so that every constant of the same type
+	// and value shares it rather than holding its own copy
+	struct Literal {
+		std::string value;
+		// the value as output, without the cast, if it is output differently
+		std::string text;
+	};
+
+	static const Literal *intern(const Type *t, const std::string &v);
+
+	// by type first, so that looking a value up does not copy it
+	static std::map<const Type*, std::unordered_map<std::string, Literal> > literals;
+
+	// the literals of make_int, so that they are looked up before being formatted
+	static std::map<int, const Literal*> int_literals;
+
+	Constant(const Type *t, const Literal *l);
+
 	const Type* type;
-	const std::string value;
+	const Literal *literal;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
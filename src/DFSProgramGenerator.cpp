@@ -37,6 +37,7 @@
 #include "DFSOutputMgr.h"
 #include "Finalization.h"
 #include "Error.h"
+#include "Constant.h"
 #include "Function.h"
 #include "VariableSelector.h"
 #include "util.h"
@@ -99,6 +100,7 @@ DFSProgramGenerator::goGenerator()
 		impl->reset_state();
 		Function::doFinalization();
 		VariableSelector::doFinalization();
+		Constant::doFinalization();
 		reset_gensym();
 		PartialExpander::restore_init_values();
 		//cout << "count = " << count << std::endl;
@@ -53,6 +53,16 @@ bool DeltaMonitor::is_delta_ = false;
 
 bool DeltaMonitor::no_delta_reduction_ = false;
 
+bool DeltaMonitor::is_lenient_ = false;
+
+bool DeltaMonitor::draws_missing_ = false;
+
+int DeltaMonitor::checkpoint_pos_ = -1;
+
+void (*DeltaMonitor::checkpoint_callback_)(void *) = NULL;
+
+void *DeltaMonitor::checkpoint_data_ = NULL;
+
 Sequence *DeltaMonitor::seq_ = NULL;
 
 DeltaMonitor::DeltaMonitor()
@@ -161,6 +171,25 @@ DeltaMonitor::init_for_running(std::string &msg, const std::string &monitor_type
 	return true;
 }
 
+void
+DeltaMonitor::set_checkpoint(int pos, void (*callback)(void *), void *data)
+{
+	DeltaMonitor::checkpoint_pos_ = pos;
+	DeltaMonitor::checkpoint_callback_ = callback;
+	DeltaMonitor::checkpoint_data_ = data;
+}
+
+void
+DeltaMonitor::reach_position(int pos)
+{
+	if (pos != DeltaMonitor::checkpoint_pos_ || !DeltaMonitor::checkpoint_callback_)
+		return;
+	// Cleared first, the callback may set another checkpoint.
+	void (*callback)(void *) = DeltaMonitor::checkpoint_callback_;
+	DeltaMonitor::checkpoint_callback_ = NULL;
+	callback(DeltaMonitor::checkpoint_data_);
+}
+
 void
 DeltaMonitor::OutputStatistics(ostream &out)
 {
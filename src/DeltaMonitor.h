@@ -56,6 +56,27 @@ public:
 
 	static bool no_delta_reduction() { return no_delta_reduction_; }
 
+	// When replaying a sequence that has been edited, out of bound values are
+	// wrapped and missing ones are 0, instead of failing.
+	static bool is_lenient() { return is_lenient_; }
+
+	static void set_lenient(bool lenient) { is_lenient_ = lenient; }
+
+	// Makes a lenient replay draw the missing values at random, from the seed,
+	// instead of using 0. A fixed value can keep a generator that retries on
+	// failure in a loop, which matters when most of the sequence is missing.
+	static bool draws_missing() { return draws_missing_; }
+
+	static void set_draws_missing(bool draws) { draws_missing_ = draws; }
+
+	// Calls the callback once a lenient replay reaches the position, before
+	// the choice at the position is made. A process forked there is a snapshot
+	// of the whole generator, from which the replay can go on with different
+	// choices from the position onwards.
+	static void set_checkpoint(int pos, void (*callback)(void *), void *data);
+
+	static void reach_position(int pos);
+
 	static bool init(std::string &msg, const std::string &monitor_type, const std::string &o_file);
 
 	static bool init_for_running(std::string &msg, const std::string &monitor_type, 
@@ -88,6 +109,16 @@ private:
 
 	static bool no_delta_reduction_;
 
+	static bool is_lenient_;
+
+	static bool draws_missing_;
+
+	static int checkpoint_pos_;
+
+	static void (*checkpoint_callback_)(void *);
+
+	static void *checkpoint_data_;
+
 	static Sequence *seq_;
 };
 
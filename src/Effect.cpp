@@ -27,6 +27,7 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cassert>
 
 #include "Effect.h"
@@ -48,21 +49,45 @@ const Effect Effect::empty_effect;
 ///////////////////////////////////////////////////////////////////////////////
 
 /*
- * Stuff that so badly wants to be rewritten using decent STL containers and
- * algorithms.
+ * Sets of variables are also kept as sorted ids.
  */
 static bool
-non_empty_intersection(const vector<const Variable *> &va,
-					   const vector<const Variable *> &vb)
+has_id(const vector<unsigned int> &ids, const Variable *v)
+{
+	return binary_search(ids.begin(), ids.end(), v->get_id());
+}
+
+static void
+insert_id(vector<unsigned int> &ids, const Variable *v)
+{
+	vector<unsigned int>::iterator i = lower_bound(ids.begin(), ids.end(), v->get_id());
+	if (i == ids.end() || *i != v->get_id()) {
+		ids.insert(i, v->get_id());
+	}
+}
+
+static void
+erase_id(vector<unsigned int> &ids, const Variable *v)
+{
+	vector<unsigned int>::iterator i = lower_bound(ids.begin(), ids.end(), v->get_id());
+	if (i != ids.end() && *i == v->get_id()) {
+		ids.erase(i);
+	}
+}
+
+/*
+ * Whether a variable of vb is, or is a field of, a variable of va. As
+ * Variable::match only matches a variable with itself and its fields, only the
+ * containers of every variable of vb have to be looked up.
+ */
+static bool
+contains_match(const vector<unsigned int> &va_ids,
+			   const vector<const Variable *> &vb)
 {
-	vector<const Variable *>::size_type va_len = va.size();
-	vector<const Variable *>::size_type vb_len = vb.size();
 	vector<const Variable *>::size_type i;
-	vector<const Variable *>::size_type j;
-	
-	for (i = 0; i < va_len; ++i) {
-		for (j = 0; j < vb_len; ++j) {
-			if (va[i]->match(vb[j]) || vb[j]->match(va[i])) {
+	for (i = 0; i < vb.size(); ++i) {
+		for (const Variable *v = vb[i]; v; v = v->field_var_of) {
+			if (has_id(va_ids, v) && v->match(vb[i])) {
 				return true;
 			}
 		}
@@ -70,6 +95,30 @@ non_empty_intersection(const vector<const Variable *> &va,
 	return false;
 }
 
+static bool
+non_empty_intersection(const vector<const Variable *> &va,
+					   const vector<unsigned int> &va_ids,
+					   const vector<const Variable *> &vb,
+					   const vector<unsigned int> &vb_ids)
+{
+	return contains_match(va_ids, vb) || contains_match(vb_ids, va);
+}
+
+/*
+ * with call chains, we want to track write/read to stack
+ * variables of caller(s)
+ */
+static bool
+is_on_call_chain(const Variable *var, const std::vector<const Block*> &call_chain)
+{
+	for (size_t j=0; j<call_chain.size(); j++) {
+		if (call_chain[j]->is_var_on_stack(var)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /*
@@ -90,6 +139,8 @@ Effect::Effect(void) :
 Effect::Effect(const Effect &e) :
 	read_vars(e.read_vars),
 	write_vars(e.write_vars),
+	read_ids(e.read_ids),
+	write_ids(e.write_ids),
 	pure(e.pure),
 	side_effect_free(e.side_effect_free)
 {
@@ -116,6 +167,8 @@ Effect::operator=(const Effect &e)
 
 	read_vars = e.read_vars;
 	write_vars = e.write_vars;
+	read_ids = e.read_ids;
+	write_ids = e.write_ids;
 	pure = e.pure;
 	side_effect_free = e.side_effect_free;
 
@@ -130,6 +183,7 @@ Effect::read_var(const Variable *v)
 {
 	if (!is_read(v)) {
 		read_vars.push_back(v);
+		insert_id(read_ids, v);
 	}
 	pure &= (v->is_const() && !v->is_volatile() && !v->is_access_once());
 	side_effect_free &= (!v->is_volatile() && !v->is_access_once());
@@ -155,6 +209,7 @@ Effect::write_var(const Variable *v)
 {
 	if (!is_written(v)) {
 		write_vars.push_back(v);
+		insert_id(write_ids, v);
 	}
 	// pure = pure;
 	// TODO: not quite correct below ---
@@ -181,8 +236,8 @@ Effect::add_effect(const Effect &e, bool include_lhs_effects)
 		return;
 	}
 
-	// Stuff that so badly wants to be rewritten using decent STL containers
-	// and algorithms... compute the union effect.
+	// compute the union effect, the variables already in this effect are
+	// looked up by id
 
 	vector<const Variable *>::size_type len;
 	vector<const Variable *>::size_type i;
@@ -192,6 +247,7 @@ Effect::add_effect(const Effect &e, bool include_lhs_effects)
 		// this->read_var(e.read_vars[i]);
 		if (!is_read(e.read_vars[i])) {
 			this->read_vars.push_back(e.read_vars[i]);
+			insert_id(this->read_ids, e.read_vars[i]);
 		}
 	}
 	len = e.write_vars.size();
@@ -199,6 +255,7 @@ Effect::add_effect(const Effect &e, bool include_lhs_effects)
 		// this->write_var(e.write_vars[i]);
 		if (!is_written(e.write_vars[i])) {
 			this->write_vars.push_back(e.write_vars[i]);
+			insert_id(this->write_ids, e.write_vars[i]);
 		}
 	}
 
@@ -245,72 +302,44 @@ Effect::add_external_effect(const Effect &e)
  * variables of caller(s) 
  */
 void
-Effect::add_external_effect(const Effect &e, std::vector<const Block*> call_chain)
+Effect::add_external_effect(const Effect &e, const std::vector<const Block*> &call_chain)
 {
 	if (this == &e) {
 		return;
 	}
 	
 	vector<Variable *>::size_type len;
-	vector<Variable *>::size_type i, j;
+	vector<Variable *>::size_type i;
 
 	len = e.read_vars.size();
 	for (i = 0; i < len; ++i) {
 		const Variable* var = e.read_vars[i];
-		if (var->is_global()) {
+		if (var->is_global() || is_on_call_chain(var, call_chain)) {
 			read_var(var);
 		}
-		else {
-			for (j=0; j<call_chain.size(); j++) {
-				const Block* b = call_chain[j];
-				if (b->is_var_on_stack(var)) {
-					break;
-				}
-			}
-			if (j < call_chain.size()) {
-				read_var(var);
-			}
-		}
 	}
 
 	len = e.write_vars.size();
 	for (i = 0; i < len; ++i) {
 		const Variable* var = e.write_vars[i];
-		if (var->is_global()) {
+		if (var->is_global() || is_on_call_chain(var, call_chain)) {
 			write_var(var);
 			//Make sure the "purity" is set correctly
 			pure = false;
 		}
-		else {
-			for (j=0; j<call_chain.size(); j++) {
-				const Block* b = call_chain[j];
-				if (b->is_var_on_stack(var)) {
-					break;
-				}
-			}
-			if (j < call_chain.size()) {
-				write_var(var);
-				pure = false;
-			}
-		}
 	}
 	side_effect_free &= e.side_effect_free;
 }
 
 /*
- * TODO: tried doing this with `find', but I couldn't get all the `const's
- * right.  Gave up; wrote it by hand!
+ * A variable is read if it is in the read set, looked up by id, or if it
+ * is a field of a variable that is read.
  */
 bool
 Effect::is_read(const Variable *v) const
 {
-	vector<Variable *>::size_type len = read_vars.size();
-	vector<Variable *>::size_type i;
-
-	for (i = 0; i < len; ++i) {
-		if (read_vars[i] == v) {
-			return true;
-		}
+	if (has_id(read_ids, v)) {
+		return true;
 	}
 	// if we read a struct, presumingly all the fields are read too
 	// however we can not say the same thing for unions: reading a particular
@@ -369,13 +398,8 @@ Effect::is_read(string vname) const
 bool
 Effect::is_written(const Variable *v) const
 {
-	vector<Variable *>::size_type len = write_vars.size();
-	vector<Variable *>::size_type i;
-
-	for (i = 0; i < len; ++i) {
-		if (write_vars[i] == v) {
-			return true;
-		}
+	if (has_id(write_ids, v)) {
+		return true;
 	}
 	// if we write a struct/union, presumingly all the fields are written too
 	if (v->field_var_of) {
@@ -514,6 +538,7 @@ Effect::consolidate(void)
 	for (i=0; i<len; i++) {
 		const Variable* tmp = read_vars[i];
 		if (tmp->is_field_var() && is_read(tmp->field_var_of)) {
+			erase_id(read_ids, tmp);
 			read_vars.erase(read_vars.begin() + i);
 			i--;
 			len--;
@@ -523,6 +548,7 @@ Effect::consolidate(void)
 	for (i=0; i<len; i++) {
 		const Variable* tmp = write_vars[i];
 		if (tmp->is_field_var() && is_written(tmp->field_var_of)) {
+			erase_id(write_ids, tmp);
 			write_vars.erase(write_vars.begin() + i);
 			i--;
 			len--;
@@ -536,9 +562,9 @@ Effect::consolidate(void)
 bool
 Effect::has_race_with(const Effect &e) const
 {
-	return (non_empty_intersection(this->read_vars,  e.write_vars)
-			|| non_empty_intersection(this->write_vars, e.read_vars)
-			|| non_empty_intersection(this->write_vars, e.write_vars));
+	return (non_empty_intersection(this->read_vars, this->read_ids, e.write_vars, e.write_ids)
+			|| non_empty_intersection(this->write_vars, this->write_ids, e.read_vars, e.read_ids)
+			|| non_empty_intersection(this->write_vars, this->write_ids, e.write_vars, e.write_ids));
 }
 
 /*
@@ -558,6 +584,8 @@ Effect::clear(void)
 {
 	read_vars.clear();
 	write_vars.clear();
+	read_ids.clear();
+	write_ids.clear();
 	pure = side_effect_free = true;
 }
 
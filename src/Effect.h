@@ -55,7 +55,7 @@ public:
 	void write_var(const Variable *v);
 	void write_var_set(const std::vector<const Variable *>& vars);
 	void add_effect(const Effect &e, bool include_lhs_effects = false);
-	void add_external_effect(const Effect &e, std::vector<const Block*> call_chain);
+	void add_external_effect(const Effect &e, const std::vector<const Block*> &call_chain);
 	void add_external_effect(const Effect &e);
 	void clear(void);
 
@@ -97,6 +97,11 @@ private:
 	std::vector<const Variable *> write_vars;
 	std::vector<const Variable *> lhs_write_vars;
 
+	// ids of the variables in read_vars and write_vars, kept sorted so that
+	// looking a variable up does not scan the (ordered) vectors above
+	std::vector<unsigned int> read_ids;
+	std::vector<unsigned int> write_ids;
+
 	bool pure;
 	bool side_effect_free;
 
@@ -28,6 +28,8 @@
 // POSSIBILITY OF SUCH DAMAGE.
  
 #include <assert.h>
+#include <algorithm>
+#include <unordered_set>
 #include "Fact.h"
 #include "Variable.h"
 #include "Lhs.h"
@@ -113,6 +115,25 @@ Fact::doFinalization()
 	facts_.clear();
 }
 
+/*
+ * release the given facts, typically clones made by copy_facts, which must
+ * not be referenced any more
+ */
+void
+Fact::discard_facts(const std::vector<Fact*>& facts)
+{
+	if (facts.empty()) {
+		return;
+	}
+	std::unordered_set<const Fact*> discarded(facts.begin(), facts.end());
+	facts_.erase(std::remove_if(facts_.begin(), facts_.end(),
+		[&discarded](const Fact* f) { return discarded.count(f) > 0; }), facts_.end());
+	std::unordered_set<const Fact*>::iterator i;
+	for (i = discarded.begin(); i != discarded.end(); ++i) {
+		delete (*i);
+	}
+}
+
 // fact manipulating functions
 int 
 find_fact(const FactVec& facts, const Fact* fact)
@@ -98,6 +98,9 @@ public:
 
 	static void doFinalization();
 
+	// release facts that are no longer referenced before doFinalization
+	static void discard_facts(const std::vector<Fact*>& facts);
+
 	enum eFactCategory eCat;
 
 protected: 
@@ -37,6 +37,7 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include "Fact.h"
 #include "FactPointTo.h"
@@ -59,6 +60,8 @@
 #include "Lhs.h"
 #include "CFGEdge.h"
 
+#include "CLSmith/CLOptions.h"
+
 using namespace std; 
  
 std::vector<Fact*> FactMgr::meta_facts;
@@ -213,16 +216,32 @@ FactMgr::setup_in_out_maps(bool first_time)
 {
 	if (first_time) {
 		// first time revisit, create map_facts_in_final and map_facts_out_final with cloned facts 
+		// with --compact_facts, only the point-to facts after each statement are kept, which
+		// aggregate_all_pointto_sets needs: the others are only output with --paranoid
+		bool compact = CLSmith::CLOptions::compact_facts() && !CGOptions::paranoid();
 		map<const Statement*, vector<const Fact*> >::const_iterator iter;
-		for(iter = map_facts_in.begin(); iter != map_facts_in.end(); ++iter) {
-			const Statement* stm = iter->first;
-			const vector<const Fact*>& facts1 = iter->second;
-			map_facts_in_final[stm] = copy_facts(facts1);
-		}    
+		if (!compact) {
+			for(iter = map_facts_in.begin(); iter != map_facts_in.end(); ++iter) {
+				const Statement* stm = iter->first;
+				const vector<const Fact*>& facts1 = iter->second;
+				map_facts_in_final[stm] = copy_facts(facts1);
+			}    
+		}
 		for(iter = map_facts_out.begin(); iter != map_facts_out.end(); ++iter) {
 			const Statement* stm = iter->first;
 			const vector<const Fact*>& facts1 = iter->second; 
-			map_facts_out_final[stm] = copy_facts(facts1);
+			if (compact) {
+				FactVec pointto_facts;
+				for (size_t i=0; i<facts1.size(); i++) {
+					if (facts1[i]->eCat == ePointTo) {
+						pointto_facts.push_back(facts1[i]);
+					}
+				}
+				map_facts_out_final[stm] = copy_facts(pointto_facts);
+			}
+			else {
+				map_facts_out_final[stm] = copy_facts(facts1);
+			}
 		}    
 	}
 	else {  
@@ -470,7 +489,8 @@ FactMgr::update_facts_for_dest(const FactVec& facts_in, FactVec& facts_out, cons
  * 
  */
 FactMgr::FactMgr(const Function* f)
-: func(f)
+: compacted(false),
+  func(f)
 { 
 }
 
@@ -484,6 +504,7 @@ FactMgr::~FactMgr(void)
 		delete cfg_edges[i];
 	}
 	cfg_edges.clear();
+	map_edges_in.clear();
 }
 
 void
@@ -625,6 +646,38 @@ FactMgr::create_cfg_edge(const Statement* src, const Statement* dest, bool post_
 {
 	CFGEdge* edge = new CFGEdge(src, dest, post_dest, is_back_link);
 	cfg_edges.push_back(edge);
+	map_edges_in[dest].push_back(edge);
+}
+
+/*
+ * delete the index-th control flow graph edge
+ */
+void
+FactMgr::remove_cfg_edge(size_t index)
+{
+	assert(index < cfg_edges.size());
+	const CFGEdge* edge = cfg_edges[index];
+	cfg_edges.erase(cfg_edges.begin() + index);
+
+	std::map<const Statement*, std::vector<const CFGEdge*> >::iterator i = map_edges_in.find(edge->dest);
+	assert(i != map_edges_in.end());
+	std::vector<const CFGEdge*>& edges = i->second;
+	edges.erase(std::find(edges.begin(), edges.end(), edge));
+	if (edges.empty()) {
+		map_edges_in.erase(i);
+	}
+	delete edge;
+}
+
+/*
+ * return the control flow graph edges leading to a statement
+ */
+const std::vector<const CFGEdge*>&
+FactMgr::find_cfg_edges_in(const Statement* dest) const
+{
+	static const std::vector<const CFGEdge*> no_edges;
+	std::map<const Statement*, std::vector<const CFGEdge*> >::const_iterator i = map_edges_in.find(dest);
+	return (i == map_edges_in.end()) ? no_edges : i->second;
 }
 
 void
@@ -732,6 +785,35 @@ FactMgr::find_dangling_global_ptrs(Function* f)
 	}
 }
 
+/*
+ * drop the facts kept for each statement of a function that is complete and
+ * will not be analysed again: the function summary (global_facts, the effect
+ * of each statement and the CFG edges) is all that later calls and passes use
+ */
+void
+FactMgr::compact(void)
+{
+	FactPointTo::aggregate_pointto_sets(map_facts_out_final, compacted_ptrs, compacted_aliases);
+
+	vector<Fact*> final_facts;
+	map<const Statement*, vector<Fact*> >::iterator iter;
+	for(iter = map_facts_in_final.begin(); iter != map_facts_in_final.end(); ++iter) {
+		final_facts.insert(final_facts.end(), iter->second.begin(), iter->second.end());
+	}
+	for(iter = map_facts_out_final.begin(); iter != map_facts_out_final.end(); ++iter) {
+		final_facts.insert(final_facts.end(), iter->second.begin(), iter->second.end());
+	}
+	Fact::discard_facts(final_facts);
+
+	map_facts_in.clear();
+	map_facts_out.clear();
+	map_facts_in_final.clear();
+	map_facts_out_final.clear();
+	map_accum_effect.clear();
+	map_visited.clear();
+	compacted = true;
+}
+
 void
 FactMgr::sanity_check_map() const
 {
@@ -94,6 +94,8 @@ public:
 	void add_fact_out(const Statement* stm, const Fact* fact);
 
 	void create_cfg_edge(const Statement* src, const Statement* dest, bool post_stm_edge, bool back_link);
+	void remove_cfg_edge(size_t index);
+	const std::vector<const CFGEdge*>& find_cfg_edges_in(const Statement* dest) const;
 
 	void clear_map_visited(void);
 	void backup_stm_fact_maps(const Statement* stm, map<const Statement*, FactVec>& facts_in, map<const Statement*, FactVec>& facts_out);
@@ -137,6 +139,8 @@ public:
 	
 	void sanity_check_map() const;
 
+	void compact(void);
+
 	static std::vector<Fact*> meta_facts; 
 
 	// maps to track facts and effects at historical generation points.
@@ -150,8 +154,19 @@ public:
 	std::map<const Statement*, bool> map_visited;
 
 	std::vector<const CFGEdge*> cfg_edges;
+	// the same edges indexed by destination, in the order they were created.
+	// only create_cfg_edge and remove_cfg_edge should change cfg_edges.
+	// this is only an index: the facts are still propagated along the edges
+	// by Block::find_fixed_point, and dominance is not kept (see TODO)
+	std::map<const Statement*, std::vector<const CFGEdge*> > map_edges_in;
 	FactVec global_facts; 
 
+	// set by compact(), which drops the per-statement facts and keeps the
+	// point-to sets of map_facts_out_final for aggregate_all_pointto_sets
+	bool compacted;
+	std::vector<const Variable*> compacted_ptrs;
+	std::vector<std::vector<const Variable*> > compacted_aliases;
+
 	const Function* func;
 };
 
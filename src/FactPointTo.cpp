@@ -827,6 +827,40 @@ FactPointTo::update_ptr_aliases(const vector<Fact*>& facts, vector<const Variabl
 	}
 }
 
+/*
+ * merge point-to sets aggregated separately, as if their facts had been given
+ * to update_ptr_aliases 
+ */
+void
+FactPointTo::merge_ptr_aliases(const vector<const Variable*>& from_ptrs, const vector<vector<const Variable*> >& from_aliases, vector<const Variable*>& ptrs, vector<vector<const Variable*> >& aliases)
+{
+	size_t i, j;
+	for (j=0; j<from_ptrs.size(); j++) {
+		int pos = find_variable_in_set(ptrs, from_ptrs[j]);
+		if (pos == -1) {
+			ptrs.push_back(from_ptrs[j]);
+			aliases.push_back(from_aliases[j]);
+		}
+		else {
+			for (i=0; i<from_aliases[j].size(); i++) {
+				const Variable* v = from_aliases[j][i];
+				if (find_variable_in_set(aliases[pos], v) == -1) {
+					aliases[pos].push_back(v);
+				}
+			}
+		}
+	}
+}
+
+void
+FactPointTo::aggregate_pointto_sets(const map<const Statement*, vector<Fact*> >& facts, vector<const Variable*>& ptrs, vector<vector<const Variable*> >& aliases)
+{
+	map<const Statement*, vector<Fact*> >::const_iterator iter; 
+	for(iter = facts.begin(); iter != facts.end(); ++iter) { 
+		update_ptr_aliases(iter->second, ptrs, aliases);
+	} 
+}
+
 void
 FactPointTo::aggregate_all_pointto_sets(void) 
 {
@@ -836,10 +870,9 @@ FactPointTo::aggregate_all_pointto_sets(void)
 		if (funcs[i]->is_builtin)
 			continue;
 		FactMgr* fm = get_fact_mgr_for_func(funcs[i]);
-		map<const Statement*, vector<Fact*> >::iterator iter; 
-		for(iter = fm->map_facts_out_final.begin(); iter != fm->map_facts_out_final.end(); ++iter) { 
-			update_ptr_aliases(iter->second, all_ptrs, all_aliases);
-		} 
+		aggregate_pointto_sets(fm->map_facts_out_final, all_ptrs, all_aliases);
+		// the sets of a function whose facts were compacted
+		merge_ptr_aliases(fm->compacted_ptrs, fm->compacted_aliases, all_ptrs, all_aliases);
 	}
 	assert(all_ptrs.size() == all_aliases.size());
 }
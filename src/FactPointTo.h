@@ -32,6 +32,7 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <map>
 #include <ostream>
 #include <vector>
 #include "Fact.h"
@@ -95,6 +96,7 @@ public:
 	static std::vector<const Variable*> merge_pointees_of_pointers(const std::vector<const Variable*>& ptrs, const std::vector<const Fact*>& facts);
 	static void update_facts_with_modified_index(std::vector<const Fact*>& facts, const Variable* var);
 	static void aggregate_all_pointto_sets(void);
+	static void aggregate_pointto_sets(const std::map<const Statement*, std::vector<Fact*> >& facts, vector<const Variable*>& ptrs, vector<vector<const Variable*> >& aliases);
 
 	static int opportunistic_validate(const Variable* var, const Type* type, const std::vector<const Fact*>& facts);
 	static bool is_valid_ptr(const Variable* p, const std::vector<const Fact*>& facts);
@@ -120,6 +122,7 @@ private:
 	vector<const Variable*> point_to_vars; 
 	
 	static void update_ptr_aliases(const vector<Fact*>& facts, vector<const Variable*>& ptrs, vector<vector<const Variable*> >& aliases);
+	static void merge_ptr_aliases(const vector<const Variable*>& from_ptrs, const vector<vector<const Variable*> >& from_aliases, vector<const Variable*>& ptrs, vector<vector<const Variable*> >& aliases);
 
 	// unimplement 
 	FactPointTo(const FactPointTo& f);
@@ -29,6 +29,7 @@
 
 #include "Finalization.h"
 
+#include "Constant.h"
 #include "Function.h"
 #include "RandomNumber.h"
 #include "VariableSelector.h"
@@ -45,6 +46,7 @@ Finalization::doFinalization()
 	Function::doFinalization();
 	VariableSelector::doFinalization();
 	Variable::doFinalization();
+	Constant::doFinalization();
 	Type::doFinalization();
 	RandomNumber::doFinalization();
 	FunctionInvocationUser::doFinalization();
@@ -63,6 +63,8 @@
 #include "ExtensionMgr.h"
 #include "OutputMgr.h"
 
+#include "CLSmith/CLOptions.h"
+
 using namespace std;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -473,6 +475,7 @@ Function::make_first(void)
 
 	// collect info about global dangling pointers
 	fm->find_dangling_global_ptrs(f);
+	f->compact_facts();
 	return f;
 }
 
@@ -787,6 +790,21 @@ Function::compute_summary(void)
 	union_field_read = body->read_union_field();
 }
 
+/*
+ * with --compact_facts, drop the facts of each statement once the function is
+ * complete, unless they are needed again: the functions whose facts change,
+ * that read union fields or reference pointers are revisited by later calls,
+ * and output with their facts
+ */
+void
+Function::compact_facts(void)
+{
+	if (!CLSmith::CLOptions::compact_facts() || fact_changed || union_field_read || is_pointer_referenced()) {
+		return;
+	}
+	get_fact_mgr_for_func(this)->compact();
+}
+
 /*
  *
  */
@@ -808,6 +826,7 @@ GenerateFunctions(void)
 		if (FuncList[cur_func_idx]->is_built() == false) {
 			FuncList[cur_func_idx]->GenerateBody(CGContext::get_empty_context());
 			ERROR_RETURN();
+			FuncList[cur_func_idx]->compact_facts();
 		}
 	}
 	FactPointTo::aggregate_all_pointto_sets();
@@ -82,6 +82,7 @@ public:
 
 	void generate_body_with_known_params(const CGContext &prev_context, Effect& effect_accum);
 	void compute_summary(void);
+	void compact_facts(void);
 
 	void Output(std::ostream &);
 	void OutputForwardDecl(std::ostream &);
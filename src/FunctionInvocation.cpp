@@ -559,6 +559,12 @@ FunctionInvocation::visit_facts(vector<const Fact*>& inputs, CGContext& cg_conte
 		// make a copy of env
 		vector<const Fact*> inputs_copy = inputs;
 		const FunctionInvocationUser* func_call = dynamic_cast<const FunctionInvocationUser*>(this);
+		// the facts of the callee were compacted, as it neither changes facts nor
+		// references pointers: its effect is static, see FunctionInvocationUser::build_invocation
+		if (get_fact_mgr_for_func(func_call->func)->compacted) {
+			cg_context.add_external_effect(func_call->func->get_feffect());
+			return ok;
+		}
 		Effect effect_accum;  
 		//CGContext new_context(func_call->func, cg_context.get_effect_context(), &effect_accum);
 		CGContext new_context(cg_context, func_call->func, cg_context.get_effect_context(), &effect_accum);
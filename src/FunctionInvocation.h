@@ -168,6 +168,8 @@ public:
 
 	virtual bool safe_invocation() const = 0;
 
+	const SafeOpFlags *get_op_flags(void) const { return op_flags; }
+
 	eInvocationType invoke_type;
 
 	std::vector<const Expression*> param_value;
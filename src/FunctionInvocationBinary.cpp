@@ -41,6 +41,7 @@
 #include "Block.h"
 #include "random.h"
 
+#include "CLSmith/SafeMathElision.h"
 #include "CLSmith/Vector.h"
 
 using namespace std;
@@ -346,8 +347,9 @@ FunctionInvocationBinary::Output(std::ostream &out) const
 			if (CGOptions::avoid_signed_overflow()) {
 				string fname = op_flags->to_string(eFunc); 
 				int id = SafeOpFlags::to_id(fname);
-				// don't use safe math wrapper if this function is specified in "--safe-math-wrapper"
-				if (CGOptions::safe_math_wrapper(id)) {
+				// don't use safe math wrapper if this function is specified in "--safe-math-wrapper",
+				// or if it provably cannot overflow
+				if (CGOptions::safe_math_wrapper(id) && !CLSmith::SafeMathElision::CanElide(this)) {
 					out << fname << "(";  
 					if (CGOptions::math_notmp()) {
 						out << tmp_var1 << ", ";
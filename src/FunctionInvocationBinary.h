@@ -80,6 +80,8 @@ public:
 
 	static std::string get_binop_string(eBinaryOps bop);
 
+	static bool safe_ops(eBinaryOps op);
+
 	virtual bool equals(int num) const ;
 	virtual bool is_0_or_1(void) const;
 
@@ -91,9 +93,6 @@ private:
 	std::string tmp_var2;
 
 private:
-
-	static bool safe_ops(eBinaryOps op);
-
 	// unimplemented
 	FunctionInvocationBinary &operator=(const FunctionInvocationBinary &fi);
 
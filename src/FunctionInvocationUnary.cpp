@@ -39,6 +39,7 @@
 #include "CGContext.h"
 #include "random.h"
 
+#include "CLSmith/SafeMathElision.h"
 #include "CLSmith/Vector.h"
 
 using namespace std;
@@ -228,8 +229,9 @@ FunctionInvocationUnary::Output(std::ostream &out) const
 			assert(op_flags);
 			string fname = op_flags->to_string(eFunc);
 			int id = SafeOpFlags::to_id(fname);
-			// don't use safe math wrapper if this function is specified in "--safe-math-wrapper"
-			if (CGOptions::safe_math_wrapper(id)) {
+			// don't use safe math wrapper if this function is specified in "--safe-math-wrapper",
+			// or if it provably cannot overflow
+			if (CGOptions::safe_math_wrapper(id) && !CLSmith::SafeMathElision::CanElide(this)) {
 				out << fname << "(";  
 				if (CGOptions::math_notmp()) {
 					out << tmp_var << ", ";
@@ -69,6 +69,8 @@ public:
 	virtual bool equals(int num) const;
 
 	virtual bool is_0_or_1(void) const { return eFunc == eNot;}
+
+	eUnaryOps get_operation(void) const { return eFunc; }
 	
 	std::string get_tmp_var_const() const { return tmp_var; }
 
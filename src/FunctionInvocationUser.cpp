@@ -251,6 +251,7 @@ FunctionInvocationUser::build_invocation_and_function(CGContext &cg_context, con
 	}
 
 	func->visited_cnt = 1;
+	func->compact_facts();
 	return fiu; 
 }
 
@@ -71,22 +71,8 @@ ProbabilityFilter::filter(int v) const
 	if (prob->check_extra_filter(pname_, v))
 		return true;
 
-	GroupProbElem *elem = dynamic_cast<GroupProbElem*>(prob->probabilities_[pname_]);
-	assert(elem);
-	assert(elem->is_equal());
-
-	map<ProbName, SingleProbElem *>::iterator i;
-	bool rv = false;
-	for (i = elem->probs_.begin(); i != elem->probs_.end(); ++i) {
-		ProbName pname = (*i).first;
-		unsigned val = Probabilities::pname_to_type(pname);
-		if ((static_cast<unsigned int>(v)) == val) {
-			int prob = (*i).second->get_prob_direct();
-			rv = (prob == 0);
-			break;
-		}
-	}
-	return rv;
+	const std::vector<bool> &filtered_out = prob->filtered_out_[pname_];
+	return static_cast<size_t>(v) < filtered_out.size() && filtered_out[v];
 }
 
 /////////////////////////////////////////////////////////////////
@@ -814,6 +800,7 @@ Probabilities::get_prob_filter(ProbName pname)
 {
 	Probabilities *impl = Probabilities::GetInstance();
 	assert(impl);
+	assert(pname < MAX_ALL_PROB_NAME);
 	Filter *filter = impl->prob_filters_[pname];
 	if (!filter)
 		filter = impl->extra_filters_[pname];
@@ -834,6 +821,7 @@ Probabilities::register_extra_filter(ProbName pname, Filter *filter)
 	assert(filter);
 	Probabilities *impl = Probabilities::GetInstance();
 	assert(impl);
+	assert(pname < MAX_ALL_PROB_NAME);
 	impl->extra_filters_[pname] = filter;
 }
 
@@ -865,11 +853,8 @@ bool
 Probabilities::check_extra_filter(ProbName pname, int v)
 {
 	assert(v >= 0);
-	std::map<ProbName, Filter*>::iterator i = extra_filters_.find(pname);	
-	if (i != extra_filters_.end())
-		return (*i).second->filter(v);
-	else
-		return false;
+	Filter *filter = extra_filters_[pname];
+	return filter && filter->filter(v);
 }
 
 // set up default probabilities
@@ -879,14 +864,45 @@ Probabilities::initialize()
 	set_single_name_maps();
 	initialize_single_probs();
 	initialize_group_probs();
+	compile();
+}
+
+void
+Probabilities::compile()
+{
+	std::fill(single_probs_, single_probs_ + MAX_ALL_PROB_NAME, -1);
+	std::map<ProbName, ProbElem*>::iterator i;
+	for (i = probabilities_.begin(); i != probabilities_.end(); ++i) {
+		ProbName pname = (*i).first;
+		assert(pname < MAX_ALL_PROB_NAME);
+		GroupProbElem *group = dynamic_cast<GroupProbElem*>((*i).second);
+		if (!group) {
+			single_probs_[pname] = (*i).second->get_prob(pname);
+			continue;
+		}
+		filtered_out_[pname].clear();
+		map<ProbName, SingleProbElem*>::iterator j;
+		for (j = group->probs_.begin(); j != group->probs_.end(); ++j) {
+			ProbName child = (*j).first;
+			int val = (*j).second->get_prob_direct();
+			single_probs_[child] = val;
+			// only equivalent groups are filtered by type
+			if (!group->is_equal())
+				continue;
+			unsigned int type = pname_to_type(child);
+			if (type >= filtered_out_[pname].size())
+				filtered_out_[pname].resize(type + 1, false);
+			filtered_out_[pname][type] = (val == 0);
+		}
+	}
 }
 
 unsigned int
 Probabilities::get_prob(ProbName pname)
 {
 	Probabilities *impl = Probabilities::GetInstance();
-	ProbElem *elem = impl->probabilities_[pname];
-	int val = elem->get_prob(pname);
+	assert(pname < MAX_ALL_PROB_NAME);
+	int val = impl->single_probs_[pname];
 
 	// This assert rules out all invalid accesses to group probs
 	// and invalid single prob
@@ -931,6 +947,7 @@ Probabilities::parse_configuration(std::string &error_msg, const string &fname)
 	}
 	conf.close();
 	//dump_actual_probabilities();
+	compile();
 	return true;
 }
 
@@ -1083,19 +1100,20 @@ Probabilities::dump_actual_probabilities(const string &fname, unsigned long seed
 //////////////////////////////////////////////////////////////////////
 Probabilities::Probabilities()
 {
-
+	std::fill(prob_filters_, prob_filters_ + MAX_ALL_PROB_NAME, static_cast<Filter*>(NULL));
+	std::fill(extra_filters_, extra_filters_ + MAX_ALL_PROB_NAME, static_cast<Filter*>(NULL));
+	std::fill(single_probs_, single_probs_ + MAX_ALL_PROB_NAME, -1);
 }
 
 void
-Probabilities::clear_filter(std::map<ProbName, Filter*> &filters)
+Probabilities::clear_filter(Filter **filters)
 {
-	std::map<ProbName, Filter*>::iterator j;
-	for (j = filters.begin(); j!= filters.end(); ++j) {
-		Filter *f = (*j).second;
+	for (int i = 0; i < MAX_ALL_PROB_NAME; ++i) {
+		Filter *f = filters[i];
 		if (f)
 			delete f;
+		filters[i] = NULL;
 	}
-	filters.clear();
 }
 
 Probabilities::~Probabilities()
@@ -1116,6 +1134,7 @@ void DistributionTable::add_entry(int key, int prob)
 	keys_.push_back(key); 
 	probs_.push_back(prob);  
 	max_prob_ += prob; 
+	bounds_.push_back(max_prob_);
 }
 
 int DistributionTable::key_to_prob(int key) const 
@@ -1132,14 +1151,11 @@ int DistributionTable::key_to_prob(int key) const
 int DistributionTable::rnd_num_to_key(int rnd) const
 {
 	assert(rnd < max_prob_ && rnd >= 0);
-	assert(keys_.size() == probs_.size());
-	for (size_t i=0; i<probs_.size(); i++) {
-		if (rnd < probs_[i]) {
-			return keys_[i];
-		}
-		rnd -= probs_[i];
-	}
-	assert(0);
-	return -1;
+	assert(keys_.size() == bounds_.size());
+	// Keys with no probability share their bound with the key before them, so
+	// they are never found.
+	size_t i = upper_bound_index(bounds_.data(), bounds_.size(), rnd);
+	assert(i < keys_.size());
+	return keys_[i];
 }
 
@@ -150,6 +150,8 @@ enum ProbName {
 
 #define MAX_PROB_NAME ((ProbName)(pStatementProb+1))
 
+#define MAX_ALL_PROB_NAME ((ProbName)(pInt64Prob+1))
+
 #define MoreStructUnionTypeProb \
 	Probabilities::get_prob(pMoreStructUnionProb)
 
@@ -305,7 +307,7 @@ private:
 class Probabilities;
 
 class GroupProbElem : public ProbElem {
-	friend class ProbabilityFilter;
+	friend class Probabilities;
 public:
 	GroupProbElem(bool is_equal, const std::string &sname);
 
@@ -415,7 +417,9 @@ private:
 
 	void initialize_single_probs();
 
-	void clear_filter(std::map<ProbName, Filter*> &filter);
+	void clear_filter(Filter **filters);
+
+	void compile();
 
 	void initialize_group_probs();
 
@@ -443,9 +447,17 @@ private:
 
 	std::map<ProbName, ProbElem *> probabilities_;
 
-	std::map<ProbName, Filter*> prob_filters_;
+	Filter *prob_filters_[MAX_ALL_PROB_NAME];
+
+	Filter *extra_filters_[MAX_ALL_PROB_NAME];
+
+	// The probabilities are looked up for every decision, so compile() flattens
+	// them into arrays once they are set: the value of every single probability
+	// (-1 for groups), and for every group which of its types are filtered out
+	// because their probability is 0.
+	int single_probs_[MAX_ALL_PROB_NAME];
 
-	std::map<ProbName, Filter*> extra_filters_;
+	std::vector<bool> filtered_out_[MAX_ALL_PROB_NAME];
 	//const static ProbabilityFilter *binary_ops_prob_filter_;
 
 	Probabilities();
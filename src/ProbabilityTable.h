@@ -41,24 +41,28 @@
 
 using namespace std;
 
-template <class Key, class Value>
-class TableEntry {
-public:
-	TableEntry(Key k, Value v);
-
-	Key get_key() { return key_; }
-
-	Value get_value() { return value_; }
-
-private:
-	Key key_;
-	Value value_;
-};
+// Index of the first of the sorted values greater than key. The comparisons
+// only decide how far to move, so the search compiles to conditional moves
+// rather than branches the predictor cannot learn.
+template <class T>
+size_t upper_bound_index(const T *values, size_t size, T key)
+{
+	if (size == 0)
+		return 0;
+	size_t base = 0;
+	while (size > 1) {
+		size_t half = size / 2;
+		base += (values[base + half - 1] <= key) ? half : 0;
+		size -= half;
+	}
+	return base + (values[base] <= key ? 1 : 0);
+}
 
+// Maps random numbers to values. The keys are the upper bounds of the ranges
+// of numbers mapped to each value, kept sorted in a flat array next to the
+// values, so that a lookup is a single search.
 template <class Key, class Value>
 class ProbabilityTable {
-	typedef TableEntry<Key, Value> Entry;
-
 public:
 	ProbabilityTable();
 
@@ -68,36 +72,21 @@ public:
 
 	void add_elem(Key k, Value v);
 
-	void sorted_insert(Entry *t);
-
 	Value get_value(Key k);
 
 private:
-	Key curr_max_key_;
-	std::vector<Entry *> table_; 
+	std::vector<Key> keys_;
+	std::vector<Value> values_;
 };
 
-template <class Key, class Value>
-TableEntry<Key, Value>::TableEntry(Key k, Value v)
-	: key_(k),
-	  value_(v)
-{
-}
-
 template <class Key, class Value>
 ProbabilityTable<Key, Value>::ProbabilityTable()
-	: curr_max_key_(0)
 {
-	table_.clear();
 }
 
 template <class Key, class Value>
 ProbabilityTable<Key, Value>::~ProbabilityTable()
 {
-	typename vector<Entry *>::iterator i;
-	for (i = table_.begin(); i != table_.end(); ++i) 
-		delete (*i);
-	table_.clear();
 }
 
 template <class Key, class Value>
@@ -107,70 +96,25 @@ void ProbabilityTable<Key, Value>::initialize(ProbName pname)
 	impl_->set_prob_table(this, pname);
 }
 
-template <class Key, class Value>
-bool my_less(TableEntry<Key, Value> *t, Key k2)
-{
-	Key k1 = t->get_key();
-	return (k1 < k2);
-}
-
-template <class Key, class Value>
-bool my_greater(TableEntry<Key, Value> *t, Key k2)
-{
-	Key k1 = t->get_key();
-	return (k1 > k2);
-}
-
-template <class Key, class Value>
-void
-ProbabilityTable<Key, Value>::sorted_insert(Entry *t)
-{
-	assert(t);
-	
-	Key k = t->get_key();
-
-	if (table_.empty()) {
-		table_.push_back(t);
-		curr_max_key_ = k;
-		return;
-	}
-	
-	typename vector<Entry *>::iterator i;
-	for (i=table_.begin(); i!=table_.end(); i++) {
-		if (my_greater<Key, Value>(*i, k)) {
-			break;
-		}
-	}
-	//i = find_if(table_.begin(), table_.end(), std::bind2nd(std::ptr_fun(my_greater<Key, Value>), k));
-
-	if (i != table_.end()) {
-		table_.insert(i, t);	
-	}
-	else {
-		table_.push_back(t);
-		curr_max_key_ = k;
-	}
-}
-
 template <class Key, class Value>
 void
 ProbabilityTable<Key, Value>::add_elem(Key k, Value v)
 {
-	Entry *t = new Entry(k, v);
-	sorted_insert(t);
+	// Elements with the same key stay in the order they were added.
+	size_t i = upper_bound_index(keys_.data(), keys_.size(), k);
+	keys_.insert(keys_.begin() + i, k);
+	values_.insert(values_.begin() + i, v);
 }
 
 template <class Key, class Value>
 Value
 ProbabilityTable<Key, Value>::get_value(Key k)
 {
-	assert(k < curr_max_key_);
-
-	typename vector<Entry *>::iterator i;
-	i = find_if(table_.begin(), table_.end(), std::bind2nd(std::ptr_fun(my_greater<Key, Value>), k));
+	assert(!keys_.empty() && k < keys_.back());
 
-	assert(i != table_.end());
-	return (*i)->get_value();
+	size_t i = upper_bound_index(keys_.data(), keys_.size(), k);
+	assert(i < values_.size());
+	return values_[i];
 }
 
 class DistributionTable {  
@@ -186,6 +130,9 @@ private:
 	int max_prob_;
 	vector<int> keys_;
 	vector<int> probs_; 
+	// Running totals of probs_, the upper bound of the numbers mapped to each
+	// key.
+	vector<int> bounds_;
 };
 
 #endif
@@ -78,7 +78,9 @@ SimpleDeltaRndNumGenerator::make_rndnum_generator(const unsigned long /*seed*/)
 
 	//srand48(seed);
 
-	impl_->random_point_ = SimpleDeltaRndNumGenerator::pure_rnd_upto(seq->sequence_length());
+	// An empty sequence can still be replayed leniently.
+	if (seq->sequence_length() > 0)
+		impl_->random_point_ = SimpleDeltaRndNumGenerator::pure_rnd_upto(seq->sequence_length());
 
 	assert(impl_);
 	
@@ -100,6 +102,12 @@ SimpleDeltaRndNumGenerator::random_choice (int bound, const Filter *f, const str
 
         if (f) {
 		++filter_depth_;
+		// An edited sequence may hold filtered values, try the next ones.
+		if (DeltaMonitor::is_lenient() && f->filter(rv)) {
+			for (int tries = 1; tries < bound && f->filter(rv); ++tries)
+				rv = (rv + 1) % bound;
+			seq_->add_number(rv, bound, static_cast<int>(rand_depth_ - 1));
+		}
                 if (f->filter(rv)) {
                         Error::set_error(FILTER_ERROR);
                         return -1;
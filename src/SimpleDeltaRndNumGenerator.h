@@ -65,6 +65,9 @@ public:
 
 	virtual enum RNDNUM_GENERATOR kind() { return rSimpleDeltaRndNumGenerator; }
 
+	// Also used for the choices missing from a sequence replayed leniently.
+	static unsigned int pure_rnd_upto(const unsigned int bound);
+
 private:
 	// ------------------------------------------------------------------------------------------
 	SimpleDeltaRndNumGenerator(Sequence *concrete_seq);
@@ -73,8 +76,6 @@ private:
 
 	int random_choice(int bound, const Filter *f = NULL, const std::string *where = NULL);
 
-	static unsigned int pure_rnd_upto(const unsigned int bound);
-
 	static bool pure_rnd_flipcoin(const unsigned int p);
 
 	void switch_to_default_generator();
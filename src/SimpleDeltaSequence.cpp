@@ -35,6 +35,7 @@
 #include <fstream>
 #include "SequenceLineParser.h"
 #include "DeltaMonitor.h"
+#include "SimpleDeltaRndNumGenerator.h"
 #include "CGOptions.h"
 
 using namespace std;
@@ -132,6 +133,10 @@ SimpleDeltaSequence::init_sequence()
 	ifstream seqf(fname.c_str());
 	assert("fail to open simple delta input file!" && seqf.is_open());
 
+	// The sequence may be read again, from another input file, after a
+	// checkpoint.
+	sequence_.clear();
+
 	int i = 0;
 	while (!seqf.eof()) {
 		getline(seqf, line);
@@ -165,7 +170,23 @@ SimpleDeltaSequence::get_number_by_pos(int /*pos*/)
 int
 SimpleDeltaSequence::get_number(int bound)
 {
-	
+	if (DeltaMonitor::is_lenient()) {
+		DeltaMonitor::reach_position(current_pos_);
+		// Record the value actually used, so the output sequence replays
+		// without any wrapping or drawing.
+		std::map<int, SimpleDeltaSequence::ValuePair*>::iterator i = sequence_.find(current_pos_);
+		int value = 0;
+		if (i != sequence_.end())
+			value = (*i).second->get_value() % bound;
+		else if (DeltaMonitor::draws_missing())
+			value = static_cast<int>(SimpleDeltaRndNumGenerator::pure_rnd_upto(bound));
+		if (value < 0)
+			value = 0;
+		seq_map_[current_pos_] = new SimpleDeltaSequence::ValuePair(value, bound);
+		++current_pos_;
+		return value;
+	}
+
 	SimpleDeltaSequence::ValuePair *p = sequence_[current_pos_];
 	assert("SimpleDeltaSequence: get_number p is NULL!" && p);
 	int b = p->get_bound();
@@ -465,10 +465,11 @@ Statement::has_edge_in(bool post_dest, bool back_link) const
 	if (func != 0) {
 		FactMgr* fm = get_fact_mgr_for_func(func);
 		assert(fm);
+		const vector<const CFGEdge*>& edges = fm->find_cfg_edges_in(this);
 		size_t i;
-		for (i=0; i<fm->cfg_edges.size(); i++) {
-			const CFGEdge* e = fm->cfg_edges[i];
-			if (e->dest == this && e->back_link == back_link && e->post_dest == post_dest) {
+		for (i=0; i<edges.size(); i++) {
+			const CFGEdge* e = edges[i];
+			if (e->back_link == back_link && e->post_dest == post_dest) {
 				return true;
 			}
 		}
@@ -487,10 +488,11 @@ Statement::find_edges_in(vector<const CFGEdge*>& edges, bool post_dest, bool bac
 	if (func != 0) {
 		FactMgr* fm = get_fact_mgr_for_func(func);
 		assert(fm);
+		const vector<const CFGEdge*>& edges_in = fm->find_cfg_edges_in(this);
 		size_t i;
-		for (i=0; i<fm->cfg_edges.size(); i++) {
-			const CFGEdge* e = fm->cfg_edges[i];
-			if (e->dest == this && e->back_link == back_link && e->post_dest == post_dest) {
+		for (i=0; i<edges_in.size(); i++) {
+			const CFGEdge* e = edges_in[i];
+			if (e->back_link == back_link && e->post_dest == post_dest) {
 				edges.push_back(e);
 			}
 		}
@@ -507,10 +509,11 @@ Statement::find_jump_label(void) const
 	if (func != 0) {
 		FactMgr* fm = get_fact_mgr_for_func(func);
 		assert(fm);
+		const vector<const CFGEdge*>& edges = fm->find_cfg_edges_in(this);
 		size_t i;
-		for (i=0; i<fm->cfg_edges.size(); i++) {
-			const CFGEdge* e = fm->cfg_edges[i];
-			if (e->dest == this && e->src->eType == eGoto) {
+		for (i=0; i<edges.size(); i++) {
+			const CFGEdge* e = edges[i];
+			if (e->src->eType == eGoto) {
 				const StatementGoto* sg = dynamic_cast<const StatementGoto*>(e->src);
 				assert(sg);
 				return sg->label;
@@ -529,11 +532,12 @@ Statement::find_jump_sources(std::vector<const StatementGoto*>& gotos) const
 	if (func != 0) {
 		FactMgr* fm = get_fact_mgr_for_func(func);
 		assert(fm);
+		const vector<const CFGEdge*>& edges = fm->find_cfg_edges_in(this);
 		size_t i;
 		gotos.clear();
-		for (i=0; i<fm->cfg_edges.size(); i++) {
-			const CFGEdge* e = fm->cfg_edges[i];
-			if (e->dest == this && e->src->eType == eGoto) {
+		for (i=0; i<edges.size(); i++) {
+			const CFGEdge* e = edges[i];
+			if (e->src->eType == eGoto) {
 				const StatementGoto* sg = dynamic_cast<const StatementGoto*>(e->src);
 				assert(sg);
 				gotos.push_back(sg);
@@ -867,8 +871,6 @@ Statement::analyze_with_edges_in(vector<const Fact*>& inputs, CGContext& cg_cont
 	FactMgr* fm = get_fact_mgr(&cg_context); 
 	size_t i;
 	vector<const CFGEdge*> edges;
-	if (find_jump_label()=="lbl_101")
-		i = 0;
 	// consider output from back edges. we should not merge them if this is the first time
 	if (fm->map_visited[this] && has_edge_in(false, true)) {  
 		find_edges_in(edges, false, true);
@@ -38,6 +38,8 @@
 
 #include "Type.h"
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 #include <assert.h>
 #include <math.h>
 #include "Common.h"
@@ -69,6 +71,28 @@ Type *Type::void_type = NULL;
 static vector<Type *> AllTypes;
 static vector<Type *> derived_types;
 
+// AllTypes as a set, for find_type
+static unordered_set<const Type *> all_type_set;
+
+// the pointer type to each type, among derived_types
+static unordered_map<const Type *, Type *> pointer_types;
+
+// The struct or union types of AllTypes for each combination of the arguments
+// of get_all_ok_struct_union_types, in the order of AllTypes, and how many of
+// AllTypes have been looked at for each. As types are only ever appended to
+// AllTypes, a list is brought up to date by looking at the types added since
+// it was last used.
+static const int OK_STRUCT_UNION_CATEGORIES = 16;
+static vector<Type *> ok_struct_union_types[OK_STRUCT_UNION_CATEGORIES];
+static size_t ok_struct_union_scanned[OK_STRUCT_UNION_CATEGORIES];
+
+static void
+add_type(Type *t)
+{
+	AllTypes.push_back(t);
+	all_type_set.insert(t);
+}
+
 //////////////////////////////////////////////////////////////////////
 class NonVoidTypeFilter : public Filter
 {
@@ -362,7 +386,7 @@ Type::get_simple_type(eSimpleType st)
 		if (Type::simple_types[st] == 0) {
 			Type *t = new Type(st);
 			Type::simple_types[st] = t;
-	    		AllTypes.push_back(t);
+			add_type(t);
 		}
 	}
 	return *Type::simple_types[st];
@@ -371,38 +395,24 @@ Type::get_simple_type(eSimpleType st)
 const Type *
 Type::get_type_from_string(const string &type_string)
 {
+	static const struct {
+		const char *name;
+		eSimpleType type;
+	} simple_type_names[] = {
+		{ "Char", eChar }, { "UChar", eUChar },
+		{ "Short", eShort }, { "UShort", eUShort },
+		{ "Int", eInt }, { "UInt", eUInt },
+		{ "Long", eLong }, { "ULong", eULong },
+		{ "Longlong", eLongLong }, { "ULonglong", eULongLong },
+	};
+
 	if (type_string == "Void") {
 		return Type::void_type;
 	}
-	else if (type_string == "Char") {
-		return &Type::get_simple_type(eChar);
-	}
-	else if (type_string == "UChar") {
-		return &Type::get_simple_type(eUChar);
-	}
-	else if (type_string == "Short") {
-		return &Type::get_simple_type(eShort);
-	}
-	else if (type_string == "UShort") {
-		return &Type::get_simple_type(eUShort);
-	}
-	else if (type_string == "Int") {
-		return &Type::get_simple_type(eInt);
-	}
-	else if (type_string == "UInt") {
-		return &Type::get_simple_type(eUInt);
-	}
-	else if (type_string == "Long") {
-		return &Type::get_simple_type(eLong);
-	}
-	else if (type_string == "ULong") {
-		return &Type::get_simple_type(eULong);
-	}
-	else if (type_string == "Longlong") {
-		return &Type::get_simple_type(eLongLong);
-	}
-	else if (type_string == "ULonglong") {
-		return &Type::get_simple_type(eULongLong);
+	for (size_t i = 0; i < sizeof(simple_type_names) / sizeof(simple_type_names[0]); i++) {
+		if (type_string == simple_type_names[i].name) {
+			return &Type::get_simple_type(simple_type_names[i].type);
+		}
 	}
 
 	assert(0 && "Unsupported type string!");
@@ -421,12 +431,7 @@ get_int_type()
 Type*
 Type::find_type(const Type* t)
 { 
-    for (size_t i=0; i<AllTypes.size(); i++) {
-        if (AllTypes[i] == t) {
-            return AllTypes[i];
-        }
-    }
-    return 0;
+	return all_type_set.count(t) ? const_cast<Type*>(t) : 0;
 }
 
 // ---------------------------------------------------------------------
@@ -436,14 +441,14 @@ Type::find_type(const Type* t)
 Type*
 Type::find_pointer_type(const Type* t, bool add)
 { 
-    for (size_t i=0; i<derived_types.size(); i++) {
-        if (derived_types[i]->ptr_type == t) {
-            return derived_types[i];
-        }
-    }
+	unordered_map<const Type *, Type *>::iterator iter = pointer_types.find(t);
+	if (iter != pointer_types.end()) {
+		return iter->second;
+	}
 	if (add) {
 		Type* ptr_type = new Type(t);
 		derived_types.push_back(ptr_type);
+		pointer_types[t] = ptr_type;
 		return ptr_type;
 	}
     return 0;
@@ -501,12 +506,14 @@ Type::signed_overflow_possible() const
 	return eType == eSimple && is_signed() && ((int)SizeInBytes()) >= CGOptions::int_size();
 }
 
-void
-Type::get_all_ok_struct_union_types(vector<Type *> &ok_types, bool no_const, bool no_volatile, bool need_int_field, bool bStruct)
+const vector<Type *> &
+Type::get_all_ok_struct_union_types(bool no_const, bool no_volatile, bool need_int_field, bool bStruct)
 {
-	vector<Type *>::iterator i; 
-	for(i = AllTypes.begin(); i != AllTypes.end(); ++i) {
-		Type* t = (*i);
+	int category = no_const | (no_volatile << 1) | (need_int_field << 2) | (bStruct << 3);
+	vector<Type *> &ok_types = ok_struct_union_types[category];
+	size_t &scanned = ok_struct_union_scanned[category];
+	for(; scanned < AllTypes.size(); ++scanned) {
+		Type* t = AllTypes[scanned];
 		if (bStruct && t->eType != eStruct) continue;
 		if (!bStruct && t->eType != eUnion) continue;
 		if ((no_const && t->is_const_struct_union()) ||
@@ -516,10 +523,11 @@ Type::get_all_ok_struct_union_types(vector<Type *> &ok_types, bool no_const, boo
 		}
 		ok_types.push_back(t);
 	}
+	return ok_types;
 }
 
 const Type*
-Type::choose_random_struct_union_type(vector<Type *> &ok_types)
+Type::choose_random_struct_union_type(const vector<Type *> &ok_types)
 {
 	size_t sz = ok_types.size();
 	assert(sz > 0);
@@ -557,8 +565,7 @@ Type::choose_random_struct_from_type(const Type* type, bool no_volatile)
 		return NULL;
 
 	const Type* t = type;
-	vector<Type *> ok_struct_types;
-	get_all_ok_struct_union_types(ok_struct_types, no_volatile, false, true, true);
+	const vector<Type *> &ok_struct_types = get_all_ok_struct_union_types(no_volatile, false, true, true);
 
 	if (ok_struct_types.size() > 0) {
 		DEPTH_GUARD_BY_DEPTH_RETURN(1, NULL);
@@ -1028,7 +1035,7 @@ Type::make_all_struct_union_types(void)
 		make_all_struct_types(level, accum_types);
 		assert(accum_types.size() >= AllTypes.size());
 		for (size_t i = AllTypes.size(); i < accum_types.size(); ++i)
-			AllTypes.push_back(const_cast<Type*>(accum_types[i]));
+			add_type(const_cast<Type*>(accum_types[i]));
 	}
 }
 
@@ -1151,7 +1158,7 @@ Type::GenerateSimpleTypes(void)
     unsigned int st;
     for (st=eChar; st<MAX_SIMPLE_TYPES; st++)
     { 
-		AllTypes.push_back(new Type((enum eSimpleType)st));
+		add_type(new Type((enum eSimpleType)st));
     }
     Type::void_type = new Type((enum eSimpleType)eVoid);
 }
@@ -1173,13 +1180,13 @@ GenerateAllTypes(void)
     if (CGOptions::use_struct()) {
         while (MoreTypesProbability()) { 
 		    Type *ty = Type::make_random_struct_type(); 
-		    AllTypes.push_back(ty);
+		    add_type(ty);
 	    }
     }
 	if (CGOptions::use_union()) {
         while (MoreTypesProbability()) { 
 		    Type *ty = Type::make_random_union_type(); 
-		    AllTypes.push_back(ty);
+		    add_type(ty);
 	    }
     }
 }
@@ -1603,8 +1610,7 @@ Type::SelectLType(bool no_volatile, eAssignOps op)
 
 	// choose a struct type as LHS type
 	if (!type) {
-		vector<Type *> ok_struct_types;
-		get_all_ok_struct_union_types(ok_struct_types, true, no_volatile, false, true);
+		const vector<Type *> &ok_struct_types = get_all_ok_struct_union_types(true, no_volatile, false, true);
 		if ((ok_struct_types.size() > 0) && (op == eSimpleAssign) && rnd_flipcoin(StructAsLTypeProb)) {
 			type = Type::choose_random_struct_union_type(ok_struct_types);
 		}
@@ -1820,10 +1826,16 @@ Type::doFinalization(void)
 	for(j = AllTypes.begin(); j != AllTypes.end(); ++j)
 		delete (*j);
 	AllTypes.clear();
+	all_type_set.clear();
+	for (int i = 0; i < OK_STRUCT_UNION_CATEGORIES; ++i) {
+		ok_struct_union_types[i].clear();
+		ok_struct_union_scanned[i] = 0;
+	}
 
 	for(j = derived_types.begin(); j != derived_types.end(); ++j)
 		delete (*j);
 	derived_types.clear();
+	pointer_types.clear();
 }
 
 
@@ -116,13 +116,14 @@ public:
 
 	static const Type *choose_random_struct_from_type(const Type* type, bool no_volatile);
 
-	static void get_all_ok_struct_union_types(vector<Type *> &ok_types, bool no_const, bool no_volatile, bool need_int_field, bool bStruct);
+	// the struct (or union) types satisfying the constraints, in the order they were made
+	static const vector<Type *> &get_all_ok_struct_union_types(bool no_const, bool no_volatile, bool need_int_field, bool bStruct);
 
 	bool has_int_field() const;
 
 	bool signed_overflow_possible() const;
 
-	static const Type* choose_random_struct_union_type(vector<Type *> &ok_types);
+	static const Type* choose_random_struct_union_type(const vector<Type *> &ok_types);
 
 	static const Type * choose_random_nonvoid_nonvolatile(void);
 
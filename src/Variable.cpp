@@ -71,6 +71,7 @@ using namespace std;
 // Yang: I changed the definition of ctrl_vars, and ReducerMgr might be affected
 std::vector< std::vector<const Variable*>* > Variable::ctrl_vars_vectors;
 unsigned long Variable::ctrl_vars_count;
+unsigned int Variable::next_id = 0;
 
 const char Variable::sink_var_name[] = "csmith_sink_";
 
@@ -429,7 +430,8 @@ Variable::Variable(const std::string &name, const Type *type,
 	  isAuto(isAuto), isStatic(isStatic), isRegister(isRegister),
 	  isBitfield_(isBitfield), isAddrTaken(false), isAccessOnce(false), 
 	  field_var_of(isFieldVarOf), isArray(false),
-	  qfer(isConsts, isVolatiles)
+	  qfer(isConsts, isVolatiles),
+	  id(next_id++)
 {
 	// nothing else to do
 }
@@ -443,7 +445,8 @@ Variable::Variable(const std::string &name, const Type *type, const Expression*
 	  isAuto(false), isStatic(false), isRegister(false), isBitfield_(false), 
 	  isAddrTaken(false), isAccessOnce(false),
 	  field_var_of(0), isArray(false),
-	  qfer(*qfer)
+	  qfer(*qfer),
+	  id(next_id++)
 {
 	// nothing else to do
 }
@@ -455,7 +458,8 @@ Variable::Variable(const std::string &name, const Type *type, const Expression*
 	  isAddrTaken(false), isAccessOnce(false),
 	  field_var_of(isFieldVarOf),
 	  isArray(isArray),
-	  qfer(*qfer)
+	  qfer(*qfer),
+	  id(next_id++)
 {
 	// nothing else to do
 }
@@ -100,6 +100,7 @@ public:
 	bool is_virtual(void) const;
 	bool is_aggregate(void) const { return type && type->is_aggregate(); }
 	bool match(const Variable* v) const;
+	unsigned int get_id(void) const { return id; }
 	bool loose_match(const Variable* v) const;
 	bool is_pointer(void) const { return type && type->eType == ePointer;}
 	bool is_rv(void) const { return name.find("_rv") != string::npos; }
@@ -172,6 +173,10 @@ protected:
 	static std::vector< std::vector<const Variable*>* > ctrl_vars_vectors;
 	static unsigned long ctrl_vars_count;
 
+	// dense id, so that sets of variables can be kept as sorted ids
+	const unsigned int id;
+	static unsigned int next_id;
+
 	void create_field_vars(const Type* type);
 };
  
@@ -0,0 +1,407 @@
+// Ranks test cases so that the most different ones come first, which is what
+// tamer.pl does with gonzalez.c, without limiting the size or number of test
+// cases.
+//
+// Every test case is split into tokens by a lexer that knows how CLSmith
+// names things, so that programs only differing in numbering compare equal:
+// - comments and preprocessor lines are dropped;
+// - identifiers numbered by CLSmith (g_12, l_3, p_7, func_2, ...) keep only
+//   their prefix;
+// - numbers other than 0 and 1 are all the same token;
+// - safe math macros (safe_add_func_int32_t_s_s, ...) are kept whole, they
+//   name an operation and its types like an operator does.
+// The distance between two test cases is the edit distance between their
+// tokens, computed 64 tokens at a time with Myers' bit-parallel algorithm, or
+// the Jaccard distance between their sets of token bigrams. Either is divided
+// by the size of the larger test case, as tamer.pl does.
+//
+// The ranking is Gonzalez's furthest point first: it starts with the largest
+// test case, then repeatedly picks the test case furthest from every one
+// picked so far. Only the distances from the last pick are computed at every
+// step, in parallel, so memory stays linear in the number of test cases.
+//
+// Usage: tamer [options] files...
+//   --jobs N      number of threads, the number of cores by default
+//   --list FILE   also read the test cases from FILE, one path per line
+//   --max_size N  skip test cases larger than N bytes
+//   --metric M    edit (the default) or jaccard
+//   --top N       only rank the first N test cases, grouping the others with
+//                 the nearest ranked one
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct TestCase {
+  std::string file;
+  // Interned tokens.
+  std::vector<int> tokens;
+  // Sorted distinct token bigrams, for the Jaccard distance.
+  std::vector<uint64_t> bigrams;
+};
+
+class TokenTable {
+ public:
+  int Intern(const std::string& token) {
+    auto it = ids_.find(token);
+    if (it != ids_.end()) return it->second;
+    int id = static_cast<int>(ids_.size());
+    ids_[token] = id;
+    return id;
+  }
+
+ private:
+  std::unordered_map<std::string, int> ids_;
+};
+
+bool IsIdentifierChar(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Drops the number from identifiers CLSmith numbers, such as g_12 or func_2.
+std::string NormaliseIdentifier(const std::string& identifier) {
+  size_t end = identifier.size();
+  while (end > 0 && isdigit(static_cast<unsigned char>(identifier[end - 1])))
+    --end;
+  if (end == identifier.size() || end < 2 || identifier[end - 1] != '_')
+    return identifier;
+  for (size_t idx = 0; idx + 1 < end; ++idx) {
+    if (!isalpha(static_cast<unsigned char>(identifier[idx])))
+      return identifier;
+  }
+  return identifier.substr(0, end);
+}
+
+void Tokenise(const std::string& text, TokenTable *table,
+    std::vector<int> *tokens) {
+  static const char *const kOperators[] = {
+    "<<=", ">>=", "...", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=",
+    "&&", "||", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^="
+  };
+  size_t pos = 0;
+  bool line_start = true;
+  while (pos < text.size()) {
+    char c = text[pos];
+    if (c == '\n') {
+      line_start = true;
+      ++pos;
+      continue;
+    }
+    if (isspace(static_cast<unsigned char>(c))) {
+      ++pos;
+      continue;
+    }
+    if (line_start && c == '#') {
+      // Preprocessor lines may continue over several lines.
+      while (pos < text.size() && text[pos] != '\n') {
+        if (text[pos] == '\\' && pos + 1 < text.size()) ++pos;
+        ++pos;
+      }
+      continue;
+    }
+    line_start = false;
+    if (text.compare(pos, 2, "//") == 0) {
+      pos = text.find('\n', pos);
+      if (pos == std::string::npos) pos = text.size();
+      continue;
+    }
+    if (text.compare(pos, 2, "/*") == 0) {
+      pos = text.find("*/", pos + 2);
+      pos = pos == std::string::npos ? text.size() : pos + 2;
+      continue;
+    }
+    size_t start = pos;
+    if (isdigit(static_cast<unsigned char>(c))) {
+      while (pos < text.size() && (IsIdentifierChar(text[pos]) ||
+          text[pos] == '.'))
+        ++pos;
+      std::string number = text.substr(start, pos - start);
+      unsigned long long value = strtoull(number.c_str(), NULL, 0);
+      tokens->push_back(table->Intern(value <= 1 && number.find('.') ==
+          std::string::npos ? (value ? "1" : "0") : "<number>"));
+      continue;
+    }
+    if (IsIdentifierChar(c)) {
+      while (pos < text.size() && IsIdentifierChar(text[pos])) ++pos;
+      tokens->push_back(table->Intern(
+          NormaliseIdentifier(text.substr(start, pos - start))));
+      continue;
+    }
+    if (c == '"' || c == '\'') {
+      for (++pos; pos < text.size() && text[pos] != c; ++pos)
+        if (text[pos] == '\\') ++pos;
+      ++pos;
+      tokens->push_back(table->Intern(c == '"' ? "<string>" : "<char>"));
+      continue;
+    }
+    size_t length = 1;
+    for (const char *op : kOperators) {
+      if (text.compare(pos, strlen(op), op) == 0) {
+        length = strlen(op);
+        break;
+      }
+    }
+    tokens->push_back(table->Intern(text.substr(pos, length)));
+    pos += length;
+  }
+}
+
+// Edit distance between the token sequences, with Myers' bit-parallel
+// algorithm in blocks of 64 rows (as extended by Hyyro to any length).
+size_t EditDistance(const std::vector<int>& pattern,
+    const std::vector<int>& text) {
+  if (pattern.empty()) return text.size();
+  if (text.empty()) return pattern.size();
+  const size_t kWord = 64;
+  size_t blocks = (pattern.size() + kWord - 1) / kWord;
+
+  // The bits of the rows matching each token of the pattern, per block.
+  std::unordered_map<int, size_t> symbols;
+  for (int token : pattern)
+    symbols.insert(std::make_pair(token, symbols.size()));
+  std::vector<uint64_t> peq(symbols.size() * blocks, 0);
+  for (size_t row = 0; row < pattern.size(); ++row)
+    peq[symbols[pattern[row]] * blocks + row / kWord] |=
+        1ULL << (row % kWord);
+
+  std::vector<uint64_t> pv(blocks, ~0ULL), mv(blocks, 0);
+  std::vector<long> score(blocks);
+  for (size_t block = 0; block < blocks; ++block)
+    score[block] = static_cast<long>((block + 1) * kWord);
+  const uint64_t kHigh = 1ULL << (kWord - 1);
+  for (int token : text) {
+    auto symbol = symbols.find(token);
+    // Every column starts one further from the empty pattern.
+    int hin = 1;
+    for (size_t block = 0; block < blocks; ++block) {
+      uint64_t eq = symbol == symbols.end() ? 0 :
+          peq[symbol->second * blocks + block];
+      uint64_t xv = eq | mv[block];
+      if (hin < 0) eq |= 1;
+      uint64_t xh = (((eq & pv[block]) + pv[block]) ^ pv[block]) | eq;
+      uint64_t ph = mv[block] | ~(xh | pv[block]);
+      uint64_t mh = pv[block] & xh;
+      int hout = (ph & kHigh) ? 1 : (mh & kHigh) ? -1 : 0;
+      ph <<= 1;
+      mh <<= 1;
+      if (hin < 0) mh |= 1;
+      else if (hin > 0) ph |= 1;
+      pv[block] = mh | ~(xv | ph);
+      mv[block] = ph & xv;
+      score[block] += hout;
+      hin = hout;
+    }
+  }
+
+  // The score is kept for the last row of the block, which may be past the end
+  // of the pattern, so the differences below the pattern are taken back.
+  size_t last = (pattern.size() - 1) % kWord;
+  long distance = score[blocks - 1];
+  if (last != kWord - 1) {
+    uint64_t below = ~0ULL << (last + 1);
+    distance -= std::bitset<64>(pv[blocks - 1] & below).count();
+    distance += std::bitset<64>(mv[blocks - 1] & below).count();
+  }
+  return static_cast<size_t>(distance);
+}
+
+std::vector<uint64_t> GetBigrams(const std::vector<int>& tokens) {
+  std::vector<uint64_t> bigrams;
+  for (size_t idx = 0; idx + 1 < tokens.size(); ++idx)
+    bigrams.push_back(static_cast<uint64_t>(tokens[idx]) << 32 |
+        static_cast<uint32_t>(tokens[idx + 1]));
+  std::sort(bigrams.begin(), bigrams.end());
+  bigrams.erase(std::unique(bigrams.begin(), bigrams.end()), bigrams.end());
+  return bigrams;
+}
+
+double JaccardDistance(const std::vector<uint64_t>& lhs,
+    const std::vector<uint64_t>& rhs) {
+  if (lhs.empty() && rhs.empty()) return 0;
+  size_t common = 0;
+  for (size_t left = 0, right = 0; left < lhs.size() && right < rhs.size();) {
+    if (lhs[left] == rhs[right]) {
+      ++common;
+      ++left;
+      ++right;
+    } else if (lhs[left] < rhs[right]) {
+      ++left;
+    } else {
+      ++right;
+    }
+  }
+  return 1 - static_cast<double>(common) /
+      (lhs.size() + rhs.size() - common);
+}
+
+// Runs job on every index below count, on the given number of threads.
+void ParallelFor(size_t count, size_t jobs,
+    const std::function<void(size_t)>& job) {
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> threads;
+  for (size_t thread = 0; thread < std::min(jobs, count); ++thread) {
+    threads.push_back(std::thread([&]() {
+      for (size_t idx = next++; idx < count; idx = next++) job(idx);
+    }));
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+bool ReadFile(const std::string& file, std::string *text) {
+  std::ifstream in(file.c_str());
+  if (!in.is_open()) return false;
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  *text = buffer.str();
+  return true;
+}
+
+void Usage() {
+  std::cout << "usage: tamer [--jobs N] [--list FILE] [--max_size N] "
+               "[--metric edit|jaccard] [--top N] files..." << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  unsigned long max_size = 0;
+  size_t top = 0;
+  bool jaccard = false;
+  std::vector<std::string> files;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string arg = argv[idx];
+    if (arg.compare(0, 2, "--") != 0) {
+      files.push_back(arg);
+      continue;
+    }
+    if (++idx >= argc) {
+      Usage();
+      return 1;
+    }
+    if (arg == "--jobs") {
+      jobs = std::max(1ul, strtoul(argv[idx], NULL, 10));
+    } else if (arg == "--list") {
+      std::ifstream list(argv[idx]);
+      if (!list.is_open()) {
+        std::cout << "Cannot read " << argv[idx] << "." << std::endl;
+        return 1;
+      }
+      std::string line;
+      while (std::getline(list, line))
+        if (!line.empty()) files.push_back(line);
+    } else if (arg == "--max_size") {
+      max_size = strtoul(argv[idx], NULL, 10);
+    } else if (arg == "--metric" && !strcmp(argv[idx], "edit")) {
+      jaccard = false;
+    } else if (arg == "--metric" && !strcmp(argv[idx], "jaccard")) {
+      jaccard = true;
+    } else if (arg == "--top") {
+      top = strtoul(argv[idx], NULL, 10);
+    } else {
+      Usage();
+      return 1;
+    }
+  }
+
+  TokenTable table;
+  std::vector<TestCase> tests;
+  for (const std::string& file : files) {
+    std::string text;
+    if (!ReadFile(file, &text)) {
+      std::cout << "Cannot read " << file << ", skipped." << std::endl;
+      continue;
+    }
+    if (max_size && text.size() > max_size) continue;
+    TestCase test;
+    test.file = file;
+    Tokenise(text, &table, &test.tokens);
+    if (jaccard) test.bigrams = GetBigrams(test.tokens);
+    tests.push_back(test);
+  }
+  std::cout << "Ranking " << tests.size() << " test cases." << std::endl;
+  if (tests.empty()) return 0;
+  if (!top || top > tests.size()) top = tests.size();
+
+  auto distance = [&tests, jaccard](size_t lhs, size_t rhs) {
+    const TestCase& left = tests[lhs];
+    const TestCase& right = tests[rhs];
+    if (jaccard) return JaccardDistance(left.bigrams, right.bigrams);
+    size_t longest = std::max(left.tokens.size(), right.tokens.size());
+    if (!longest) return 0.0;
+    // The shorter sequence is the pattern, it takes fewer blocks.
+    size_t edits = left.tokens.size() < right.tokens.size() ?
+        EditDistance(left.tokens, right.tokens) :
+        EditDistance(right.tokens, left.tokens);
+    return static_cast<double>(edits) / longest;
+  };
+
+  // Distance of every test case to the nearest ranked one, and which it is.
+  std::vector<double> nearest_distance(tests.size(), 2.0);
+  std::vector<size_t> nearest(tests.size(), 0);
+  std::vector<bool> ranked(tests.size(), false);
+  std::vector<size_t> ranking;
+  size_t pick = 0;
+  for (size_t idx = 1; idx < tests.size(); ++idx)
+    if (tests[idx].tokens.size() > tests[pick].tokens.size()) pick = idx;
+  double pick_distance = 0;
+  while (true) {
+    ranked[pick] = true;
+    ranking.push_back(pick);
+    std::cout << "#" << ranking.size() << " " << tests[pick].file;
+    if (ranking.size() > 1)
+      std::cout << " distance " << pick_distance << " from "
+                << tests[nearest[pick]].file;
+    std::cout << std::endl;
+    if (ranking.size() == top) break;
+
+    ParallelFor(tests.size(), jobs, [&](size_t idx) {
+      if (ranked[idx]) return;
+      double dist = distance(pick, idx);
+      if (dist < nearest_distance[idx]) {
+        nearest_distance[idx] = dist;
+        nearest[idx] = pick;
+      }
+    });
+    pick_distance = -1;
+    for (size_t idx = 0; idx < tests.size(); ++idx) {
+      if (!ranked[idx] && nearest_distance[idx] > pick_distance) {
+        pick_distance = nearest_distance[idx];
+        pick = idx;
+      }
+    }
+  }
+
+  // The test cases left out of the ranking are listed with the ranked test
+  // case they are nearest to.
+  if (ranking.size() < tests.size()) {
+    std::map<size_t, std::vector<size_t> > groups;
+    for (size_t idx = 0; idx < tests.size(); ++idx)
+      if (!ranked[idx]) groups[nearest[idx]].push_back(idx);
+    for (size_t rank = 0; rank < ranking.size(); ++rank) {
+      const std::vector<size_t>& group = groups[ranking[rank]];
+      std::cout << "Group of #" << rank + 1 << ": " << group.size()
+                << " more test cases" << std::endl;
+      for (size_t idx : group)
+        std::cout << "  " << tests[idx].file << " distance "
+                  << nearest_distance[idx] << std::endl;
+    }
+  }
+  return 0;
+}